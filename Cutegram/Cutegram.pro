@@ -56,7 +56,15 @@ SOURCES += main.cpp \
     usernamefiltermodel.cpp \
     tagfiltermodel.cpp \
     mp3converterengine.cpp \
-    textemojiwrapper.cpp
+    textemojiwrapper.cpp \
+    textmeasure.cpp \
+    downloadsink.cpp \
+    downloadsinkcore.cpp \
+    downloadscheduler.cpp \
+    uploadpipeline.cpp \
+    typeobjectcounter.cpp \
+    messagestore.cpp \
+    ephemeraltimer.cpp
 
 RESOURCES += resource.qrc
 
@@ -92,12 +100,22 @@ HEADERS += \
     usernamefiltermodel.h \
     tagfiltermodel.h \
     mp3converterengine.h \
-    textemojiwrapper.h
+    textemojiwrapper.h \
+    textmeasure.h \
+    downloadsink.h \
+    downloadsinkcore.h \
+    downloadscheduler.h \
+    uploadpipeline.h \
+    typeobjectcounter.h \
+    messagestore.h \
+    ephemeraltimer.h
 
 OTHER_FILES += \
     objects/types.sco \
+    objects/typesgen.py \
+    objects/templates/file.template \
     objects/templates/class.template \
-    objects/templates/equals.template \
+    objects/templates/plain.template \
     objects/templates/initialize.template
 
 
@@ -1,4 +1,5 @@
 #include "asemanfilesystemmodel.h"
+#include "asemanlistdiff.h"
 
 #include <QFileSystemWatcher>
 #include <QDir>
@@ -66,6 +67,11 @@ QList<SortUnitType> analize_file_name(const QString &fileName)
 }
 
 AsemanFileSystemModelPrivate *fileListSort_private_data = 0;
+QString fileInfoKey(const QFileInfo &file)
+{
+    return file.filePath();
+}
+
 bool fileListSort(const QFileInfo &f1, const QFileInfo &f2)
 {
     if(fileListSort_private_data->showDirsFirst)
@@ -426,51 +432,7 @@ void AsemanFileSystemModel::changed(const QList<QFileInfo> &list)
 {
     bool count_changed = (list.count()==p->list.count());
 
-    for( int i=0 ; i<p->list.count() ; i++ )
-    {
-        const QFileInfo &file = p->list.at(i);
-        if( list.contains(file) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->list.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
-
-    QList<QFileInfo> temp_list = list;
-    for( int i=0 ; i<temp_list.count() ; i++ )
-    {
-        const QFileInfo &file = temp_list.at(i);
-        if( p->list.contains(file) )
-            continue;
-
-        temp_list.removeAt(i);
-        i--;
-    }
-    while( p->list != temp_list )
-        for( int i=0 ; i<p->list.count() ; i++ )
-        {
-            const QFileInfo &file = p->list.at(i);
-            int nw = temp_list.indexOf(file);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->list.move( i, nw );
-            endMoveRows();
-        }
-
-    for( int i=0 ; i<list.count() ; i++ )
-    {
-        const QFileInfo &file = list.at(i);
-        if( p->list.contains(file) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->list.insert( i, file );
-        endInsertRows();
-    }
+    AsemanListDiff::apply(this, p->list, list, &fileInfoKey);
 
     if(count_changed)
         emit countChanged();
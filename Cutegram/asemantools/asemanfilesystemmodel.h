@@ -9,6 +9,7 @@ class AsemanFileSystemModelPrivate;
 class AsemanFileSystemModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
     Q_ENUMS(SortFlag)
 
     Q_PROPERTY(bool showDirs READ showDirs WRITE setShowDirs NOTIFY showDirsChanged)
@@ -0,0 +1,186 @@
+/*
+    Copyright (C) 2014 Aseman
+    http://aseman.co
+
+    This project is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This project is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ASEMANLISTDIFF_H
+#define ASEMANLISTDIFF_H
+
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QModelIndex>
+
+/*!
+ * Moves a model's row list to a new order using the fewest row signals.
+ * Rows are matched by key through hash lookups; runs of adjacent rows
+ * are removed, moved and inserted as single ranges. Only the rows off
+ * the longest already ordered subsequence are moved.
+ *
+ * Models declare "friend class AsemanListDiff;" so the begin/end row
+ * functions can be called on them, then call:
+ *     AsemanListDiff::apply(this, p->list, newList);
+ */
+class AsemanListDiff
+{
+public:
+    template<typename Model, typename T>
+    static void apply(Model *model, QList<T> &list, const QList<T> &target) {
+        apply(model, list, target, &AsemanListDiff::identity<T>);
+    }
+
+    template<typename Model, typename T, typename Key>
+    static void apply(Model *model, QList<T> &list, const QList<T> &target, Key (*keyOf)(const T &)) {
+        QSet<Key> targetKeys;
+        targetKeys.reserve(target.count());
+        for(int i=0; i<target.count(); i++)
+            targetKeys.insert(keyOf(target.at(i)));
+
+        // Removes, from the end so indexes stay valid
+        for(int i=list.count()-1; i>=0; i--)
+        {
+            if(targetKeys.contains(keyOf(list.at(i))))
+                continue;
+
+            int first = i;
+            while(first > 0 && !targetKeys.contains(keyOf(list.at(first-1))))
+                first--;
+
+            model->beginRemoveRows(QModelIndex(), first, i);
+            for(int j=i; j>=first; j--)
+                list.removeAt(j);
+            model->endRemoveRows();
+
+            i = first;
+        }
+
+        QSet<Key> existKeys;
+        existKeys.reserve(list.count());
+        for(int i=0; i<list.count(); i++)
+            existKeys.insert(keyOf(list.at(i)));
+
+        QList<T> order;
+        order.reserve(list.count());
+        for(int i=0; i<target.count(); i++)
+            if(existKeys.contains(keyOf(target.at(i))))
+                order << target.at(i);
+
+        QHash<Key,int> orderIndex;
+        orderIndex.reserve(order.count());
+        for(int i=0; i<order.count(); i++)
+            orderIndex[keyOf(order.at(i))] = i;
+
+        // The rows on the longest increasing run of target indexes are
+        // already in order among themselves and stay in place, only the
+        // others are moved.
+        QVector<int> seq(list.count());
+        for(int i=0; i<list.count(); i++)
+            seq[i] = orderIndex.value(keyOf(list.at(i)));
+
+        QVector<bool> stable(order.count(), false);
+        QVector<int> tails;
+        QVector<int> prev(seq.count(), -1);
+        for(int i=0; i<seq.count(); i++)
+        {
+            int lo = 0;
+            int hi = tails.count();
+            while(lo < hi)
+            {
+                const int mid = (lo+hi)/2;
+                if(seq.at(tails.at(mid)) < seq.at(i))
+                    lo = mid+1;
+                else
+                    hi = mid;
+            }
+
+            if(lo > 0)
+                prev[i] = tails.at(lo-1);
+            if(lo == tails.count())
+                tails << i;
+            else
+                tails[lo] = i;
+        }
+        for(int i = tails.isEmpty()? -1 : tails.last(); i != -1; i = prev.at(i))
+            stable[seq.at(i)] = true;
+
+        QHash<Key,int> index;
+        index.reserve(list.count());
+        for(int i=0; i<list.count(); i++)
+            index[keyOf(list.at(i))] = i;
+
+        // Moves, each row goes right after the row before it in the
+        // target, bringing runs of adjacent rows along at once
+        for(int i=0; i<order.count(); i++)
+        {
+            if(stable.at(i))
+                continue;
+
+            const int from = index.value(keyOf(order.at(i)));
+            const int dest = i? index.value(keyOf(order.at(i-1)))+1 : 0;
+
+            int len = 1;
+            while(from+len < list.count() && i+len < order.count() && !stable.at(i+len) &&
+                  keyOf(list.at(from+len)) == keyOf(order.at(i+len)))
+                len++;
+
+            if(from != dest)
+            {
+                model->beginMoveRows(QModelIndex(), from, from+len-1, QModelIndex(), dest);
+                if(dest < from)
+                    for(int j=0; j<len; j++)
+                        list.move(from+j, dest+j);
+                else
+                    for(int j=0; j<len; j++)
+                        list.move(from, dest-1);
+                model->endMoveRows();
+
+                const int first = qMin(from, dest);
+                const int last = qMax(from+len, dest);
+                for(int j=first; j<last; j++)
+                    index[keyOf(list.at(j))] = j;
+            }
+
+            i += len-1;
+        }
+
+        // Inserts
+        for(int i=0; i<target.count(); i++)
+        {
+            if(existKeys.contains(keyOf(target.at(i))))
+                continue;
+
+            int len = 1;
+            while(i+len < target.count() && !existKeys.contains(keyOf(target.at(i+len))))
+                len++;
+
+            model->beginInsertRows(QModelIndex(), i, i+len-1);
+            for(int j=0; j<len; j++)
+                list.insert(i+j, target.at(i+j));
+            model->endInsertRows();
+
+            i += len-1;
+        }
+    }
+
+private:
+    template<typename T>
+    static T identity(const T &t) {
+        return t;
+    }
+};
+
+#endif // ASEMANLISTDIFF_H
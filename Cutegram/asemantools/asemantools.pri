@@ -148,7 +148,8 @@ HEADERS += \
     asemantools/asemanquickitemimagegrabber.h \
     asemantools/asemanquickobject.h \
     asemantools/asemanfilesystemmodel.h \
-    asemantools/asemandebugobjectcounter.h
+    asemantools/asemandebugobjectcounter.h \
+    asemantools/asemanlistdiff.h
 
 OTHER_FILES += \
     asemantools/android-build/src/land/aseman/android/AsemanActivity.java \
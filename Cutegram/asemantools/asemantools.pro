@@ -122,7 +122,8 @@ HEADERS += \
     asemannotification.h \
     asemanautostartmanager.h \
     asemanquickobject.h \
-    asemanfilesystemmodel.h
+    asemanfilesystemmodel.h \
+    asemanlistdiff.h
 
 OTHER_FILES += \
     android-build/src/land/aseman/android/AsemanActivity.java \
@@ -18,6 +18,7 @@
 
 #include "chatparticipantlist.h"
 #include "objects/types.h"
+#include "typeobjectcounter.h"
 
 class ChatParticipantListPrivate
 {
@@ -29,12 +30,14 @@ ChatParticipantList::ChatParticipantList(QObject *parent) :
     QObject(parent)
 {
     p = new ChatParticipantListPrivate;
+    TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantList)+sizeof(ChatParticipantListPrivate));
 }
 
 ChatParticipantList::ChatParticipantList(const QList<ChatParticipant> &another, QObject *parent) :
     QObject(parent)
 {
     p = new ChatParticipantListPrivate;
+    TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantList)+sizeof(ChatParticipantListPrivate));
     operator =(another);
 }
 
@@ -93,5 +96,6 @@ ChatParticipantObject *ChatParticipantList::at(int idx)
 
 ChatParticipantList::~ChatParticipantList()
 {
+    TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatParticipantList)+sizeof(ChatParticipantListPrivate));
     delete p;
 }
@@ -45,6 +45,7 @@
 #include "unitysystemtray.h"
 #include "userdata.h"
 #include "cutegramenums.h"
+#include "textmeasure.h"
 
 #include <QPointer>
 #include <QQmlContext>
@@ -52,7 +53,6 @@
 #include <QtQml>
 #include <QDebug>
 #include <QImageWriter>
-#include <QTextDocument>
 #include <QImageReader>
 #include <QSystemTrayIcon>
 #include <QGuiApplication>
@@ -81,7 +81,7 @@ public:
     bool closingState;
     bool cutegramSubscribe;
 
-    QTextDocument *doc;
+    TextMeasure *measure;
 
     QSystemTrayIcon *sysTray;
     UnitySystemTray *unityTray;
@@ -123,7 +123,7 @@ Cutegram::Cutegram(QObject *parent) :
 #endif
 
     p = new CutegramPrivate;
-    p->doc = new QTextDocument(this);
+    p->measure = new TextMeasure(this);
     p->desktop = new AsemanDesktopTools(this);
     p->sysTray = 0;
     p->unityTray = 0;
@@ -209,8 +209,12 @@ bool Cutegram::filsIsImage(const QString &pt)
 
 qreal Cutegram::htmlWidth(const QString &txt)
 {
-    p->doc->setHtml(txt);
-    return p->doc->size().width() + 10;
+    return p->measure->htmlSize(txt).width() + 10;
+}
+
+void Cutegram::prefetchHtmlWidths(const QStringList &htmls)
+{
+    p->measure->prefetch(htmls);
 }
 
 void Cutegram::deleteFile(const QString &pt)
@@ -309,6 +313,8 @@ void Cutegram::logout(const QString &phone)
     QFile::remove(ppath + "/secret");
     QFile::remove(ppath + "/database.db");
     QFile::remove(ppath + "/database.db-journal");
+    QFile::remove(ppath + "/database.db-wal");
+    QFile::remove(ppath + "/database.db-shm");
 
     restart();
 }
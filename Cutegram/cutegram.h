@@ -74,6 +74,7 @@ public:
     Q_INVOKABLE QSize imageSize( const QString & path );
     Q_INVOKABLE bool filsIsImage(const QString & path);
     Q_INVOKABLE qreal htmlWidth( const QString & txt );
+    Q_INVOKABLE void prefetchHtmlWidths(const QStringList &htmls);
 
     Q_INVOKABLE void deleteFile(const QString &path);
     Q_INVOKABLE QString storeMessage(const QString &msg);
@@ -8,6 +8,7 @@ class CutegramEnums : public QObject
 {
     Q_OBJECT
     Q_ENUMS(ProxyTypes)
+    Q_ENUMS(DownloadPriorities)
 
 public:
     enum ProxyTypes {
@@ -16,6 +17,14 @@ public:
         ProxySocks5Proxy = QNetworkProxy::Socks5Proxy
     };
 
+    enum DownloadPriorities {
+        DownloadPriorityAuto = -1,
+        DownloadPriorityThumbnail = 0,
+        DownloadPriorityAvatar = 1,
+        DownloadPriorityFile = 2,
+        DownloadPriorityPrefetch = 3
+    };
+
     CutegramEnums(QObject *parent = 0);
     ~CutegramEnums();
 };
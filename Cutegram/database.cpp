@@ -9,6 +9,7 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QThread>
+#include <QCoreApplication>
 #include <QDir>
 
 class DatabasePrivate
@@ -65,13 +66,22 @@ void Database::setPhoneNumber(const QString &phoneNumber)
         p->thread->start();
 
         p->core->moveToThread(p->thread);
+        QMetaObject::invokeMethod(p->core, "init", Qt::QueuedConnection);
+        if(QCoreApplication::arguments().contains("--explain-queries"))
+            QMetaObject::invokeMethod(p->core, "explainQueryPlans", Qt::QueuedConnection);
 
         connect(p->core, SIGNAL(chatFounded(DbChat))         , SLOT(chatFounded_slt(DbChat))         , Qt::QueuedConnection );
         connect(p->core, SIGNAL(userFounded(DbUser))         , SLOT(userFounded_slt(DbUser))         , Qt::QueuedConnection );
         connect(p->core, SIGNAL(dialogFounded(DbDialog,bool)), SLOT(dialogFounded_slt(DbDialog,bool)), Qt::QueuedConnection );
-        connect(p->core, SIGNAL(messageFounded(DbMessage))   , SLOT(messageFounded_slt(DbMessage))   , Qt::QueuedConnection );
+        connect(p->core, SIGNAL(messagesFounded(QList<DbMessage>)), SLOT(messagesFounded_slt(QList<DbMessage>)), Qt::QueuedConnection );
         connect(p->core, SIGNAL(mediaKeyFounded(qint64,QByteArray,QByteArray)),
                 SIGNAL(mediaKeyFounded(qint64,QByteArray,QByteArray)), Qt::QueuedConnection );
+        connect(p->core, SIGNAL(messagesSearched(QString,QList<qint64>)),
+                SIGNAL(messagesSearched(QString,QList<qint64>)), Qt::QueuedConnection );
+        connect(p->core, SIGNAL(valueFounded(QString,QString)),
+                SIGNAL(valueFounded(QString,QString)), Qt::QueuedConnection );
+        connect(p->core, SIGNAL(statementStatsFounded(qint64,qint64)),
+                SIGNAL(statementStatsFounded(qint64,qint64)), Qt::QueuedConnection );
     }
 
     emit phoneNumberChanged();
@@ -118,6 +128,48 @@ void Database::insertMessage(const Message &message)
     QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(DbMessage,dmsg));
 }
 
+void Database::insertUsers(const QList<User> &users)
+{
+    FIRST_CHECK;
+    QList<DbUser> dusers;
+    foreach(const User &user, users)
+    {
+        DbUser duser;
+        duser.user = user;
+        dusers << duser;
+    }
+
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QList<DbUser>,dusers));
+}
+
+void Database::insertChats(const QList<Chat> &chats)
+{
+    FIRST_CHECK;
+    QList<DbChat> dchats;
+    foreach(const Chat &chat, chats)
+    {
+        DbChat dchat;
+        dchat.chat = chat;
+        dchats << dchat;
+    }
+
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QList<DbChat>,dchats));
+}
+
+void Database::insertMessages(const QList<Message> &messages)
+{
+    FIRST_CHECK;
+    QList<DbMessage> dmsgs;
+    foreach(const Message &message, messages)
+    {
+        DbMessage dmsg;
+        dmsg.message = message;
+        dmsgs << dmsg;
+    }
+
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QList<DbMessage>,dmsgs));
+}
+
 void Database::insertMediaEncryptedKeys(qint64 mediaId, const QByteArray &key, const QByteArray &iv)
 {
     FIRST_CHECK;
@@ -130,13 +182,25 @@ void Database::readFullDialogs()
     QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection);
 }
 
-void Database::readMessages(const Peer &peer, int offset, int limit)
+void Database::readMessages(const Peer &peer, qint64 lastId, int limit)
 {
     FIRST_CHECK;
     DbPeer dpeer;
     dpeer.peer = peer;
 
-    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(DbPeer,dpeer), Q_ARG(int,offset), Q_ARG(int,limit) );
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(DbPeer,dpeer), Q_ARG(qint64,lastId), Q_ARG(int,limit) );
+}
+
+void Database::readMessagesById(const QList<qint64> &ids)
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QList<qint64>,ids) );
+}
+
+void Database::searchMessages(const QString &keyword, int limit)
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QString,keyword), Q_ARG(int,limit) );
 }
 
 void Database::deleteMessage(qint64 msgId)
@@ -157,6 +221,30 @@ void Database::deleteHistory(qint64 dlgId)
     QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(qint64,dlgId));
 }
 
+void Database::setValue(const QString &key, const QString &value)
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QString,key), Q_ARG(QString,value));
+}
+
+void Database::readValue(const QString &key)
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(QString,key));
+}
+
+void Database::explainQueryPlans()
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection);
+}
+
+void Database::readStatementStats()
+{
+    FIRST_CHECK;
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection);
+}
+
 void Database::userFounded_slt(const DbUser &user)
 {
     emit userFounded(user.user);
@@ -172,9 +260,13 @@ void Database::dialogFounded_slt(const DbDialog &dialog, bool encrypted)
     emit dialogFounded(dialog.dialog, encrypted);
 }
 
-void Database::messageFounded_slt(const DbMessage &message)
+void Database::messagesFounded_slt(const QList<DbMessage> &messages)
 {
-    emit messageFounded(message.message);
+    QList<Message> result;
+    foreach(const DbMessage &dmsg, messages)
+        result << dmsg.message;
+
+    emit messagesFounded(result);
 }
 
 Database::~Database()
@@ -30,28 +30,42 @@ public slots:
     void insertChat(const Chat &chat);
     void insertDialog(const Dialog &dialog, bool encrypted);
     void insertMessage(const Message &message);
+    void insertUsers(const QList<User> &users);
+    void insertChats(const QList<Chat> &chats);
+    void insertMessages(const QList<Message> &messages);
     void insertMediaEncryptedKeys(qint64 mediaId, const QByteArray &key, const QByteArray &iv);
 
     void readFullDialogs();
-    void readMessages(const Peer &peer, int offset, int limit);
+    void readMessages(const Peer &peer, qint64 lastId, int limit);
+    void readMessagesById(const QList<qint64> &ids);
+    void searchMessages(const QString &keyword, int limit);
 
     void deleteMessage(qint64 msgId);
     void deleteDialog(qint64 dlgId);
     void deleteHistory(qint64 dlgId);
 
+    void setValue(const QString &key, const QString &value);
+    void readValue(const QString &key);
+
+    void explainQueryPlans();
+    void readStatementStats();
+
 signals:
     void userFounded(const User &user);
     void chatFounded(const Chat &chat);
     void dialogFounded(const Dialog &dialog, bool encrypted);
-    void messageFounded(const Message &message);
+    void messagesFounded(const QList<Message> &messages);
     void mediaKeyFounded(qint64 mediaId, const QByteArray &key, const QByteArray &iv);
+    void messagesSearched(const QString &keyword, const QList<qint64> &messages);
+    void valueFounded(const QString &key, const QString &value);
+    void statementStatsFounded(qint64 prepared, qint64 lookups);
     void phoneNumberChanged();
 
 private slots:
     void userFounded_slt(const DbUser &user);
     void chatFounded_slt(const DbChat &chat);
     void dialogFounded_slt(const DbDialog &dialog, bool encrypted);
-    void messageFounded_slt(const DbMessage &message);
+    void messagesFounded_slt(const QList<DbMessage> &messages);
 
 private:
     DatabasePrivate *p;
@@ -7,10 +7,102 @@
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QList>
+#include <QSet>
 #include <QDebug>
 #include <QTimerEvent>
 #include <QFileInfo>
 #include <QDir>
+#include <QSettings>
+#include <QStringList>
+#include <QRegExp>
+
+#define DATABASE_VACUUM_LIMIT (8*1024*1024)
+
+/*!
+ * Every statement the core runs at runtime. explainQueryPlans() goes
+ * through databasecore_queries, so a new statement has to be added there
+ * too. %1 stands for the id list of an IN() lookup.
+ */
+static const char *databasecore_insert_user = "INSERT OR REPLACE INTO Users (id, accessHash, inactive, phone, firstName, lastName, username, type, photoId, photoBigLocalId, photoBigSecret, photoBigDcId, photoBigVolumeId, photoSmallLocalId, photoSmallSecret, photoSmallDcId, photoSmallVolumeId, statusWasOnline, statusExpires, statusType) "
+                                              "VALUES (:id, :accessHash, :inactive, :phone, :firstName, :lastName, :username, :type, :photoId, :photoBigLocalId, :photoBigSecret, :photoBigDcId, :photoBigVolumeId, :photoSmallLocalId, :photoSmallSecret, :photoSmallDcId, :photoSmallVolumeId, :statusWasOnline, :statusExpires, :statusType);";
+static const char *databasecore_insert_chat = "INSERT OR REPLACE INTO Chats (id, participantsCount, version, venue, title, address, date, geo, accessHash, checkedIn, left, type, photoId, photoBigLocalId, photoBigSecret, photoBigDcId, photoBigVolumeId, photoSmallLocalId, photoSmallSecret, photoSmallDcId, photoSmallVolumeId) "
+                                              "VALUES (:id, :participantsCount, :version, :venue, :title, :address, :date, :geo, :accessHash, :checkedIn, :left, :type, :photoId, :photoBigLocalId, :photoBigSecret, :photoBigDcId, :photoBigVolumeId, :photoSmallLocalId, :photoSmallSecret, :photoSmallDcId, :photoSmallVolumeId);";
+static const char *databasecore_insert_dialog = "INSERT OR REPLACE INTO Dialogs (peer, peerType, topMessage, unreadCount, encrypted) "
+                                                "VALUES (:peer, :peerType, :topMessage, :unreadCount, :encrypted);";
+static const char *databasecore_insert_message = "INSERT OR REPLACE INTO Messages (id, toId, toPeerType, dialogId, unread, fromId, out, date, fwdDate, fwdFromId, message, actionAddress, actionUserId, actionPhoto, actionTitle, actionUsers, actionType, mediaAudio, mediaLastName, mediaFirstName, mediaPhoneNumber, mediaDocument, mediaGeo, mediaPhoto, mediaUserId, mediaVideo, mediaType) "
+                                                 "VALUES (:id, :toId, :toPeerType, :dialogId, :unread, :fromId, :out, :date, :fwdDate, :fwdFromId, :message, :actionAddress, :actionUserId, :actionPhoto, :actionTitle, :actionUsers, :actionType, :mediaAudio, :mediaLastName, :mediaFirstName, :mediaPhoneNumber, :mediaDocument, :mediaGeo, :mediaPhoto, :mediaUserId, :mediaVideo, :mediaType);";
+static const char *databasecore_delete_message_index = "DELETE FROM MessagesIndex WHERE docid=:id";
+static const char *databasecore_insert_message_index = "INSERT INTO MessagesIndex (docid, message) VALUES (:id, :message)";
+static const char *databasecore_insert_media_key = "INSERT OR REPLACE INTO MediaKeys (id, key, iv) VALUES (:id, :key, :iv);";
+static const char *databasecore_read_messages_before = "SELECT * FROM Messages WHERE dialogId=:dialogId AND toPeerType=:toPeerType AND id<:lastId ORDER BY id DESC LIMIT :limit";
+static const char *databasecore_read_messages = "SELECT * FROM Messages WHERE dialogId=:dialogId AND toPeerType=:toPeerType ORDER BY id DESC LIMIT :limit";
+static const char *databasecore_search_messages = "SELECT docid FROM MessagesIndex WHERE message MATCH :match ORDER BY docid DESC LIMIT :limit";
+static const char *databasecore_insert_value = "INSERT OR REPLACE INTO general (gkey,gvalue) VALUES (:key,:val)";
+static const char *databasecore_delete_message = "DELETE FROM Messages WHERE id=:id";
+static const char *databasecore_delete_dialog = "DELETE FROM Dialogs WHERE peer=:peer";
+static const char *databasecore_delete_history_index = "DELETE FROM MessagesIndex WHERE docid IN (SELECT id FROM Messages WHERE dialogId=:peer)";
+static const char *databasecore_delete_history = "DELETE FROM Messages WHERE dialogId=:peer";
+static const char *databasecore_read_dialogs = "SELECT * FROM Dialogs";
+static const char *databasecore_read_users = "SELECT * FROM Users";
+static const char *databasecore_read_chats = "SELECT * FROM Chats";
+static const char *databasecore_read_values = "SELECT gkey, gvalue FROM general";
+static const char *databasecore_insert_audio = "INSERT OR REPLACE INTO Audios (id, dcId, mimeType, duration, date, size, accessHash, userId, type) "
+                                               "VALUES (:id, :dcId, :mimeType, :duration, :date, :size, :accessHash, :userId, :type);";
+static const char *databasecore_insert_video = "INSERT OR REPLACE INTO Videos (id, dcId, caption, mimeType, date, duration, h, size, accessHash, userId, w, type) "
+                                               "VALUES (:id, :dcId, :caption, :mimeType, :date, :duration, :h, :size, :accessHash, :userId, :w, :type);";
+static const char *databasecore_insert_document = "INSERT OR REPLACE INTO Documents (id, dcId, mimeType, date, fileName, size, accessHash, userId, type) "
+                                                  "VALUES (:id, :dcId, :mimeType, :date, :fileName, :size, :accessHash, :userId, :type);";
+static const char *databasecore_insert_geo = "INSERT OR REPLACE INTO Geos (id, longitude, lat) "
+                                             "VALUES (:id, :longitude, :lat);";
+static const char *databasecore_insert_photo = "INSERT OR REPLACE INTO Photos (id, caption, date, accessHash, userId) "
+                                               "VALUES (:id, :caption, :date, :accessHash, :userId);";
+static const char *databasecore_insert_photo_size = "INSERT OR REPLACE INTO PhotoSizes (pid, h, type, size, w, locationLocalId, locationSecret, locationDcId, locationVolumeId) "
+                                                    "VALUES (:pid, :h, :type, :size, :w, :locationLocalId, :locationSecret, :locationDcId, :locationVolumeId);";
+static const char *databasecore_read_messages_by_id = "SELECT * FROM Messages WHERE id IN (%1) ORDER BY id DESC";
+static const char *databasecore_read_audios = "SELECT * FROM Audios WHERE id IN (%1)";
+static const char *databasecore_read_videos = "SELECT * FROM Videos WHERE id IN (%1)";
+static const char *databasecore_read_documents = "SELECT * FROM Documents WHERE id IN (%1)";
+static const char *databasecore_read_geos = "SELECT * FROM Geos WHERE id IN (%1)";
+static const char *databasecore_read_photos = "SELECT * FROM Photos WHERE id IN (%1)";
+static const char *databasecore_read_media_keys = "SELECT * FROM MediaKeys WHERE id IN (%1)";
+static const char *databasecore_read_photo_sizes = "SELECT * FROM PhotoSizes WHERE pid IN (%1)";
+
+static const char *databasecore_queries[] = {
+    databasecore_insert_user,
+    databasecore_insert_chat,
+    databasecore_insert_dialog,
+    databasecore_insert_message,
+    databasecore_delete_message_index,
+    databasecore_insert_message_index,
+    databasecore_insert_media_key,
+    databasecore_read_messages_before,
+    databasecore_read_messages,
+    databasecore_search_messages,
+    databasecore_insert_value,
+    databasecore_delete_message,
+    databasecore_delete_dialog,
+    databasecore_delete_history_index,
+    databasecore_delete_history,
+    databasecore_read_dialogs,
+    databasecore_read_users,
+    databasecore_read_chats,
+    databasecore_read_values,
+    databasecore_insert_audio,
+    databasecore_insert_video,
+    databasecore_insert_document,
+    databasecore_insert_geo,
+    databasecore_insert_photo,
+    databasecore_insert_photo_size,
+    databasecore_read_messages_by_id,
+    databasecore_read_audios,
+    databasecore_read_videos,
+    databasecore_read_documents,
+    databasecore_read_geos,
+    databasecore_read_photos,
+    databasecore_read_media_keys,
+    databasecore_read_photo_sizes,
+    0
+};
 
 class DatabaseCorePrivate
 {
@@ -21,6 +113,20 @@ public:
 
     QHash<QString,QString> general;
     int commit_timer;
+
+    QHash<QString,QSqlQuery> statements;
+    qint64 statements_prepared;
+    qint64 statement_lookups;
+
+    QString journalMode;
+    QString synchronous;
+    QString tempStore;
+    int cacheSize;
+    qint64 mmapSize;
+
+    int maintenance_interval;
+    int maintenance_timer;
+    int maintenance_count;
 };
 
 DatabaseCore::DatabaseCore(const QString &path, const QString &phoneNumber, QObject *parent) :
@@ -30,31 +136,72 @@ DatabaseCore::DatabaseCore(const QString &path, const QString &phoneNumber, QObj
     p->path = path;
     p->commit_timer = 0;
     p->phoneNumber = phoneNumber;
-
-    p->db = QSqlDatabase::addDatabase("QSQLITE",DATABASE_DB_CONNECTION+p->phoneNumber);
-    p->db.setDatabaseName(p->path);
-
-    reconnect();
+    p->statements_prepared = 0;
+    p->statement_lookups = 0;
+    p->maintenance_timer = 0;
+    p->maintenance_count = 0;
+
+    QSettings *settings = AsemanApplication::settings();
+    p->journalMode = settings->value("Database/journalMode", "WAL").toString().toUpper();
+    p->synchronous = settings->value("Database/synchronous", "NORMAL").toString().toUpper();
+    p->tempStore = settings->value("Database/tempStore", "MEMORY").toString().toUpper();
+    p->cacheSize = settings->value("Database/cacheSize", 16384).toInt();
+    p->mmapSize = settings->value("Database/mmapSize", 268435456).toLongLong();
+
+    p->maintenance_interval = settings->value("Database/maintenanceInterval", 300).toInt();
+
+    if(!QStringList(QStringList() << "DELETE" << "TRUNCATE" << "PERSIST" << "MEMORY" << "WAL").contains(p->journalMode))
+        p->journalMode = "WAL";
+    if(!QStringList(QStringList() << "OFF" << "NORMAL" << "FULL").contains(p->synchronous))
+        p->synchronous = "NORMAL";
+    if(!QStringList(QStringList() << "DEFAULT" << "FILE" << "MEMORY").contains(p->tempStore))
+        p->tempStore = "MEMORY";
 
     qRegisterMetaType<DbUser>("DbUser");
     qRegisterMetaType<DbChat>("DbChat");
     qRegisterMetaType<DbDialog>("DbDialog");
     qRegisterMetaType<DbMessage>("DbMessage");
+    qRegisterMetaType< QList<DbUser> >("QList<DbUser>");
+    qRegisterMetaType< QList<DbChat> >("QList<DbChat>");
+    qRegisterMetaType< QList<DbMessage> >("QList<DbMessage>");
+    qRegisterMetaType< QList<qint64> >("QList<qint64>");
     qRegisterMetaType<DbPeer>("DbPeer");
 }
 
+void DatabaseCore::init()
+{
+    // Called on the database thread, the connection belongs to the thread
+    // that opens it and the migrations must not stall the gui.
+    p->db = QSqlDatabase::addDatabase("QSQLITE",DATABASE_DB_CONNECTION+p->phoneNumber);
+    p->db.setDatabaseName(p->path);
+
+    reconnect();
+
+    p->maintenance_timer = p->maintenance_interval>0? startTimer(p->maintenance_interval*1000) : 0;
+}
+
 void DatabaseCore::disconnect()
 {
+    p->statements.clear();
     p->db.close();
 }
 
 void DatabaseCore::insertUser(const DbUser &duser)
 {
     begin();
-    const User &user = duser.user;
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Users (id, accessHash, inactive, phone, firstName, lastName, username, type, photoId, photoBigLocalId, photoBigSecret, photoBigDcId, photoBigVolumeId, photoSmallLocalId, photoSmallSecret, photoSmallDcId, photoSmallVolumeId, statusWasOnline, statusExpires, statusType) "
-                  "VALUES (:id, :accessHash, :inactive, :phone, :firstName, :lastName, :username, :type, :photoId, :photoBigLocalId, :photoBigSecret, :photoBigDcId, :photoBigVolumeId, :photoSmallLocalId, :photoSmallSecret, :photoSmallDcId, :photoSmallVolumeId, :statusWasOnline, :statusExpires, :statusType);");
+    writeUser(duser.user);
+}
+
+void DatabaseCore::insertUsers(const QList<DbUser> &users)
+{
+    begin();
+    foreach(const DbUser &duser, users)
+        writeUser(duser.user);
+}
+
+void DatabaseCore::writeUser(const User &user)
+{
+    QSqlQuery &query = prepareQuery(databasecore_insert_user);
 
     query.bindValue(":id",user.id() );
     query.bindValue(":accessHash",user.accessHash() );
@@ -96,10 +243,19 @@ void DatabaseCore::insertUser(const DbUser &duser)
 void DatabaseCore::insertChat(const DbChat &dchat)
 {
     begin();
-    const Chat &chat = dchat.chat;
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Chats (id, participantsCount, version, venue, title, address, date, geo, accessHash, checkedIn, left, type, photoId, photoBigLocalId, photoBigSecret, photoBigDcId, photoBigVolumeId, photoSmallLocalId, photoSmallSecret, photoSmallDcId, photoSmallVolumeId) "
-                  "VALUES (:id, :participantsCount, :version, :venue, :title, :address, :date, :geo, :accessHash, :checkedIn, :left, :type, :photoId, :photoBigLocalId, :photoBigSecret, :photoBigDcId, :photoBigVolumeId, :photoSmallLocalId, :photoSmallSecret, :photoSmallDcId, :photoSmallVolumeId);");
+    writeChat(dchat.chat);
+}
+
+void DatabaseCore::insertChats(const QList<DbChat> &chats)
+{
+    begin();
+    foreach(const DbChat &dchat, chats)
+        writeChat(dchat.chat);
+}
+
+void DatabaseCore::writeChat(const Chat &chat)
+{
+    QSqlQuery &query = prepareQuery(databasecore_insert_chat);
 
     query.bindValue(":id",chat.id() );
     query.bindValue(":accessHash",chat.accessHash() );
@@ -142,9 +298,7 @@ void DatabaseCore::insertDialog(const DbDialog &ddialog, bool encrypted)
 {
     begin();
     const Dialog &dialog = ddialog.dialog;
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Dialogs (peer, peerType, topMessage, unreadCount, encrypted) "
-                  "VALUES (:peer, :peerType, :topMessage, :unreadCount, :encrypted);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_dialog);
 
     query.bindValue(":peer",dialog.peer().classType()==Peer::typePeerChat?dialog.peer().chatId():dialog.peer().userId() );
     query.bindValue(":peerType",dialog.peer().classType() );
@@ -163,13 +317,27 @@ void DatabaseCore::insertDialog(const DbDialog &ddialog, bool encrypted)
 void DatabaseCore::insertMessage(const DbMessage &dmessage)
 {
     begin();
-    const Message &message = dmessage.message;
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Messages (id, toId, toPeerType, unread, fromId, out, date, fwdDate, fwdFromId, message, actionAddress, actionUserId, actionPhoto, actionTitle, actionUsers, actionType, mediaAudio, mediaLastName, mediaFirstName, mediaPhoneNumber, mediaDocument, mediaGeo, mediaPhoto, mediaUserId, mediaVideo, mediaType) "
-                  "VALUES (:id, :toId, :toPeerType, :unread, :fromId, :out, :date, :fwdDate, :fwdFromId, :message, :actionAddress, :actionUserId, :actionPhoto, :actionTitle, :actionUsers, :actionType, :mediaAudio, :mediaLastName, :mediaFirstName, :mediaPhoneNumber, :mediaDocument, :mediaGeo, :mediaPhoto, :mediaUserId, :mediaVideo, :mediaType);");
+    writeMessage(dmessage.message);
+}
+
+void DatabaseCore::insertMessages(const QList<DbMessage> &messages)
+{
+    begin();
+    foreach(const DbMessage &dmessage, messages)
+        writeMessage(dmessage.message);
+}
+
+void DatabaseCore::writeMessage(const Message &message)
+{
+    QSqlQuery &query = prepareQuery(databasecore_insert_message);
+
+    qint64 dialogId = message.toId().chatId();
+    if(!dialogId)
+        dialogId = message.out()? message.toId().userId() : message.fromId();
 
     query.bindValue(":id",message.id() );
     query.bindValue(":toId",message.toId().classType()==Peer::typePeerChat?message.toId().chatId():message.toId().userId() );
+    query.bindValue(":dialogId",dialogId );
     query.bindValue(":toPeerType",message.toId().classType() );
     query.bindValue(":unread",message.unread() );
     query.bindValue(":fromId",message.fromId() );
@@ -207,6 +375,7 @@ void DatabaseCore::insertMessage(const DbMessage &dmessage)
         return;
     }
 
+    insertMessageIndex(message);
     insertAudio(media.audio());
     insertDocument(media.document());
     insertGeo(message.id(), media.geo());
@@ -214,12 +383,30 @@ void DatabaseCore::insertMessage(const DbMessage &dmessage)
     insertVideo(media.video());
 }
 
+void DatabaseCore::insertMessageIndex(const Message &message)
+{
+    QSqlQuery &del_query = prepareQuery(databasecore_delete_message_index);
+    del_query.bindValue(":id",message.id() );
+    if(!del_query.exec())
+        qDebug() << __PRETTY_FUNCTION__ << del_query.lastError();
+
+    if(message.message().isEmpty())
+        return;
+
+    QSqlQuery &query = prepareQuery(databasecore_insert_message_index);
+    query.bindValue(":id",message.id() );
+    query.bindValue(":message",message.message() );
+
+    bool res = query.exec();
+    if(!res)
+        qDebug() << __PRETTY_FUNCTION__ << query.lastError();
+}
+
 void DatabaseCore::insertMediaEncryptedKeys(qint64 mediaId, const QByteArray &key, const QByteArray &iv)
 {
     begin();
 
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO MediaKeys (id, key, iv) VALUES (:id, :key, :iv);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_media_key);
     query.bindValue(":id" ,mediaId );
     query.bindValue(":key",key );
     query.bindValue(":iv" ,iv );
@@ -239,20 +426,17 @@ void DatabaseCore::readFullDialogs()
     readDialogs();
 }
 
-void DatabaseCore::readMessages(const DbPeer &dpeer, int offset, int limit)
+void DatabaseCore::readMessages(const DbPeer &dpeer, qint64 lastId, int limit)
 {
     const Peer & peer = dpeer.peer;
-    QSqlQuery query(p->db);
-    if( peer.classType() == Peer::typePeerChat )
-        query.prepare("SELECT * FROM Messages WHERE toId=:chatId AND toPeerType=:toPeerType ORDER BY id DESC LIMIT :limit OFFSET :offset");
-    else
-        query.prepare("SELECT * FROM Messages WHERE toPeerType=:toPeerType AND "
-                      "( (toId=:userId AND out=1) OR (fromId=:userId AND out=0) ) ORDER BY id DESC LIMIT :limit OFFSET :offset");
+    QSqlQuery &query = lastId?
+                prepareQuery(databasecore_read_messages_before) :
+                prepareQuery(databasecore_read_messages);
 
-    query.bindValue(":userId", peer.userId());
-    query.bindValue(":chatId", peer.chatId());
+    query.bindValue(":dialogId", peer.classType()==Peer::typePeerChat? peer.chatId() : peer.userId());
     query.bindValue(":toPeerType", peer.classType());
-    query.bindValue(":offset", offset);
+    if(lastId)
+        query.bindValue(":lastId", lastId);
     query.bindValue(":limit", limit);
 
     bool res = query.exec();
@@ -262,27 +446,134 @@ void DatabaseCore::readMessages(const DbPeer &dpeer, int offset, int limit)
         return;
     }
 
+    fetchMessages(query);
+}
+
+void DatabaseCore::readMessagesById(const QList<qint64> &ids)
+{
+    if(ids.isEmpty())
+        return;
+
+    QSqlQuery query(p->db);
+    query.prepare(QString(databasecore_read_messages_by_id).arg(idsToString(ids.toSet())));
+
+    bool res = query.exec();
+    if(!res)
+    {
+        qDebug() << __PRETTY_FUNCTION__ << query.lastError();
+        return;
+    }
+
+    fetchMessages(query);
+}
+
+void DatabaseCore::searchMessages(const QString &keyword, int limit)
+{
+    QString match;
+    const QStringList &words = keyword.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    foreach(QString word, words)
+    {
+        word.remove("\"");
+        if(word.isEmpty())
+            continue;
+
+        match += "\"" + word + "*\" ";
+    }
+
+    QList<qint64> result;
+    if(match.isEmpty())
+    {
+        emit messagesSearched(keyword, result);
+        return;
+    }
+
+    QSqlQuery &query = prepareQuery(databasecore_search_messages);
+    query.bindValue(":match", match.trimmed());
+    query.bindValue(":limit", limit);
+
+    bool res = query.exec();
+    if(!res)
+    {
+        qDebug() << __PRETTY_FUNCTION__ << query.lastError();
+        emit messagesSearched(keyword, result);
+        return;
+    }
+
+    QSet<qint64> ids;
+    while(query.next())
+        ids.insert(query.value(0).toLongLong());
+    query.finish();
+
+    if(!ids.isEmpty())
+    {
+        QSqlQuery messages_query(p->db);
+        messages_query.prepare(QString(databasecore_read_messages_by_id).arg(idsToString(ids)));
+        if(messages_query.exec())
+            result = fetchMessages(messages_query);
+        else
+            qDebug() << __PRETTY_FUNCTION__ << messages_query.lastError();
+    }
+
+    emit messagesSearched(keyword, result);
+}
+
+QList<qint64> DatabaseCore::fetchMessages(QSqlQuery &query)
+{
+    QList<qint64> result;
+    QList<QSqlRecord> records;
+    QSet<qint64> audioIds;
+    QSet<qint64> videoIds;
+    QSet<qint64> documentIds;
+    QSet<qint64> photoIds;
+    QSet<qint64> geoIds;
+    QSet<qint64> messageIds;
     while(query.next())
     {
         const QSqlRecord &record = query.record();
+        records << record;
+
+        audioIds.insert( record.value("mediaAudio").toLongLong() );
+        videoIds.insert( record.value("mediaVideo").toLongLong() );
+        documentIds.insert( record.value("mediaDocument").toLongLong() );
+        photoIds.insert( record.value("mediaPhoto").toLongLong() );
+        photoIds.insert( record.value("actionPhoto").toLongLong() );
+        messageIds.insert( record.value("id").toLongLong() );
+        if(record.value("mediaType").toLongLong() == MessageMedia::typeMessageMediaGeo)
+            geoIds.insert( record.value("mediaGeo").toLongLong() );
+    }
+    query.finish();
 
+    if(records.isEmpty())
+        return result;
+
+    const QHash<qint64, QList<PhotoSize> > &sizes = readPhotoSizes(photoIds + videoIds + documentIds);
+    const QHash<qint64, Audio> &audios = readAudios(audioIds);
+    const QHash<qint64, Video> &videos = readVideos(videoIds, sizes);
+    const QHash<qint64, Document> &documents = readDocuments(documentIds, sizes);
+    const QHash<qint64, Photo> &photos = readPhotos(photoIds, sizes);
+    const QHash<qint64, GeoPoint> &geos = readGeos(geoIds);
+    const QHash<qint64, QPair<QByteArray, QByteArray> > &keys = readMediaKeys(messageIds);
+
+    QList<DbMessage> messages;
+    foreach(const QSqlRecord &record, records)
+    {
         MessageAction action( static_cast<MessageAction::MessageActionType>(record.value("actionType").toLongLong()) );
         action.setAddress( record.value("actionAddress").toString() );
         action.setUserId( record.value("actionUserId").toLongLong() );
         action.setTitle( record.value("actionTitle").toString() );
         action.setUsers( stringToUsers(record.value("actionUsers").toString()) );
-        action.setPhoto( readPhoto(record.value("actionPhoto").toLongLong()) );
+        action.setPhoto( photos.value(record.value("actionPhoto").toLongLong()) );
 
         MessageMedia media( static_cast<MessageMedia::MessageMediaType>(record.value("mediaType").toLongLong()) );
         media.setFirstName( record.value("mediaFirstName").toString() );
         media.setLastName( record.value("mediaLastName").toString() );
         media.setPhoneNumber( record.value("mediaPhoneNumber").toString() );
         media.setUserId( record.value("mediaUserId").toLongLong() );
-        media.setAudio( readAudio(record.value("mediaAudio").toLongLong()) );
-        media.setVideo( readVideo(record.value("mediaVideo").toLongLong()) );
-        media.setDocument( readDocument(record.value("mediaDocument").toLongLong()) );
-        media.setPhoto( readPhoto(record.value("mediaPhoto").toLongLong()) );
-        media.setGeo( readGeo(record.value("mediaGeo").toLongLong()) );
+        media.setAudio( audios.value(record.value("mediaAudio").toLongLong(), Audio(Audio::typeAudioEmpty)) );
+        media.setVideo( videos.value(record.value("mediaVideo").toLongLong(), Video(Video::typeVideoEmpty)) );
+        media.setDocument( documents.value(record.value("mediaDocument").toLongLong(), Document(Document::typeDocumentEmpty)) );
+        media.setPhoto( photos.value(record.value("mediaPhoto").toLongLong()) );
+        media.setGeo( geos.value(record.value("mediaGeo").toLongLong(), GeoPoint(GeoPoint::typeGeoPointEmpty)) );
 
         Peer toPeer( static_cast<Peer::PeerType>(record.value("toPeerType").toLongLong()) );
         if(toPeer.classType() == Peer::typePeerChat)
@@ -306,18 +597,30 @@ void DatabaseCore::readMessages(const DbPeer &dpeer, int offset, int limit)
         DbMessage dmsg;
         dmsg.message = message;
 
-        emit messageFounded(dmsg);
+        messages << dmsg;
+        result << message.id();
+    }
 
-        const QPair<QByteArray, QByteArray> & keys = readMediaKey(message.id());
-        if(!keys.first.isNull())
-            emit mediaKeyFounded(message.id(), keys.first, keys.second);
+    emit messagesFounded(messages);
+
+    QHashIterator<qint64, QPair<QByteArray, QByteArray> > i(keys);
+    while(i.hasNext())
+    {
+        i.next();
+        emit mediaKeyFounded(i.key(), i.value().first, i.value().second);
     }
+
+    return result;
+}
+
+void DatabaseCore::readValue(const QString &key)
+{
+    emit valueFounded(key, value(key));
 }
 
 void DatabaseCore::setValue(const QString &key, const QString &value)
 {
-    QSqlQuery mute_query(p->db);
-    mute_query.prepare("INSERT OR REPLACE INTO general (gkey,gvalue) VALUES (:key,:val)");
+    QSqlQuery &mute_query = prepareQuery(databasecore_insert_value);
     mute_query.bindValue(":key", key);
     mute_query.bindValue(":val", value);
     mute_query.exec();
@@ -334,8 +637,12 @@ QString DatabaseCore::value(const QString &key) const
 void DatabaseCore::deleteMessage(qint64 msgId)
 {
     begin();
-    QSqlQuery query( p->db );
-    query.prepare("DELETE FROM Messages WHERE id=:id" );
+    QSqlQuery &index_query = prepareQuery(databasecore_delete_message_index);
+    index_query.bindValue( ":id" , msgId );
+    if(!index_query.exec())
+        qDebug() << __PRETTY_FUNCTION__ << index_query.lastError();
+
+    QSqlQuery &query = prepareQuery(databasecore_delete_message);
     query.bindValue( ":id" , msgId );
 
     bool res = query.exec();
@@ -346,8 +653,7 @@ void DatabaseCore::deleteMessage(qint64 msgId)
 void DatabaseCore::deleteDialog(qint64 dlgId)
 {
     begin();
-    QSqlQuery query( p->db );
-    query.prepare("DELETE FROM Dialogs WHERE peer=:peer" );
+    QSqlQuery &query = prepareQuery(databasecore_delete_dialog);
     query.bindValue( ":peer" , dlgId );
 
     bool res = query.exec();
@@ -358,11 +664,13 @@ void DatabaseCore::deleteDialog(qint64 dlgId)
 void DatabaseCore::deleteHistory(qint64 dlgId)
 {
     begin();
-    QSqlQuery query( p->db );
-    query.prepare("DELETE FROM Messages WHERE (toPeerType=:ctype AND toId=:peer) OR (toPeerType=:utype AND out=1 AND toId=:peer) OR (toPeerType=:utype AND out=0 AND fromId=:peer)" );
+    QSqlQuery &index_query = prepareQuery(databasecore_delete_history_index);
+    index_query.bindValue( ":peer" , dlgId );
+    if(!index_query.exec())
+        qDebug() << __PRETTY_FUNCTION__ << index_query.lastError();
+
+    QSqlQuery &query = prepareQuery(databasecore_delete_history);
     query.bindValue( ":peer" , dlgId );
-    query.bindValue( ":ctype", static_cast<qint64>(Peer::typePeerChat) );
-    query.bindValue( ":utype", static_cast<qint64>(Peer::typePeerUser) );
 
     bool res = query.exec();
     if(!res)
@@ -372,7 +680,7 @@ void DatabaseCore::deleteHistory(qint64 dlgId)
 void DatabaseCore::readDialogs()
 {
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Dialogs");
+    query.prepare(databasecore_read_dialogs);
 
     bool res = query.exec();
     if(!res)
@@ -418,7 +726,7 @@ void DatabaseCore::readDialogs()
 void DatabaseCore::readUsers()
 {
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Users");
+    query.prepare(databasecore_read_users);
 
     bool res = query.exec();
     if(!res)
@@ -478,7 +786,7 @@ void DatabaseCore::readUsers()
 void DatabaseCore::readChats()
 {
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Chats");
+    query.prepare(databasecore_read_chats);
 
     bool res = query.exec();
     if(!res)
@@ -535,17 +843,72 @@ void DatabaseCore::readChats()
 
 void DatabaseCore::reconnect()
 {
+    p->statements.clear();
     p->db.open();
+    init_profile();
     init_buffer();
     update_db();
 }
 
+void DatabaseCore::init_profile()
+{
+    QStringList pragmas;
+    pragmas << "PRAGMA journal_mode=" + p->journalMode;
+    pragmas << "PRAGMA synchronous=" + p->synchronous;
+    pragmas << "PRAGMA temp_store=" + p->tempStore;
+    // Negative cache_size is read by sqlite as KiB instead of pages.
+    pragmas << "PRAGMA cache_size=" + QString::number(-qAbs(p->cacheSize));
+    pragmas << "PRAGMA mmap_size=" + QString::number(p->mmapSize);
+
+    foreach(const QString &pragma, pragmas)
+    {
+        QSqlQuery query(p->db);
+        query.prepare(pragma);
+        query.exec();
+        CHECK_QUERY_ERROR(query);
+    }
+}
+
+void DatabaseCore::maintenance()
+{
+    commit();
+
+    QStringList queries;
+    if(p->journalMode == "WAL")
+        queries << "PRAGMA wal_checkpoint(TRUNCATE)";
+    if(autoVacuum() == 2)
+        queries << "PRAGMA incremental_vacuum(1024)";
+    if(p->maintenance_count%12 == 0)
+        queries << "ANALYZE";
+
+    foreach(const QString &queryStr, queries)
+    {
+        QSqlQuery query(p->db);
+        query.prepare(queryStr);
+        query.exec();
+        CHECK_QUERY_ERROR(query);
+        while(query.next()) {}
+    }
+
+    p->maintenance_count++;
+}
+
+int DatabaseCore::autoVacuum()
+{
+    QSqlQuery query(p->db);
+    query.prepare("PRAGMA auto_vacuum");
+    query.exec();
+    CHECK_QUERY_ERROR(query);
+
+    return query.next()? query.value(0).toInt() : 0;
+}
+
 void DatabaseCore::init_buffer()
 {
     p->general.clear();
 
     QSqlQuery general_query(p->db);
-    general_query.prepare("SELECT gkey, gvalue FROM general");
+    general_query.prepare(databasecore_read_values);
     general_query.exec();
 
     while( general_query.next() )
@@ -581,10 +944,119 @@ void DatabaseCore::update_db()
 
         db_version = 2;
     }
+    if(db_version == 2)
+    {
+        setValue("version", QString::number(db_version) );
+        commit();
+
+        // auto_vacuum only changes on existing files after a full VACUUM.
+        // That rebuild is only worth it while the file is still small, big
+        // histories keep their mode and maintenance skips incremental_vacuum.
+        if(QFileInfo(p->path).size() < DATABASE_VACUUM_LIMIT)
+        {
+            QSqlQuery vacuum_mode(p->db);
+            vacuum_mode.prepare("PRAGMA auto_vacuum=INCREMENTAL");
+            vacuum_mode.exec();
+
+            QSqlQuery vacuum(p->db);
+            vacuum.prepare("VACUUM");
+            vacuum.exec();
+            CHECK_QUERY_ERROR(vacuum);
+        }
+
+        db_version = 3;
+    }
+    if(db_version == 3)
+    {
+        QStringList queries;
+        if(!columnExists("Messages", "dialogId"))
+            queries << "ALTER TABLE Messages ADD COLUMN dialogId BIGINT";
+        queries << "UPDATE Messages SET dialogId = CASE WHEN toPeerType=:ctype OR out=1 THEN toId ELSE fromId END";
+        queries << "CREATE INDEX IF NOT EXISTS \"Messages.dialogId_id_idx\" ON \"Messages\"(\"dialogId\", \"id\" DESC)";
+        queries << "DROP INDEX IF EXISTS \"Messages.message_idx\"";
+        queries << "DROP INDEX IF EXISTS \"Messages.out_idx\"";
+
+        QVariantHash binds;
+        binds[":ctype"] = static_cast<qint64>(Peer::typePeerChat);
+
+        if(!updateStep(4, queries, binds))
+            return;
+
+        db_version = 4;
+    }
+    if(db_version == 4)
+    {
+        QStringList queries;
+        queries << "CREATE VIRTUAL TABLE IF NOT EXISTS MessagesIndex USING fts4(message, tokenize=unicode61)";
+        queries << "DELETE FROM MessagesIndex";
+        queries << "INSERT INTO MessagesIndex (docid, message) SELECT id, message FROM Messages WHERE message IS NOT NULL AND message<>''";
+
+        if(!updateStep(5, queries))
+            return;
+
+        db_version = 5;
+    }
 
     setValue("version", QString::number(db_version) );
 }
 
+bool DatabaseCore::updateStep(int version, const QStringList &queries, const QVariantHash &binds)
+{
+    // A step and its version bump commit together, so an interrupted
+    // update is simply run again from the previous version.
+    commit();
+    p->db.transaction();
+
+    foreach(const QString &queryStr, queries)
+    {
+        QSqlQuery query(p->db);
+        query.prepare(queryStr);
+
+        QHashIterator<QString,QVariant> i(binds);
+        while(i.hasNext())
+        {
+            i.next();
+            if(queryStr.contains(i.key()))
+                query.bindValue(i.key(), i.value());
+        }
+
+        if(!query.exec())
+        {
+            qDebug() << __PRETTY_FUNCTION__ << version << query.lastError();
+            p->db.rollback();
+            return false;
+        }
+    }
+
+    QSqlQuery version_query(p->db);
+    version_query.prepare(databasecore_insert_value);
+    version_query.bindValue(":key", "version");
+    version_query.bindValue(":val", QString::number(version));
+    if(!version_query.exec() || !p->db.commit())
+    {
+        qDebug() << __PRETTY_FUNCTION__ << version << version_query.lastError();
+        p->db.rollback();
+        return false;
+    }
+
+    p->general["version"] = QString::number(version);
+    return true;
+}
+
+bool DatabaseCore::columnExists(const QString &table, const QString &column)
+{
+    QSqlQuery query(p->db);
+    query.prepare("PRAGMA table_info(" + table + ")");
+    query.exec();
+    CHECK_QUERY_ERROR(query);
+
+    while(query.next())
+        if(query.record().value("name").toString() == column)
+            return true;
+
+    return false;
+}
+
 void DatabaseCore::update_moveFiles()
 {
     const QString & dpath = AsemanApplication::homePath() + "/" + p->phoneNumber + "/downloads";
@@ -753,10 +1225,7 @@ void DatabaseCore::insertAudio(const Audio &audio)
     if(audio.id() == 0 || audio.classType() == Audio::typeAudioEmpty)
         return;
 
-    begin();
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Audios (id, dcId, mimeType, duration, date, size, accessHash, userId, type) "
-                  "VALUES (:id, :dcId, :mimeType, :duration, :date, :size, :accessHash, :userId, :type);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_audio);
 
     query.bindValue(":id", audio.id());
     query.bindValue(":dcId", audio.dcId());
@@ -781,10 +1250,7 @@ void DatabaseCore::insertVideo(const Video &video)
     if(video.id() == 0 || video.classType() == Video::typeVideoEmpty)
         return;
 
-    begin();
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Videos (id, dcId, caption, mimeType, date, duration, h, size, accessHash, userId, w, type) "
-                  "VALUES (:id, :dcId, :caption, :mimeType, :date, :duration, :h, :size, :accessHash, :userId, :w, :type);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_video);
 
     query.bindValue(":id", video.id());
     query.bindValue(":dcId", video.dcId());
@@ -814,10 +1280,7 @@ void DatabaseCore::insertDocument(const Document &document)
     if(document.id() == 0 || document.classType() == Document::typeDocumentEmpty)
         return;
 
-    begin();
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Documents (id, dcId, mimeType, date, fileName, size, accessHash, userId, type) "
-                  "VALUES (:id, :dcId, :mimeType, :date, :fileName, :size, :accessHash, :userId, :type);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_document);
 
     query.bindValue(":id", document.id());
     query.bindValue(":dcId", document.dcId());
@@ -844,10 +1307,7 @@ void DatabaseCore::insertGeo(int id, const GeoPoint &geo)
     if(id == 0 || geo.classType() == GeoPoint::typeGeoPointEmpty)
         return;
 
-    begin();
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Audios (id, longitude, lat) "
-                  "VALUES (:id, :longitude, :lat);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_geo);
 
     query.bindValue(":id", id);
     query.bindValue(":longitude", geo.longitude());
@@ -866,10 +1326,7 @@ void DatabaseCore::insertPhoto(const Photo &photo)
     if(photo.id() == 0 || photo.classType() == Photo::typePhotoEmpty)
         return;
 
-    begin();
-    QSqlQuery query(p->db);
-    query.prepare("INSERT OR REPLACE INTO Photos (id, caption, date, accessHash, userId) "
-                  "VALUES (:id, :caption, :date, :accessHash, :userId);");
+    QSqlQuery &query = prepareQuery(databasecore_insert_photo);
 
     query.bindValue(":id", photo.id());
     query.bindValue(":caption", photo.caption());
@@ -889,15 +1346,12 @@ void DatabaseCore::insertPhoto(const Photo &photo)
 
 void DatabaseCore::insertPhotoSize(qint64 pid, const QList<PhotoSize> &sizes)
 {
-    begin();
     foreach(const PhotoSize &size, sizes)
     {
         if(size.classType() == PhotoSize::typePhotoSizeEmpty)
             continue;
 
-        QSqlQuery query(p->db);
-        query.prepare("INSERT OR REPLACE INTO PhotoSizes (pid, h, type, size, w, locationLocalId, locationSecret, locationDcId, locationVolumeId) "
-                      "VALUES (:pid, :h, :type, :size, :w, :locationLocalId, :locationSecret, :locationDcId, :locationVolumeId);");
+        QSqlQuery &query = prepareQuery(databasecore_insert_photo_size);
 
         query.bindValue(":pid", pid);
         query.bindValue(":h", size.h());
@@ -917,191 +1371,202 @@ void DatabaseCore::insertPhotoSize(qint64 pid, const QList<PhotoSize> &sizes)
     }
 }
 
-Audio DatabaseCore::readAudio(qint64 id)
+QHash<qint64, Audio> DatabaseCore::readAudios(const QSet<qint64> &ids)
 {
-    Audio audio(Audio::typeAudioEmpty);
-    if(!id)
-        return audio;
+    QHash<qint64, Audio> result;
+    if(ids.isEmpty() || (ids.count() == 1 && ids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Audios WHERE id=:id");
-    query.bindValue(":id", id);
+    query.prepare(QString(databasecore_read_audios).arg(idsToString(ids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return audio;
+        return result;
     }
 
-    if(!query.next())
-        return audio;
-
-    const QSqlRecord &record = query.record();
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    audio.setId( record.value("id").toLongLong() );
-    audio.setDcId( record.value("dcId").toLongLong() );
-    audio.setMimeType( record.value("mimeType").toString() );
-    audio.setDuration( record.value("duration").toLongLong() );
-    audio.setDate( record.value("date").toLongLong() );
-    audio.setSize( record.value("size").toLongLong() );
-    audio.setAccessHash( record.value("accessHash").toLongLong() );
-    audio.setUserId( record.value("userId").toLongLong() );
-    audio.setClassType( static_cast<Audio::AudioType>(record.value("type").toLongLong()) );
+        Audio audio(Audio::typeAudioEmpty);
+        audio.setId( record.value("id").toLongLong() );
+        audio.setDcId( record.value("dcId").toLongLong() );
+        audio.setMimeType( record.value("mimeType").toString() );
+        audio.setDuration( record.value("duration").toLongLong() );
+        audio.setDate( record.value("date").toLongLong() );
+        audio.setSize( record.value("size").toLongLong() );
+        audio.setAccessHash( record.value("accessHash").toLongLong() );
+        audio.setUserId( record.value("userId").toLongLong() );
+        audio.setClassType( static_cast<Audio::AudioType>(record.value("type").toLongLong()) );
+
+        result[audio.id()] = audio;
+    }
 
-    return audio;
+    return result;
 }
 
-Video DatabaseCore::readVideo(qint64 id)
+QHash<qint64, Video> DatabaseCore::readVideos(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes)
 {
-    Video video(Video::typeVideoEmpty);
-    if(!id)
-        return video;
+    QHash<qint64, Video> result;
+    if(ids.isEmpty() || (ids.count() == 1 && ids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Videos WHERE id=:id");
-    query.bindValue(":id", id);
+    query.prepare(QString(databasecore_read_videos).arg(idsToString(ids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return video;
+        return result;
     }
 
-    if(!query.next())
-        return video;
-
-    const QSqlRecord &record = query.record();
-
-    video.setId( record.value("id").toLongLong() );
-    video.setDcId( record.value("dcId").toLongLong() );
-    video.setMimeType( record.value("mimeType").toString() );
-    video.setCaption( record.value("caption").toString() );
-    video.setDate( record.value("date").toLongLong() );
-    video.setDuration( record.value("duration").toLongLong() );
-    video.setSize( record.value("size").toLongLong() );
-    video.setW( record.value("w").toLongLong() );
-    video.setH( record.value("h").toLongLong() );
-    video.setAccessHash( record.value("accessHash").toLongLong() );
-    video.setUserId( record.value("userId").toLongLong() );
-    video.setClassType( static_cast<Video::VideoType>(record.value("type").toLongLong()) );
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    const QList<PhotoSize> &sizes = readPhotoSize(video.id());
-    if(!sizes.isEmpty())
-        video.setThumb(sizes.first());
+        Video video(Video::typeVideoEmpty);
+        video.setId( record.value("id").toLongLong() );
+        video.setDcId( record.value("dcId").toLongLong() );
+        video.setMimeType( record.value("mimeType").toString() );
+        video.setCaption( record.value("caption").toString() );
+        video.setDate( record.value("date").toLongLong() );
+        video.setDuration( record.value("duration").toLongLong() );
+        video.setSize( record.value("size").toLongLong() );
+        video.setW( record.value("w").toLongLong() );
+        video.setH( record.value("h").toLongLong() );
+        video.setAccessHash( record.value("accessHash").toLongLong() );
+        video.setUserId( record.value("userId").toLongLong() );
+        video.setClassType( static_cast<Video::VideoType>(record.value("type").toLongLong()) );
+
+        const QList<PhotoSize> &thumbs = sizes.value(video.id());
+        if(!thumbs.isEmpty())
+            video.setThumb(thumbs.first());
+
+        result[video.id()] = video;
+    }
 
-    return video;
+    return result;
 }
 
-Document DatabaseCore::readDocument(qint64 id)
+QHash<qint64, Document> DatabaseCore::readDocuments(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes)
 {
-    Document document(Document::typeDocumentEmpty);
-    if(!id)
-        return document;
+    QHash<qint64, Document> result;
+    if(ids.isEmpty() || (ids.count() == 1 && ids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Documents WHERE id=:id");
-    query.bindValue(":id", id);
+    query.prepare(QString(databasecore_read_documents).arg(idsToString(ids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return document;
+        return result;
     }
 
-    if(!query.next())
-        return document;
-
-    const QSqlRecord &record = query.record();
-
-    document.setId( record.value("id").toLongLong() );
-    document.setDcId( record.value("dcId").toLongLong() );
-    document.setMimeType( record.value("mimeType").toString() );
-    document.setDate( record.value("date").toLongLong() );
-    document.setFileName( record.value("fileName").toString() );
-    document.setSize( record.value("size").toLongLong() );
-    document.setAccessHash( record.value("accessHash").toLongLong() );
-    document.setUserId( record.value("userId").toLongLong() );
-    document.setClassType( static_cast<Document::DocumentType>(record.value("type").toLongLong()) );
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    const QList<PhotoSize> &sizes = readPhotoSize(document.id());
-    if(!sizes.isEmpty())
-        document.setThumb(sizes.first());
+        Document document(Document::typeDocumentEmpty);
+        document.setId( record.value("id").toLongLong() );
+        document.setDcId( record.value("dcId").toLongLong() );
+        document.setMimeType( record.value("mimeType").toString() );
+        document.setDate( record.value("date").toLongLong() );
+        document.setFileName( record.value("fileName").toString() );
+        document.setSize( record.value("size").toLongLong() );
+        document.setAccessHash( record.value("accessHash").toLongLong() );
+        document.setUserId( record.value("userId").toLongLong() );
+        document.setClassType( static_cast<Document::DocumentType>(record.value("type").toLongLong()) );
+
+        const QList<PhotoSize> &thumbs = sizes.value(document.id());
+        if(!thumbs.isEmpty())
+            document.setThumb(thumbs.first());
+
+        result[document.id()] = document;
+    }
 
-    return document;
+    return result;
 }
 
-GeoPoint DatabaseCore::readGeo(qint64 id)
+QHash<qint64, GeoPoint> DatabaseCore::readGeos(const QSet<qint64> &ids)
 {
-    GeoPoint geo(GeoPoint::typeGeoPointEmpty);
-    if(!id)
-        return geo;
+    QHash<qint64, GeoPoint> result;
+    if(ids.isEmpty() || (ids.count() == 1 && ids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Geos WHERE id=:id");
-    query.bindValue(":id", id);
+    query.prepare(QString(databasecore_read_geos).arg(idsToString(ids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return geo;
+        return result;
     }
 
-    if(!query.next())
-        return geo;
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    const QSqlRecord &record = query.record();
+        GeoPoint geo(GeoPoint::typeGeoPoint);
+        geo.setLongitude( record.value("longitude").toDouble() );
+        geo.setLat( record.value("lat").toDouble() );
 
-    geo.setLongitude( record.value("longitude").toDouble() );
-    geo.setLat( record.value("lat").toDouble() );
-    geo.setClassType(GeoPoint::typeGeoPoint);
+        result[record.value("id").toLongLong()] = geo;
+    }
 
-    return geo;
+    return result;
 }
 
-Photo DatabaseCore::readPhoto(qint64 id)
+QHash<qint64, Photo> DatabaseCore::readPhotos(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes)
 {
-    Photo photo;
-    if(!id)
-        return photo;
+    QHash<qint64, Photo> result;
+    if(ids.isEmpty() || (ids.count() == 1 && ids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM Photos WHERE id=:id");
-    query.bindValue(":id", id);
+    query.prepare(QString(databasecore_read_photos).arg(idsToString(ids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return photo;
+        return result;
     }
 
-    if(!query.next())
-        return photo;
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    const QSqlRecord &record = query.record();
+        Photo photo;
+        photo.setId( record.value("id").toLongLong() );
+        photo.setCaption( record.value("caption").toString() );
+        photo.setDate( record.value("date").toLongLong() );
+        photo.setAccessHash( record.value("accessHash").toLongLong() );
+        photo.setUserId( record.value("userId").toLongLong() );
+        photo.setSizes( sizes.value(photo.id()) );
+        photo.setClassType(Photo::typePhoto);
 
-    photo.setId( record.value("id").toLongLong() );
-    photo.setCaption( record.value("caption").toString() );
-    photo.setDate( record.value("date").toLongLong() );
-    photo.setAccessHash( record.value("accessHash").toLongLong() );
-    photo.setUserId( record.value("userId").toLongLong() );
-    photo.setSizes( readPhotoSize(id) );
-    photo.setClassType(Photo::typePhoto);
+        result[photo.id()] = photo;
+    }
 
-    return photo;
+    return result;
 }
 
-QPair<QByteArray, QByteArray> DatabaseCore::readMediaKey(qint64 mediaId)
+QHash<qint64, QPair<QByteArray, QByteArray> > DatabaseCore::readMediaKeys(const QSet<qint64> &ids)
 {
-    QPair<QByteArray, QByteArray> result;
+    QHash<qint64, QPair<QByteArray, QByteArray> > result;
+    if(ids.isEmpty())
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM MediaKeys WHERE id=:id");
-    query.bindValue(":id", mediaId);
+    query.prepare(QString(databasecore_read_media_keys).arg(idsToString(ids)));
+
     bool res = query.exec();
     if(!res)
     {
@@ -1109,32 +1574,32 @@ QPair<QByteArray, QByteArray> DatabaseCore::readMediaKey(qint64 mediaId)
         return result;
     }
 
-    if(!query.next())
-        return result;
-
-    const QSqlRecord &record = query.record();
+    while(query.next())
+    {
+        const QSqlRecord &record = query.record();
 
-    result.first = record.value("key").toByteArray();
-    result.second = record.value("iv").toByteArray();
+        QPair<QByteArray, QByteArray> &keys = result[record.value("id").toLongLong()];
+        keys.first = record.value("key").toByteArray();
+        keys.second = record.value("iv").toByteArray();
+    }
 
     return result;
 }
 
-QList<PhotoSize> DatabaseCore::readPhotoSize(qint64 pid)
+QHash<qint64, QList<PhotoSize> > DatabaseCore::readPhotoSizes(const QSet<qint64> &pids)
 {
-    QList<PhotoSize> list;
-    if(!pid)
-        return list;
+    QHash<qint64, QList<PhotoSize> > result;
+    if(pids.isEmpty() || (pids.count() == 1 && pids.contains(0)))
+        return result;
 
     QSqlQuery query(p->db);
-    query.prepare("SELECT * FROM PhotoSizes WHERE pid=:pid");
-    query.bindValue(":pid", pid);
+    query.prepare(QString(databasecore_read_photo_sizes).arg(idsToString(pids)));
 
     bool res = query.exec();
     if(!res)
     {
         qDebug() << __PRETTY_FUNCTION__ << query.lastError();
-        return list;
+        return result;
     }
 
     while(query.next())
@@ -1154,10 +1619,75 @@ QList<PhotoSize> DatabaseCore::readPhotoSize(qint64 pid)
         psize.setSize( record.value("size").toLongLong() );
         psize.setLocation(location);
 
-        list.prepend( psize );
+        result[record.value("pid").toLongLong()].prepend( psize );
     }
 
-    return list;
+    return result;
+}
+
+QString DatabaseCore::idsToString(const QSet<qint64> &ids)
+{
+    QStringList list;
+    foreach(const qint64 id, ids)
+        list << QString::number(id);
+
+    return list.join(",");
+}
+
+void DatabaseCore::explainQueryPlans()
+{
+    for(int i=0; databasecore_queries[i]; i++)
+    {
+        QString queryStr = databasecore_queries[i];
+        if(queryStr.contains("%1"))
+            queryStr = queryStr.arg("1,2,3");
+
+        QSqlQuery query(p->db);
+        query.prepare("EXPLAIN QUERY PLAN " + queryStr);
+
+        QRegExp placeholder(":\\w+");
+        int pos = 0;
+        while((pos = placeholder.indexIn(queryStr, pos)) != -1)
+        {
+            // A MATCH needs a term to plan the full text lookup
+            query.bindValue(placeholder.cap(0), placeholder.cap(0) == ":match"? QVariant("\"word*\"") : QVariant(0));
+            pos += placeholder.matchedLength();
+        }
+
+        if(!query.exec())
+        {
+            qDebug() << __PRETTY_FUNCTION__ << queryStr << query.lastError();
+            continue;
+        }
+
+        qDebug() << queryStr;
+        while(query.next())
+            qDebug() << "   " << query.value("detail").toString();
+    }
+}
+
+void DatabaseCore::readStatementStats()
+{
+    emit statementStatsFounded(p->statements_prepared, p->statement_lookups);
+}
+
+QSqlQuery &DatabaseCore::prepareQuery(const QString &queryStr)
+{
+    p->statement_lookups++;
+    return cachedQuery(queryStr);
+}
+
+QSqlQuery &DatabaseCore::cachedQuery(const QString &queryStr)
+{
+    QHash<QString,QSqlQuery>::iterator i = p->statements.find(queryStr);
+    if(i != p->statements.end())
+        return i.value();
+
+    i = p->statements.insert(queryStr, QSqlQuery(p->db));
+    i.value().prepare(queryStr);
+    p->statements_prepared++;
+
+    return i.value();
 }
 
 void DatabaseCore::begin()
@@ -1169,8 +1699,8 @@ void DatabaseCore::begin()
         return;
     }
 
-    QSqlQuery query( p->db );
-    query.prepare( "BEGIN" );
+    // Transaction statements stay out of the lookup count
+    QSqlQuery &query = cachedQuery( "BEGIN" );
     query.exec();
 
     p->commit_timer = startTimer(1000);
@@ -1181,8 +1711,7 @@ void DatabaseCore::commit()
     if(!p->commit_timer)
         return;
 
-    QSqlQuery query( p->db );
-    query.prepare( "COMMIT" );
+    QSqlQuery &query = cachedQuery( "COMMIT" );
     query.exec();
 
     killTimer(p->commit_timer);
@@ -1195,6 +1724,11 @@ void DatabaseCore::timerEvent(QTimerEvent *e)
     {
         commit();
     }
+    else
+    if(e->timerId() == p->maintenance_timer)
+    {
+        maintenance();
+    }
 }
 
 DatabaseCore::~DatabaseCore()
@@ -2,6 +2,10 @@
 #define DATABASECORE_H
 
 #include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
 #include <types/types.h>
 
 class DbChat { public: DbChat(): chat(Chat::typeChatEmpty){} Chat chat; };
@@ -10,6 +14,7 @@ class DbDialog { public: DbDialog(): dialog(){} Dialog dialog; };
 class DbMessage { public: DbMessage(): message(){} Message message; };
 class DbPeer { public: DbPeer(): peer(Peer::typePeerUser){} Peer peer; };
 
+class QSqlQuery;
 class DatabaseCorePrivate;
 class DatabaseCore : public QObject
 {
@@ -19,6 +24,7 @@ public:
     ~DatabaseCore();
 
 public slots:
+    void init();
     void reconnect();
     void disconnect();
 
@@ -26,13 +32,22 @@ public slots:
     void insertChat(const DbChat &chat);
     void insertDialog(const DbDialog &dialog, bool encrypted);
     void insertMessage(const DbMessage &message);
+    void insertUsers(const QList<DbUser> &users);
+    void insertChats(const QList<DbChat> &chats);
+    void insertMessages(const QList<DbMessage> &messages);
     void insertMediaEncryptedKeys(qint64 mediaId, const QByteArray &key, const QByteArray &iv);
 
     void readFullDialogs();
-    void readMessages(const DbPeer &peer, int offset, int limit);
+    void readMessages(const DbPeer &peer, qint64 lastId, int limit);
+    void readMessagesById(const QList<qint64> &ids);
+    void searchMessages(const QString &keyword, int limit);
 
     void setValue(const QString &key, const QString &value);
     QString value(const QString &key) const;
+    void readValue(const QString &key);
+
+    void explainQueryPlans();
+    void readStatementStats();
 
     void deleteMessage(qint64 msgId);
     void deleteDialog(qint64 dlgId);
@@ -42,17 +57,24 @@ signals:
     void userFounded(const DbUser &user);
     void chatFounded(const DbChat &chat);
     void dialogFounded(const DbDialog &dialog, bool encrypted);
-    void messageFounded(const DbMessage &message);
+    void messagesFounded(const QList<DbMessage> &messages);
     void mediaKeyFounded(qint64 mediaId, const QByteArray &key, const QByteArray &iv);
+    void messagesSearched(const QString &keyword, const QList<qint64> &messages);
     void valueChanged(const QString &value);
+    void valueFounded(const QString &key, const QString &value);
+    void statementStatsFounded(qint64 prepared, qint64 lookups);
 
 private:
     void readDialogs();
     void readUsers();
     void readChats();
 
+    void init_profile();
+    int autoVacuum();
     void init_buffer();
     void update_db();
+    bool updateStep(int version, const QStringList &queries, const QVariantHash &binds = QVariantHash());
+    bool columnExists(const QString &table, const QString &column);
     void update_moveFiles();
     QHash<qint64, QStringList> userFiles();
     QHash<qint64, QStringList> userFilesOf(const QString &mediaColumn);
@@ -62,6 +84,11 @@ private:
     QList<qint32> stringToUsers(const QString &str);
     QString usersToString( const QList<qint32> &users );
 
+    void writeUser(const User &user);
+    void writeChat(const Chat &chat);
+    void writeMessage(const Message &message);
+    void insertMessageIndex(const Message &message);
+
     void insertAudio(const Audio &audio);
     void insertVideo(const Video &video);
     void insertDocument(const Document &document);
@@ -69,16 +96,22 @@ private:
     void insertPhoto(const Photo &photo);
     void insertPhotoSize(qint64 pid, const QList<PhotoSize> &sizes);
 
-    Audio readAudio(qint64 id);
-    Video readVideo(qint64 id);
-    Document readDocument(qint64 id);
-    GeoPoint readGeo(qint64 id);
-    Photo readPhoto(qint64 id);
-    QPair<QByteArray, QByteArray> readMediaKey(qint64 mediaId);
-    QList<PhotoSize> readPhotoSize(qint64 pid);
+    QHash<qint64, Audio> readAudios(const QSet<qint64> &ids);
+    QHash<qint64, Video> readVideos(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes);
+    QHash<qint64, Document> readDocuments(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes);
+    QHash<qint64, GeoPoint> readGeos(const QSet<qint64> &ids);
+    QHash<qint64, Photo> readPhotos(const QSet<qint64> &ids, const QHash<qint64, QList<PhotoSize> > &sizes);
+    QHash<qint64, QPair<QByteArray, QByteArray> > readMediaKeys(const QSet<qint64> &ids);
+    QHash<qint64, QList<PhotoSize> > readPhotoSizes(const QSet<qint64> &pids);
+    QString idsToString(const QSet<qint64> &ids);
+    QList<qint64> fetchMessages(QSqlQuery &query);
+
+    QSqlQuery &prepareQuery(const QString &queryStr);
+    QSqlQuery &cachedQuery(const QString &queryStr);
 
     void begin();
     void commit();
+    void maintenance();
 
 protected:
     void timerEvent(QTimerEvent *e);
@@ -91,6 +124,9 @@ Q_DECLARE_METATYPE(DbUser)
 Q_DECLARE_METATYPE(DbChat)
 Q_DECLARE_METATYPE(DbDialog)
 Q_DECLARE_METATYPE(DbMessage)
+Q_DECLARE_METATYPE(QList<DbUser>)
+Q_DECLARE_METATYPE(QList<DbChat>)
+Q_DECLARE_METATYPE(QList<DbMessage>)
 Q_DECLARE_METATYPE(DbPeer)
 
 #endif // DATABASECORE_H
@@ -1,6 +1,7 @@
 #include "dialogfilesmodel.h"
 #include "telegramqml.h"
 #include "objects/types.h"
+#include "asemantools/asemanlistdiff.h"
 
 class DialogFilesModelPrivate
 {
@@ -113,53 +114,7 @@ void DialogFilesModel::refresh()
     if(p->dialog && p->telegram)
         list = QDir(dirPath()).entryList(QDir::Files, QDir::Time|QDir::Reversed);
 
-    for( int i=0 ; i<p->list.count() ; i++ )
-    {
-        const QString & dId = p->list.at(i);
-        if( list.contains(dId) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->list.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
-
-
-    QList<QString> temp_msgs = list;
-    for( int i=0 ; i<temp_msgs.count() ; i++ )
-    {
-        const QString & dId = temp_msgs.at(i);
-        if( p->list.contains(dId) )
-            continue;
-
-        temp_msgs.removeAt(i);
-        i--;
-    }
-    while( p->list != temp_msgs )
-        for( int i=0 ; i<p->list.count() ; i++ )
-        {
-            const QString & dId = p->list.at(i);
-            int nw = temp_msgs.indexOf(dId);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->list.move( i, nw );
-            endMoveRows();
-        }
-
-
-    for( int i=0 ; i<list.count() ; i++ )
-    {
-        const QString & dId = list.at(i);
-        if( p->list.contains(dId) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->list.insert( i, dId );
-        endInsertRows();
-    }
+    AsemanListDiff::apply(this, p->list, list);
 
     emit countChanged();
 }
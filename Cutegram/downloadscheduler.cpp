@@ -0,0 +1,257 @@
+#include "downloadscheduler.h"
+#include "cutegramenums.h"
+#include "objects/types.h"
+#include "asemantools/asemanapplication.h"
+
+#include <telegram.h>
+#include <QPointer>
+#include <QHash>
+#include <QSettings>
+
+class DownloadSchedulerJob
+{
+public:
+    DownloadSchedulerJob(): fileSize(0), dcId(0), priority(0), sequence(0), fileId(0) {}
+
+    QString name;
+    InputFileLocation input;
+    qint32 fileSize;
+    qint32 dcId;
+    QByteArray key;
+    QByteArray iv;
+    int priority;
+    qint64 sequence;
+    qint64 fileId;
+    QHash<FileLocationObject*, int> waiters;
+};
+
+class DownloadSchedulerPrivate
+{
+public:
+    QPointer<Telegram> telegram;
+
+    QHash<QString, DownloadSchedulerJob*> jobs;
+    QHash<FileLocationObject*, DownloadSchedulerJob*> locations;
+    QList<DownloadSchedulerJob*> queue;
+    QHash<qint64, DownloadSchedulerJob*> active;
+    QHash<qint32, int> dc_active;
+
+    qint64 sequence;
+    int max_active;
+    int max_per_dc;
+};
+
+QString downloadSchedulerName(FileLocationObject *l, const InputFileLocation &input)
+{
+    return QString("%1:%2:%3:%4:%5").arg(input.classType()).arg(l->dcId()).arg(l->volumeId())
+            .arg(l->localId()).arg(l->id());
+}
+
+DownloadScheduler::DownloadScheduler(QObject *parent) :
+    QObject(parent)
+{
+    p = new DownloadSchedulerPrivate;
+    p->sequence = 0;
+    p->max_active = qMax(1, AsemanApplication::settings()->value("Downloads/maxActive", 6).toInt());
+    p->max_per_dc = qMax(1, AsemanApplication::settings()->value("Downloads/maxPerDc", 3).toInt());
+}
+
+void DownloadScheduler::setTelegram(Telegram *telegram)
+{
+    p->telegram = telegram;
+    schedule();
+}
+
+void DownloadScheduler::request(FileLocationObject *l, const InputFileLocation &input, qint32 fileSize, const QByteArray &key, const QByteArray &iv, int priority)
+{
+    const QString &name = downloadSchedulerName(l, input);
+    DownloadSchedulerJob *job = p->jobs.value(name);
+    if(!job)
+    {
+        job = new DownloadSchedulerJob;
+        job->name = name;
+        job->input = input;
+        job->fileSize = fileSize;
+        job->dcId = l->dcId();
+        job->key = key;
+        job->iv = iv;
+        job->priority = priority;
+        job->sequence = p->sequence++;
+
+        p->jobs[name] = job;
+        p->queue << job;
+    }
+    else
+        job->priority = qMin(job->priority, priority);
+
+    DownloadSchedulerJob *old = p->locations.value(l);
+    if(old && old != job)
+        drop(l, true);
+    if(!job->waiters.contains(l))
+    {
+        connect(l, SIGNAL(destroyed(QObject*)), SLOT(locationDestroyed(QObject*)), Qt::UniqueConnection);
+        if(job->fileId)
+            l->download()->setFileId(job->fileId);
+    }
+
+    job->waiters[l]++;
+    p->locations[l] = job;
+
+    schedule();
+}
+
+bool DownloadScheduler::retain(FileLocationObject *l)
+{
+    DownloadSchedulerJob *job = p->locations.value(l);
+    if(!job)
+        return false;
+
+    job->waiters[l]++;
+    return true;
+}
+
+void DownloadScheduler::release(FileLocationObject *l)
+{
+    QHash<FileLocationObject*, DownloadSchedulerJob*>::iterator i = p->locations.find(l);
+    if(i == p->locations.end())
+        return;
+
+    DownloadSchedulerJob *job = i.value();
+    if(--job->waiters[l] > 0)
+        return;
+
+    drop(l, true);
+}
+
+void DownloadScheduler::locationDestroyed(QObject *obj)
+{
+    drop(static_cast<FileLocationObject*>(obj), false);
+}
+
+void DownloadScheduler::drop(FileLocationObject *l, bool alive)
+{
+    DownloadSchedulerJob *job = p->locations.take(l);
+    if(!job)
+        return;
+
+    job->waiters.remove(l);
+    if(alive)
+    {
+        disconnect(l, SIGNAL(destroyed(QObject*)), this, SLOT(locationDestroyed(QObject*)));
+        if(job->fileId)
+            l->download()->setFileId(0);
+    }
+
+    if(!job->waiters.isEmpty())
+        return;
+
+    if(!job->fileId)
+    {
+        p->queue.removeAll(job);
+        p->jobs.remove(job->name);
+        delete job;
+    }
+    else
+    // Nobody looks at it anymore, files the user asked for keep going
+    if(job->priority != CutegramEnums::DownloadPriorityFile && p->telegram)
+        p->telegram->uploadCancelFile(job->fileId);
+}
+
+void DownloadScheduler::finished(qint64 fileId)
+{
+    DownloadSchedulerJob *job = p->active.take(fileId);
+    if(!job)
+        return;
+
+    p->dc_active[job->dcId]--;
+    foreach(FileLocationObject *l, job->waiters.keys())
+    {
+        disconnect(l, SIGNAL(destroyed(QObject*)), this, SLOT(locationDestroyed(QObject*)));
+        p->locations.remove(l);
+    }
+
+    p->jobs.remove(job->name);
+    delete job;
+
+    schedule();
+}
+
+void DownloadScheduler::clear()
+{
+    foreach(FileLocationObject *l, p->locations.keys())
+        disconnect(l, SIGNAL(destroyed(QObject*)), this, SLOT(locationDestroyed(QObject*)));
+
+    qDeleteAll(p->jobs);
+    p->jobs.clear();
+    p->locations.clear();
+    p->queue.clear();
+    p->active.clear();
+    p->dc_active.clear();
+}
+
+QList<FileLocationObject *> DownloadScheduler::locations(qint64 fileId) const
+{
+    DownloadSchedulerJob *job = p->active.value(fileId);
+    if(!job)
+        return QList<FileLocationObject*>();
+
+    return job->waiters.keys();
+}
+
+int DownloadScheduler::activeCount() const
+{
+    return p->active.count();
+}
+
+int DownloadScheduler::queuedCount() const
+{
+    return p->queue.count();
+}
+
+void DownloadScheduler::schedule()
+{
+    if(!p->telegram)
+        return;
+
+    while(p->active.count() < p->max_active)
+    {
+        // Highest priority first, oldest request first inside a class
+        int next = -1;
+        for(int i=0; i<p->queue.count(); i++)
+        {
+            DownloadSchedulerJob *job = p->queue.at(i);
+            if(p->dc_active.value(job->dcId) >= p->max_per_dc)
+                continue;
+            if(next != -1)
+            {
+                DownloadSchedulerJob *best = p->queue.at(next);
+                if(best->priority < job->priority)
+                    continue;
+                if(best->priority == job->priority && best->sequence < job->sequence)
+                    continue;
+            }
+
+            next = i;
+        }
+
+        if(next == -1)
+            break;
+
+        DownloadSchedulerJob *job = p->queue.takeAt(next);
+        job->fileId = p->telegram->uploadGetFile(job->input, job->fileSize, job->dcId, job->key, job->iv);
+        p->active[job->fileId] = job;
+        p->dc_active[job->dcId]++;
+
+        QList<FileLocationObject*> waiters = job->waiters.keys();
+        foreach(FileLocationObject *l, waiters)
+            l->download()->setFileId(job->fileId);
+
+        emit started(job->fileId, waiters.first());
+    }
+}
+
+DownloadScheduler::~DownloadScheduler()
+{
+    clear();
+    delete p;
+}
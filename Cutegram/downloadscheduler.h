@@ -0,0 +1,45 @@
+#ifndef DOWNLOADSCHEDULER_H
+#define DOWNLOADSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include "types/inputfilelocation.h"
+
+class Telegram;
+class FileLocationObject;
+class DownloadSchedulerPrivate;
+class DownloadScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    DownloadScheduler(QObject *parent = 0);
+    ~DownloadScheduler();
+
+    void setTelegram(Telegram *telegram);
+
+    void request(FileLocationObject *location, const InputFileLocation &input, qint32 fileSize,
+                 const QByteArray &key, const QByteArray &iv, int priority);
+    bool retain(FileLocationObject *location);
+    void release(FileLocationObject *location);
+    void finished(qint64 fileId);
+    void clear();
+
+    QList<FileLocationObject*> locations(qint64 fileId) const;
+    int activeCount() const;
+    int queuedCount() const;
+
+signals:
+    void started(qint64 fileId, FileLocationObject *location);
+
+private slots:
+    void locationDestroyed(QObject *obj);
+
+private:
+    void schedule();
+    void drop(FileLocationObject *location, bool alive);
+
+private:
+    DownloadSchedulerPrivate *p;
+};
+
+#endif // DOWNLOADSCHEDULER_H
@@ -0,0 +1,60 @@
+#include "downloadsink.h"
+#include "downloadsinkcore.h"
+
+#include <QThread>
+
+class DownloadSinkPrivate
+{
+public:
+    QThread *thread;
+    DownloadSinkCore *core;
+};
+
+DownloadSink::DownloadSink(QObject *parent) :
+    QObject(parent)
+{
+    p = new DownloadSinkPrivate;
+    p->core = new DownloadSinkCore();
+    p->thread = new QThread(this);
+    p->thread->start();
+
+    p->core->moveToThread(p->thread);
+
+    connect(p->core, SIGNAL(finished(qint64,QString)), SIGNAL(finished(qint64,QString)), Qt::QueuedConnection );
+}
+
+void DownloadSink::open(qint64 id, const QString &path, qint64 total)
+{
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(qint64,id), Q_ARG(QString,path), Q_ARG(qint64,total));
+}
+
+void DownloadSink::write(qint64 id, qint64 offset, const QByteArray &bytes)
+{
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(qint64,id), Q_ARG(qint64,offset), Q_ARG(QByteArray,bytes));
+}
+
+void DownloadSink::finish(qint64 id, qint64 size, const QString &suffix)
+{
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(qint64,id), Q_ARG(qint64,size), Q_ARG(QString,suffix));
+}
+
+void DownloadSink::cancel(qint64 id)
+{
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection, Q_ARG(qint64,id));
+}
+
+void DownloadSink::closeAll()
+{
+    QMetaObject::invokeMethod(p->core, __FUNCTION__, Qt::QueuedConnection);
+}
+
+DownloadSink::~DownloadSink()
+{
+    // Unfinished downloads can not be resumed, closeAll() drops their
+    // partial files.
+    QMetaObject::invokeMethod(p->core, "closeAll", Qt::BlockingQueuedConnection);
+    p->thread->quit();
+    p->thread->wait();
+    delete p->core;
+    delete p;
+}
@@ -0,0 +1,28 @@
+#ifndef DOWNLOADSINK_H
+#define DOWNLOADSINK_H
+
+#include <QObject>
+
+class DownloadSinkPrivate;
+class DownloadSink : public QObject
+{
+    Q_OBJECT
+public:
+    DownloadSink(QObject *parent = 0);
+    ~DownloadSink();
+
+public slots:
+    void open(qint64 id, const QString &path, qint64 total);
+    void write(qint64 id, qint64 offset, const QByteArray &bytes);
+    void finish(qint64 id, qint64 size, const QString &suffix);
+    void cancel(qint64 id);
+    void closeAll();
+
+signals:
+    void finished(qint64 id, const QString &path);
+
+private:
+    DownloadSinkPrivate *p;
+};
+
+#endif // DOWNLOADSINK_H
@@ -0,0 +1,150 @@
+#include "downloadsinkcore.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QMimeDatabase>
+#include <QDebug>
+
+class DownloadSinkItem
+{
+public:
+    DownloadSinkItem(): total(0), failed(false) {}
+
+    QString path;
+    QFile file;
+    qint64 total;
+    bool failed;
+};
+
+class DownloadSinkCorePrivate
+{
+public:
+    QHash<qint64, DownloadSinkItem*> items;
+    QMimeDatabase mime_db;
+};
+
+DownloadSinkCore::DownloadSinkCore(QObject *parent) :
+    QObject(parent)
+{
+    p = new DownloadSinkCorePrivate;
+}
+
+QString DownloadSinkCore::partialPath(const QString &path)
+{
+    QFileInfo file(path);
+    return file.path() + "/.partial/" + file.fileName();
+}
+
+void DownloadSinkCore::open(qint64 id, const QString &path, qint64 total)
+{
+    if(p->items.contains(id))
+        return;
+
+    DownloadSinkItem *item = new DownloadSinkItem;
+    item->path = path;
+    item->total = total;
+    p->items[id] = item;
+
+    QDir().mkpath(QFileInfo(partialPath(path)).path());
+
+    // uploadGetFile always starts from the first part, so a partial file
+    // left by an earlier session is of no use and is started over.
+    item->file.setFileName(partialPath(path));
+    if( !item->file.open(QFile::ReadWrite|QFile::Truncate) )
+    {
+        qDebug() << __PRETTY_FUNCTION__ << item->file.errorString();
+        item->failed = true;
+        return;
+    }
+    if(item->total > 0)
+        item->file.resize(item->total);
+}
+
+void DownloadSinkCore::write(qint64 id, qint64 offset, const QByteArray &bytes)
+{
+    DownloadSinkItem *item = p->items.value(id);
+    if(!item || item->failed)
+        return;
+
+    if( !item->file.seek(offset) || item->file.write(bytes) != bytes.size() )
+    {
+        qDebug() << __PRETTY_FUNCTION__ << item->file.errorString();
+        item->failed = true;
+        return;
+    }
+}
+
+void DownloadSinkCore::finish(qint64 id, qint64 size, const QString &suffix)
+{
+    DownloadSinkItem *item = p->items.take(id);
+    if(!item)
+        return;
+
+    if(item->failed)
+    {
+        item->file.close();
+        item->file.remove();
+        delete item;
+        emit finished(id, QString());
+        return;
+    }
+
+    if(item->file.size() != size)
+        item->file.resize(size);
+
+    item->file.close();
+
+    QString sfx = suffix;
+    if(sfx.isEmpty())
+    {
+        const QStringList &suffixes = p->mime_db.mimeTypeForFile(item->file.fileName()).suffixes();
+        if(!suffixes.isEmpty())
+            sfx = suffixes.first();
+    }
+    if(!sfx.isEmpty())
+        sfx = "." + sfx;
+
+    const QString &path = item->path + sfx;
+    QFile::remove(path);
+    if( !item->file.rename(path) )
+    {
+        qDebug() << __PRETTY_FUNCTION__ << item->file.errorString();
+        item->file.remove();
+        delete item;
+        emit finished(id, QString());
+        return;
+    }
+
+    delete item;
+    emit finished(id, path);
+}
+
+void DownloadSinkCore::cancel(qint64 id)
+{
+    DownloadSinkItem *item = p->items.take(id);
+    if(!item)
+        return;
+
+    item->file.close();
+    item->file.remove();
+    delete item;
+}
+
+void DownloadSinkCore::closeAll()
+{
+    foreach(DownloadSinkItem *item, p->items)
+    {
+        item->file.close();
+        item->file.remove();
+        delete item;
+    }
+
+    p->items.clear();
+}
+
+DownloadSinkCore::~DownloadSinkCore()
+{
+    closeAll();
+    delete p;
+}
@@ -0,0 +1,31 @@
+#ifndef DOWNLOADSINKCORE_H
+#define DOWNLOADSINKCORE_H
+
+#include <QObject>
+#include <QHash>
+
+class DownloadSinkCorePrivate;
+class DownloadSinkCore : public QObject
+{
+    Q_OBJECT
+public:
+    DownloadSinkCore(QObject *parent = 0);
+    ~DownloadSinkCore();
+
+    static QString partialPath(const QString &path);
+
+public slots:
+    void open(qint64 id, const QString &path, qint64 total);
+    void write(qint64 id, qint64 offset, const QByteArray &bytes);
+    void finish(qint64 id, qint64 size, const QString &suffix);
+    void cancel(qint64 id);
+    void closeAll();
+
+signals:
+    void finished(qint64 id, const QString &path);
+
+private:
+    DownloadSinkCorePrivate *p;
+};
+
+#endif // DOWNLOADSINKCORE_H
@@ -25,9 +25,149 @@
 #define EMOJIS_PATH QString( AsemanDevices::resourcePath() + "/emojis/" )
 
 #include <QHash>
+#include <QVector>
+#include <QCache>
 #include <QFile>
 #include <QDebug>
 #include <QPointer>
+#include <QRunnable>
+#include <QThreadPool>
+
+#define HTML_CACHE_COST (4*1024*1024)
+
+class EmojisTrieNode
+{
+public:
+    EmojisTrieNode(): path(-1){}
+    QHash<ushort,int> children;
+    int path;
+};
+
+class EmojisTrie
+{
+public:
+    int match(const QString &text, int pos, const QString **path) const
+    {
+        if( nodes.isEmpty() )
+            return 0;
+
+        int matched = 0;
+        int node = 0;
+        const int length = text.size();
+        for( int i=pos; i<length; i++ )
+        {
+            node = nodes.at(node).children.value(text.at(i).unicode(), -1);
+            if( node == -1 )
+                break;
+
+            const int pathIdx = nodes.at(node).path;
+            if( pathIdx == -1 )
+                continue;
+
+            matched = i-pos+1;
+            if( path )
+                *path = &paths.at(pathIdx);
+        }
+
+        return matched;
+    }
+
+    QVector<EmojisTrieNode> nodes;
+    QStringList paths;
+};
+
+QString emojisRenderText(const EmojisTrie &trie, const QString &txt, int size, bool skipLinks)
+{
+    QString res = txt.toHtmlEscaped();
+
+    QRegExp links_rxp("((?:(?:\\w\\S*\\/\\S*|\\/\\S+|\\:\\/)(?:\\/\\S*\\w|\\w))|(?:\\w+\\.(?:com|org|co|net)))");
+    int pos = 0;
+    while (!skipLinks && (pos = links_rxp.indexIn(res, pos)) != -1)
+    {
+        QString link = links_rxp.cap(1);
+        QString href = link;
+        if(href.indexOf(QRegExp("\\w+\\:\\/\\/")) == -1)
+            href = "http://" + href;
+
+        QString atag = QString("<a href='%1'>%2</a>").arg(href,link);
+        res.replace( pos, link.length(), atag );
+        pos += atag.size();
+    }
+
+    QRegExp tags_rxp("\\#(\\w+)");
+    pos = 0;
+    while (!skipLinks && (pos = tags_rxp.indexIn(res, pos)) != -1)
+    {
+        QString tag = tags_rxp.cap(1);
+        QString atag = QString("<a href='tag://%1'>%2</a>").arg(tag,"#"+tag);
+        res.replace( pos, tag.length()+1, atag );
+        pos += atag.size();
+    }
+
+    const QString & sizeStr = QString::number(size);
+    const QString & imgHead = " <img align=absmiddle height=\"" + sizeStr + "\" width=\"" + sizeStr + "\" src=\"" + AsemanDevices::localFilesPrePath();
+    const QString imgTail = "\" /> ";
+
+    QString result;
+    result.reserve(res.size()*2);
+
+    const int length = res.size();
+    for( int i=0; i<length; )
+    {
+        const QString *path = 0;
+        const int matched = trie.match(res, i, &path);
+        if( matched )
+        {
+            result += imgHead;
+            result += *path;
+            result += imgTail;
+            i += matched;
+            continue;
+        }
+
+        const QChar ch = res.at(i);
+        if( ch == '\n' )
+            result += "<br />";
+        else
+            result += ch;
+
+        i++;
+    }
+
+    return result;
+}
+
+QString emojisRenderBody(const EmojisTrie &trie, const QString &txt)
+{
+    Qt::LayoutDirection dir = AsemanTools::directionOf(txt);
+
+    QString dir_txt = dir==Qt::LeftToRight? "ltr" : "rtl";
+    return QString("<html><body><p dir='%1'>").arg(dir_txt) + emojisRenderText(trie, txt, 18, false) + "</p></body></html>";
+}
+
+QString emojisCacheKey(const QString &theme, int size, bool skipLinks, bool body, const QString &txt)
+{
+    return theme + QChar(0x1F) + QString::number(size) + (skipLinks?"s":"l") + (body?"b":"t") + QChar(0x1F) + txt;
+}
+
+class EmojisPrerenderer : public QRunnable
+{
+public:
+    void run()
+    {
+        QStringList htmls;
+        foreach(const QString &text, texts)
+            htmls << emojisRenderBody(trie, text);
+
+        QMetaObject::invokeMethod(emojis, "prerendered", Qt::QueuedConnection, Q_ARG(QString,theme),
+                                  Q_ARG(QStringList,texts), Q_ARG(QStringList,htmls));
+    }
+
+    QObject *emojis;
+    EmojisTrie trie;
+    QString theme;
+    QStringList texts;
+};
 
 class EmojisPrivate
 {
@@ -36,12 +176,20 @@ public:
     QStringList keys;
     QString theme;
     QPointer<UserData> userData;
+
+    EmojisTrie trie;
+    QCache<QString,QString> html_cache;
+    QThreadPool *prerender_pool;
 };
 
 Emojis::Emojis(QObject *parent) :
     QObject(parent)
 {
     p = new EmojisPrivate;
+    p->html_cache.setMaxCost(HTML_CACHE_COST);
+    p->prerender_pool = new QThreadPool(this);
+    p->prerender_pool->setMaxThreadCount(1);
+
     setCurrentTheme("twitter");
 }
 
@@ -57,6 +205,9 @@ void Emojis::setCurrentTheme(const QString &theme)
     p->theme = theme;
     p->emojis.clear();
     p->keys.clear();
+    p->html_cache.clear();
+    p->trie = EmojisTrie();
+    p->trie.nodes.resize(1);
 
     const QString data = cfile.readAll();
     const QStringList & list = data.split("\n",QString::SkipEmptyParts);
@@ -71,6 +222,22 @@ void Emojis::setCurrentTheme(const QString &theme)
 
         p->emojis[ecode] = epath;
         p->keys << ecode;
+
+        int node = 0;
+        foreach( const QChar & ch, ecode )
+        {
+            int next = p->trie.nodes[node].children.value(ch.unicode(), -1);
+            if( next == -1 )
+            {
+                next = p->trie.nodes.count();
+                p->trie.nodes[node].children[ch.unicode()] = next;
+                p->trie.nodes.append(EmojisTrieNode());
+            }
+            node = next;
+        }
+
+        p->trie.nodes[node].path = p->trie.paths.count();
+        p->trie.paths << epath;
     }
 
     emit currentThemeChanged();
@@ -97,64 +264,66 @@ void Emojis::setUserData(UserData *userData)
 
 QString Emojis::textToEmojiText(const QString &txt, int size, bool skipLinks)
 {
-    QString res = txt.toHtmlEscaped();
+    const QString & key = emojisCacheKey(p->theme, size, skipLinks, false, txt);
+    const QString *cached = p->html_cache.object(key);
+    if( cached )
+        return *cached;
 
-    QRegExp links_rxp("((?:(?:\\w\\S*\\/\\S*|\\/\\S+|\\:\\/)(?:\\/\\S*\\w|\\w))|(?:\\w+\\.(?:com|org|co|net)))");
-    int pos = 0;
-    while (!skipLinks && (pos = links_rxp.indexIn(res, pos)) != -1)
-    {
-        QString link = links_rxp.cap(1);
-        QString href = link;
-        if(href.indexOf(QRegExp("\\w+\\:\\/\\/")) == -1)
-            href = "http://" + href;
+    const QString & result = emojisRenderText(p->trie, txt, size, skipLinks);
 
-        QString atag = QString("<a href='%1'>%2</a>").arg(href,link);
-        res.replace( pos, link.length(), atag );
-        pos += atag.size();
-    }
+    p->html_cache.insert(key, new QString(result), result.size());
+    return result;
+}
 
-    QRegExp tags_rxp("\\#(\\w+)");
-    pos = 0;
-    while (!skipLinks && (pos = tags_rxp.indexIn(res, pos)) != -1)
-    {
-        QString tag = tags_rxp.cap(1);
-        if(p->userData)
-            p->userData->addTag(tag);
+QString Emojis::bodyTextToEmojiText(const QString &txt)
+{
+    const QString & key = emojisCacheKey(p->theme, 18, false, true, txt);
+    const QString *cached = p->html_cache.object(key);
+    if( cached )
+        return *cached;
 
-        QString atag = QString("<a href='tag://%1'>%2</a>").arg(tag,"#"+tag);
-        res.replace( pos, tag.length()+1, atag );
-        pos += atag.size();
-    }
+    const QString & result = emojisRenderBody(p->trie, txt);
 
-    for( int i=0; i<res.size(); i++ )
-    {
-        for( int j=1; j<5; j++ )
-        {
-            QString emoji = res.mid(i,j);
-            if( !p->emojis.contains(emoji) )
-                continue;
+    p->html_cache.insert(key, new QString(result), result.size());
+    return result;
+}
 
-            QString path = p->emojis.value(emoji);
-            QString in_txt = QString(" <img align=absmiddle height=\"%2\" width=\"%3\" src=\"" + AsemanDevices::localFilesPrePath() +"%1\" /> ").arg(path).arg(size).arg(size);
-            res.replace(i,j,in_txt);
-            i += in_txt.size()-1;
-            break;
-        }
-    }
+void Emojis::prerender(const QStringList &texts)
+{
+    QStringList missing;
+    foreach(const QString &text, texts)
+        if( !text.isEmpty() && !p->html_cache.contains(emojisCacheKey(p->theme, 18, false, true, text)) )
+            missing << text;
+
+    if( missing.isEmpty() )
+        return;
 
+    EmojisPrerenderer *job = new EmojisPrerenderer;
+    job->emojis = this;
+    job->trie = p->trie;
+    job->theme = p->theme;
+    job->texts = missing;
 
-    res = res.replace("\n","<br />");
-    return res;
+    p->prerender_pool->start(job);
 }
 
-QString Emojis::bodyTextToEmojiText(const QString &txt)
+void Emojis::prerendered(const QString &theme, const QStringList &texts, const QStringList &htmls)
 {
-    QString res;
-    Qt::LayoutDirection dir = AsemanTools::directionOf(txt);
+    if( theme != p->theme )
+        return;
 
-    QString dir_txt = dir==Qt::LeftToRight? "ltr" : "rtl";
-    res = QString("<html><body><p dir='%1'>").arg(dir_txt) + textToEmojiText(txt, 18) + "</p></body></html>";
-    return res;
+    for( int i=0; i<texts.count() && i<htmls.count(); i++ )
+    {
+        const QString & html = htmls.at(i);
+        p->html_cache.insert(emojisCacheKey(theme, 18, false, true, texts.at(i)), new QString(html), html.size());
+    }
+
+    emit htmlsPrerendered(htmls);
+}
+
+int Emojis::matchEmoji(const QString &text, int pos, const QString **path) const
+{
+    return p->trie.match(text, pos, path);
 }
 
 QList<QString> Emojis::keys() const
@@ -174,5 +343,7 @@ const QHash<QString, QString> &Emojis::emojis() const
 
 Emojis::~Emojis()
 {
+    p->prerender_pool->clear();
+    p->prerender_pool->waitForDone();
     delete p;
 }
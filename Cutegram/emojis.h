@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QList>
+#include <QStringList>
 
 class UserData;
 class EmojisPrivate;
@@ -42,15 +43,21 @@ public:
 
     Q_INVOKABLE QString textToEmojiText(const QString & txt , int size = 16, bool skipLinks = false);
     Q_INVOKABLE QString bodyTextToEmojiText( const QString & txt );
+    Q_INVOKABLE void prerender(const QStringList &texts);
 
     Q_INVOKABLE QList<QString> keys() const;
     Q_INVOKABLE QString pathOf( const QString & key ) const;
 
     const QHash<QString,QString> &emojis() const;
+    int matchEmoji(const QString &text, int pos, const QString **path = 0) const;
 
 signals:
     void currentThemeChanged();
     void userDataChanged();
+    void htmlsPrerendered(const QStringList &htmls);
+
+private slots:
+    void prerendered(const QString &theme, const QStringList &texts, const QStringList &htmls);
 
 private:
     EmojisPrivate *p;
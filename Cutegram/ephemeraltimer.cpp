@@ -0,0 +1,214 @@
+#include "ephemeraltimer.h"
+
+#include <QTimerEvent>
+#include <QDateTime>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+#include <algorithm>
+
+class EphemeralTimerKey
+{
+public:
+    EphemeralTimerKey(int k = 0, qint64 a = 0, qint64 b = 0): kind(k), key(a), subKey(b){}
+    bool operator==(const EphemeralTimerKey &b) const {
+        return kind == b.kind && key == b.key && subKey == b.subKey;
+    }
+
+    int kind;
+    qint64 key;
+    qint64 subKey;
+};
+
+inline uint qHash(const EphemeralTimerKey &k, uint seed = 0)
+{
+    return qHash(k.key, seed) ^ qHash(k.subKey, seed+k.kind);
+}
+
+class EphemeralTimerEntry
+{
+public:
+    qint64 deadline;
+    EphemeralTimerKey key;
+};
+
+bool ephemeralTimerEntryGreaterThan(const EphemeralTimerEntry &a, const EphemeralTimerEntry &b)
+{
+    return a.deadline > b.deadline;
+}
+
+/*!
+ * Min-heap of deadlines. Restarting or stopping an entry only updates
+ * the hash, the outdated heap entry is skipped when it reaches the top.
+ */
+class EphemeralTimerPrivate
+{
+public:
+    void push(qint64 deadline, const EphemeralTimerKey &key) {
+        EphemeralTimerEntry entry;
+        entry.deadline = deadline;
+        entry.key = key;
+        heap.append(entry);
+        std::push_heap(heap.begin(), heap.end(), ephemeralTimerEntryGreaterThan);
+    }
+
+    void pop() {
+        std::pop_heap(heap.begin(), heap.end(), ephemeralTimerEntryGreaterThan);
+        heap.removeLast();
+    }
+
+    bool isStale(const EphemeralTimerEntry &entry) const {
+        QHash<EphemeralTimerKey, qint64>::const_iterator i = deadlines.constFind(entry.key);
+        return i == deadlines.constEnd() || i.value() != entry.deadline;
+    }
+
+    void compact() {
+        QVector<EphemeralTimerEntry> live;
+        live.reserve(deadlines.count());
+        foreach(const EphemeralTimerEntry &entry, heap)
+            if(!isStale(entry))
+                live << entry;
+
+        heap = live;
+        std::make_heap(heap.begin(), heap.end(), ephemeralTimerEntryGreaterThan);
+    }
+
+    QVector<EphemeralTimerEntry> heap;
+    QHash<EphemeralTimerKey, qint64> deadlines;
+
+    int resolution;
+    int timer;
+    qint64 timer_deadline;
+};
+
+EphemeralTimer::EphemeralTimer(QObject *parent) :
+    QObject(parent)
+{
+    p = new EphemeralTimerPrivate;
+    p->resolution = 250;
+    p->timer = 0;
+    p->timer_deadline = 0;
+}
+
+void EphemeralTimer::setResolution(int msecs)
+{
+    p->resolution = qMax(1, msecs);
+}
+
+int EphemeralTimer::resolution() const
+{
+    return p->resolution;
+}
+
+void EphemeralTimer::start(int kind, qint64 key, qint64 subKey, qint64 msecs)
+{
+    // Deadlines are rounded up to the resolution, so everything expiring
+    // in the same slot is handled by a single wake up.
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 deadline = ((now + qMax<qint64>(msecs, 0) + p->resolution - 1)/p->resolution)*p->resolution;
+
+    const EphemeralTimerKey k(kind, key, subKey);
+    QHash<EphemeralTimerKey, qint64>::iterator i = p->deadlines.find(k);
+    if(i != p->deadlines.end() && i.value() == deadline)
+        return;
+
+    p->deadlines[k] = deadline;
+    p->push(deadline, k);
+
+    if(p->heap.count() > 2*p->deadlines.count() + 64)
+        p->compact();
+
+    rearm();
+}
+
+void EphemeralTimer::stop(int kind, qint64 key, qint64 subKey)
+{
+    if(!p->deadlines.remove(EphemeralTimerKey(kind, key, subKey)))
+        return;
+    if(p->deadlines.isEmpty())
+        clear();
+}
+
+bool EphemeralTimer::isActive(int kind, qint64 key, qint64 subKey) const
+{
+    return p->deadlines.contains(EphemeralTimerKey(kind, key, subKey));
+}
+
+void EphemeralTimer::clear()
+{
+    p->heap.clear();
+    p->deadlines.clear();
+    if(p->timer)
+        killTimer(p->timer);
+
+    p->timer = 0;
+    p->timer_deadline = 0;
+}
+
+int EphemeralTimer::count() const
+{
+    return p->deadlines.count();
+}
+
+void EphemeralTimer::timerEvent(QTimerEvent *e)
+{
+    if(e->timerId() != p->timer)
+    {
+        QObject::timerEvent(e);
+        return;
+    }
+
+    killTimer(p->timer);
+    p->timer = 0;
+    p->timer_deadline = 0;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<EphemeralTimerKey> expireds;
+    while(!p->heap.isEmpty() && p->heap.first().deadline <= now)
+    {
+        const EphemeralTimerEntry entry = p->heap.first();
+        p->pop();
+        if(p->isStale(entry))
+            continue;
+
+        p->deadlines.remove(entry.key);
+        expireds << entry.key;
+    }
+
+    rearm();
+
+    foreach(const EphemeralTimerKey &k, expireds)
+        emit expired(k.kind, k.key, k.subKey);
+}
+
+void EphemeralTimer::rearm()
+{
+    while(!p->heap.isEmpty() && p->isStale(p->heap.first()))
+        p->pop();
+
+    if(p->heap.isEmpty())
+    {
+        if(p->timer)
+            killTimer(p->timer);
+        p->timer = 0;
+        p->timer_deadline = 0;
+        return;
+    }
+
+    const qint64 deadline = p->heap.first().deadline;
+    if(p->timer && p->timer_deadline <= deadline)
+        return;
+
+    if(p->timer)
+        killTimer(p->timer);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    p->timer = startTimer(static_cast<int>(qMax<qint64>(deadline - now, 0)), Qt::CoarseTimer);
+    p->timer_deadline = deadline;
+}
+
+EphemeralTimer::~EphemeralTimer()
+{
+    delete p;
+}
@@ -0,0 +1,43 @@
+#ifndef EPHEMERALTIMER_H
+#define EPHEMERALTIMER_H
+
+#include <QObject>
+
+class QTimerEvent;
+class EphemeralTimerPrivate;
+class EphemeralTimer : public QObject
+{
+    Q_OBJECT
+public:
+    enum Kind {
+        Typing,
+        UserOnline
+    };
+
+    EphemeralTimer(QObject *parent = 0);
+    ~EphemeralTimer();
+
+    void setResolution(int msecs);
+    int resolution() const;
+
+    void start(int kind, qint64 key, qint64 subKey, qint64 msecs);
+    void stop(int kind, qint64 key, qint64 subKey = 0);
+    bool isActive(int kind, qint64 key, qint64 subKey = 0) const;
+    void clear();
+
+    int count() const;
+
+signals:
+    void expired(int kind, qint64 key, qint64 subKey);
+
+protected:
+    void timerEvent(QTimerEvent *e);
+
+private:
+    void rearm();
+
+private:
+    EphemeralTimerPrivate *p;
+};
+
+#endif // EPHEMERALTIMER_H
@@ -0,0 +1,427 @@
+#include "messagestore.h"
+
+#include <types/types.h>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QPair>
+
+#include <algorithm>
+
+#define MESSAGE_STORE_INTERN_LENGTH 32
+
+class MessageStoreRecord
+{
+public:
+    enum Flags {
+        Unread = 1,
+        Out = 2,
+        ToChat = 4,
+        Encrypted = 8,
+        Forwarded = 16,
+        Extra = 32
+    };
+
+    qint32 id;
+    qint32 date;
+    qint32 fromId;
+    qint32 toId;
+    qint32 fwdDate;
+    qint32 fwdFromId;
+    qint32 text;
+    quint32 flags;
+};
+
+Q_DECLARE_TYPEINFO(MessageStoreRecord, Q_PRIMITIVE_TYPE);
+
+bool messageStoreRecordLessThan(const MessageStoreRecord &a, const MessageStoreRecord &b)
+{
+    return a.id < b.id;
+}
+
+bool messageStoreRecordIdLessThan(const MessageStoreRecord &a, qint32 id)
+{
+    return a.id < id;
+}
+
+/*!
+ * Message texts, shared by slot index. Short texts are interned so the
+ * usual "ok"s and single emojis of a chat keep a single buffer.
+ */
+class MessageStoreStrings
+{
+public:
+    MessageStoreStrings(): bytes(0) {}
+
+    int acquire(const QString &str) {
+        if(str.isEmpty())
+            return -1;
+
+        const bool intern = str.length() <= MESSAGE_STORE_INTERN_LENGTH;
+        if(intern)
+        {
+            const int idx = interned.value(str, -1);
+            if(idx != -1)
+            {
+                refs[idx]++;
+                return idx;
+            }
+        }
+
+        int idx;
+        if(free_slots.isEmpty())
+        {
+            idx = values.count();
+            values.append(str);
+            refs.append(1);
+        }
+        else
+        {
+            idx = free_slots.takeLast();
+            values[idx] = str;
+            refs[idx] = 1;
+        }
+
+        if(intern)
+            interned.insert(str, idx);
+
+        bytes += str.size()*sizeof(QChar);
+        return idx;
+    }
+
+    void release(int idx) {
+        if(idx < 0 || --refs[idx] > 0)
+            return;
+
+        const QString &str = values.at(idx);
+        if(str.length() <= MESSAGE_STORE_INTERN_LENGTH)
+            interned.remove(str);
+
+        bytes -= str.size()*sizeof(QChar);
+        values[idx] = QString();
+        free_slots.append(idx);
+    }
+
+    QString value(int idx) const {
+        return idx<0? QString() : values.at(idx);
+    }
+
+    void clear() {
+        values.clear();
+        refs.clear();
+        free_slots.clear();
+        interned.clear();
+        bytes = 0;
+    }
+
+    QVector<QString> values;
+    QVector<int> refs;
+    QVector<int> free_slots;
+    QHash<QString, int> interned;
+    qint64 bytes;
+};
+
+class MessageStorePrivate
+{
+public:
+    MessageStoreRecord *find(qint64 id) {
+        QHash<qint32, qint64>::const_iterator i = index.constFind(id);
+        if(i == index.constEnd())
+            return 0;
+
+        QHash<qint64, QVector<MessageStoreRecord> >::iterator d = dialogs.find(i.value());
+        if(d == dialogs.end())
+            return 0;
+
+        QVector<MessageStoreRecord> &list = d.value();
+        QVector<MessageStoreRecord>::iterator r = std::lower_bound(list.begin(), list.end(), static_cast<qint32>(id), messageStoreRecordIdLessThan);
+        if(r == list.end() || r->id != id)
+            return 0;
+
+        return r;
+    }
+
+    const MessageStoreRecord *find(qint64 id) const {
+        return const_cast<MessageStorePrivate*>(this)->find(id);
+    }
+
+    MessageStoreRecord record(const Message &m, bool encrypted) {
+        MessageStoreRecord r;
+        r.id = m.id();
+        r.date = m.date();
+        r.fromId = m.fromId();
+        r.fwdDate = m.fwdDate();
+        r.fwdFromId = m.fwdFromId();
+        r.text = strings.acquire(m.message());
+        r.flags = 0;
+
+        if(m.toId().classType() == Peer::typePeerChat)
+        {
+            r.toId = m.toId().chatId();
+            r.flags |= MessageStoreRecord::ToChat;
+        }
+        else
+            r.toId = m.toId().userId();
+
+        if(m.unread())
+            r.flags |= MessageStoreRecord::Unread;
+        if(m.out())
+            r.flags |= MessageStoreRecord::Out;
+        if(encrypted)
+            r.flags |= MessageStoreRecord::Encrypted;
+        if(m.classType() == Message::typeMessageForwarded)
+            r.flags |= MessageStoreRecord::Forwarded;
+
+        // Media, actions and odd message types keep their full value aside
+        if((m.classType() != Message::typeMessage && m.classType() != Message::typeMessageForwarded) ||
+           m.media().classType() != MessageMedia::typeMessageMediaEmpty ||
+           m.action().classType() != MessageAction::typeMessageActionEmpty)
+        {
+            r.flags |= MessageStoreRecord::Extra;
+            extras[r.id] = m;
+        }
+        else
+            extras.remove(r.id);
+
+        return r;
+    }
+
+    void release(const MessageStoreRecord &r) {
+        strings.release(r.text);
+        if(r.flags & MessageStoreRecord::Extra)
+            extras.remove(r.id);
+    }
+
+    QHash<qint64, QVector<MessageStoreRecord> > dialogs;
+    QHash<qint32, qint64> index;
+    QHash<qint32, Message> extras;
+    QHash<qint32, QPair<QByteArray,QByteArray> > keys;
+    MessageStoreStrings strings;
+};
+
+MessageStore::MessageStore()
+{
+    p = new MessageStorePrivate;
+}
+
+void MessageStore::insert(qint64 dId, const Message &message, bool encrypted)
+{
+    MessageStoreRecord *old = p->find(message.id());
+    if(old)
+    {
+        const MessageStoreRecord oldRecord = *old;
+        p->release(oldRecord);
+        *p->find(message.id()) = p->record(message, encrypted);
+        return;
+    }
+
+    QVector<MessageStoreRecord> &list = p->dialogs[dId];
+    const MessageStoreRecord &r = p->record(message, encrypted);
+    if(list.isEmpty() || list.last().id < r.id)
+        list.append(r);
+    else
+        list.insert(std::lower_bound(list.begin(), list.end(), r, messageStoreRecordLessThan), r);
+
+    p->index.insert(r.id, dId);
+}
+
+void MessageStore::insert(qint64 dId, const QList<Message> &messages)
+{
+    QVector<MessageStoreRecord> records;
+    records.reserve(messages.count());
+    QSet<qint32> ids;
+    foreach(const Message &m, messages)
+    {
+        if(p->find(m.id()))
+            insert(dId, m, false);
+        else
+        if(ids.contains(m.id()))
+        {
+            for(int i=0; i<records.count(); i++)
+                if(records.at(i).id == m.id())
+                {
+                    p->release(records.at(i));
+                    records[i] = p->record(m, false);
+                    break;
+                }
+        }
+        else
+        {
+            records.append(p->record(m, false));
+            ids.insert(m.id());
+        }
+    }
+
+    if(records.isEmpty())
+        return;
+
+    std::sort(records.begin(), records.end(), messageStoreRecordLessThan);
+    foreach(const MessageStoreRecord &r, records)
+        p->index.insert(r.id, dId);
+
+    // One merge instead of shifting the whole dialog for every record
+    QVector<MessageStoreRecord> &list = p->dialogs[dId];
+    QVector<MessageStoreRecord> merged(list.count() + records.count());
+    std::merge(list.constBegin(), list.constEnd(), records.constBegin(), records.constEnd(),
+               merged.begin(), messageStoreRecordLessThan);
+    list = merged;
+}
+
+void MessageStore::remove(qint64 id)
+{
+    QHash<qint32, qint64>::iterator i = p->index.find(id);
+    if(i == p->index.end())
+        return;
+
+    QVector<MessageStoreRecord> &list = p->dialogs[i.value()];
+    QVector<MessageStoreRecord>::iterator r = std::lower_bound(list.begin(), list.end(), static_cast<qint32>(id), messageStoreRecordIdLessThan);
+    if(r != list.end() && r->id == id)
+    {
+        p->release(*r);
+        list.erase(r);
+    }
+    if(list.isEmpty())
+        p->dialogs.remove(i.value());
+
+    p->index.erase(i);
+    p->keys.remove(id);
+}
+
+void MessageStore::clear()
+{
+    p->dialogs.clear();
+    p->index.clear();
+    p->extras.clear();
+    p->keys.clear();
+    p->strings.clear();
+}
+
+bool MessageStore::contains(qint64 id) const
+{
+    return p->index.contains(id);
+}
+
+Message MessageStore::message(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    if(!r)
+        return Message(Message::typeMessageEmpty);
+
+    if(r->flags & MessageStoreRecord::Extra)
+    {
+        Message m = p->extras.value(r->id);
+        m.setUnread(r->flags & MessageStoreRecord::Unread);
+        return m;
+    }
+
+    Peer toPeer((r->flags & MessageStoreRecord::ToChat)? Peer::typePeerChat : Peer::typePeerUser);
+    if(r->flags & MessageStoreRecord::ToChat)
+        toPeer.setChatId(r->toId);
+    else
+        toPeer.setUserId(r->toId);
+
+    Message m((r->flags & MessageStoreRecord::Forwarded)? Message::typeMessageForwarded : Message::typeMessage);
+    m.setId(r->id);
+    m.setToId(toPeer);
+    m.setUnread(r->flags & MessageStoreRecord::Unread);
+    m.setFromId(r->fromId);
+    m.setOut(r->flags & MessageStoreRecord::Out);
+    m.setDate(r->date);
+    m.setFwdDate(r->fwdDate);
+    m.setFwdFromId(r->fwdFromId);
+    m.setMessage(p->strings.value(r->text));
+    return m;
+}
+
+qint64 MessageStore::dialogId(qint64 id) const
+{
+    return p->index.value(id);
+}
+
+qint32 MessageStore::date(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    return r? r->date : 0;
+}
+
+QString MessageStore::text(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    return r? p->strings.value(r->text) : QString();
+}
+
+bool MessageStore::encrypted(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    return r && (r->flags & MessageStoreRecord::Encrypted);
+}
+
+bool MessageStore::unread(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    return r && (r->flags & MessageStoreRecord::Unread);
+}
+
+bool MessageStore::out(qint64 id) const
+{
+    const MessageStoreRecord *r = p->find(id);
+    return r && (r->flags & MessageStoreRecord::Out);
+}
+
+void MessageStore::setUnread(qint64 id, bool unread)
+{
+    MessageStoreRecord *r = p->find(id);
+    if(!r)
+        return;
+
+    if(unread)
+        r->flags |= MessageStoreRecord::Unread;
+    else
+        r->flags &= ~MessageStoreRecord::Unread;
+}
+
+void MessageStore::setEncryptKeys(qint64 id, const QByteArray &key, const QByteArray &iv)
+{
+    p->keys[id] = QPair<QByteArray,QByteArray>(key, iv);
+}
+
+bool MessageStore::hasEncryptKeys(qint64 id) const
+{
+    return p->keys.contains(id);
+}
+
+QByteArray MessageStore::encryptKey(qint64 id) const
+{
+    return p->keys.value(id).first;
+}
+
+QByteArray MessageStore::encryptIv(qint64 id) const
+{
+    return p->keys.value(id).second;
+}
+
+int MessageStore::count() const
+{
+    return p->index.count();
+}
+
+qint64 MessageStore::memoryUsage() const
+{
+    qint64 res = p->strings.bytes;
+    QHashIterator<qint64, QVector<MessageStoreRecord> > i(p->dialogs);
+    while(i.hasNext())
+    {
+        i.next();
+        res += i.value().capacity()*sizeof(MessageStoreRecord);
+    }
+
+    // Hash nodes of the index, and a rough figure for the kept aside values
+    res += p->index.count()*2*sizeof(qint64);
+    res += p->extras.count()*1024;
+    return res;
+}
+
+MessageStore::~MessageStore()
+{
+    delete p;
+}
@@ -0,0 +1,45 @@
+#ifndef MESSAGESTORE_H
+#define MESSAGESTORE_H
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+class Message;
+class MessageStorePrivate;
+class MessageStore
+{
+public:
+    MessageStore();
+    ~MessageStore();
+
+    void insert(qint64 dId, const Message &message, bool encrypted);
+    void insert(qint64 dId, const QList<Message> &messages);
+    void remove(qint64 id);
+    void clear();
+
+    bool contains(qint64 id) const;
+    Message message(qint64 id) const;
+
+    qint64 dialogId(qint64 id) const;
+    qint32 date(qint64 id) const;
+    QString text(qint64 id) const;
+    bool encrypted(qint64 id) const;
+    bool unread(qint64 id) const;
+    bool out(qint64 id) const;
+
+    void setUnread(qint64 id, bool unread);
+
+    void setEncryptKeys(qint64 id, const QByteArray &key, const QByteArray &iv);
+    bool hasEncryptKeys(qint64 id) const;
+    QByteArray encryptKey(qint64 id) const;
+    QByteArray encryptIv(qint64 id) const;
+
+    int count() const;
+    qint64 memoryUsage() const;
+
+private:
+    MessageStorePrivate *p;
+};
+
+#endif // MESSAGESTORE_H
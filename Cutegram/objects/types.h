@@ -1,6 +1,6 @@
-// This file is generated by Aseman Object Creator
-// https://github.com/aseman-land/aseman-object-creator
-// Command: /home/bardia/Projects/build/AsemanQtObjectCreator/Desktop_Qt_5_4_0_GCC_64bit/Debug/AsemanQtObjectCreator if=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/types.sco of=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/types.h template_class=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/templates/class.template template_equals=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/templates/equals.template template_initialize=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/templates/initialize.template template_file=/home/bardia/Projects/Aseman/Apps/Cutegram/Cutegram/objects/templates/file.template
+// This file is generated by typesgen.py from types.sco and the templates
+// directory, do not edit it by hand.
+// Command: python3 typesgen.py types.sco templates types.h
 
 #ifndef TELEGRAMTYPEOBJECT_H
 #define TELEGRAMTYPEOBJECT_H
@@ -13,6 +13,7 @@
 #include <types/decryptedmessage.h>
 #include "../photosizelist.h"
 #include "../chatparticipantlist.h"
+#include "../typeobjectcounter.h"
 
 class DownloadObject : public QObject
 {
@@ -32,9 +33,12 @@ public:
         _partId = 0;
         _downloaded = 0;
         _total = 0;
-        _file = new QFile(this);
+        _file = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DownloadObject));
+    }
+    ~DownloadObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DownloadObject));
     }
-    ~DownloadObject(){}
 
     qint64 fileId() const {
         return _fileId;
@@ -109,6 +113,8 @@ public:
     }
 
     QFile* file() const {
+        if( !_file )
+            const_cast<DownloadObject*>(this)->init_file();
         return _file;
     }
 
@@ -130,6 +136,11 @@ signals:
     void totalChanged();
     void fileChanged();
 
+private:
+    void init_file() {
+        _file = new QFile(this);
+    }
+
 private:
     qint64 _fileId;
     QString _location;
@@ -158,8 +169,11 @@ public:
         _partId = 0;
         _uploaded = 0;
         _totalSize = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UploadObject));
+    }
+    ~UploadObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(UploadObject));
     }
-    ~UploadObject(){}
 
     qint64 fileId() const {
         return _fileId;
@@ -257,7 +271,7 @@ class FileLocationObject : public QObject
 public:
     FileLocationObject(const FileLocation & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _download = new DownloadObject(this);
+        _download = 0;
         _id = 0;
         _localId = another.localId();
         _secret = another.secret();
@@ -265,12 +279,19 @@ public:
         _accessHash = 0;
         _volumeId = another.volumeId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(FileLocationObject));
+    }
+    FileLocationObject(QObject *parent = 0) : QObject(parent){
+        _download = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(FileLocationObject));
+    }
+    ~FileLocationObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(FileLocationObject));
     }
-    FileLocationObject(QObject *parent = 0) : QObject(parent){}
-    ~FileLocationObject(){}
 
     DownloadObject* download() const {
+        if( !_download )
+            const_cast<FileLocationObject*>(this)->init_download();
         return _download;
     }
 
@@ -392,7 +413,7 @@ public:
 
 
     void operator= ( const FileLocation & another) {
-        if(_localId != another.localId()) {
+        if(_download && _localId != another.localId()) {
             _download->setFileId(0);
             _download->setMtime(0);
             _download->setPartId(0);
@@ -435,6 +456,11 @@ signals:
     void volumeIdChanged();
     void classTypeChanged();
 
+private:
+    void init_download() {
+        _download = new DownloadObject(this);
+    }
+
 private:
     DownloadObject* _download;
     qint64 _id;
@@ -464,10 +490,14 @@ public:
         _chatId = another.chatId();
         _userId = another.userId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PeerObject));
+    }
+    PeerObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PeerObject));
+    }
+    ~PeerObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(PeerObject));
     }
-    PeerObject(QObject *parent = 0) : QObject(parent){}
-    ~PeerObject(){}
 
     qint32 chatId() const {
         return _chatId;
@@ -544,10 +574,14 @@ public:
         _userId = another.userId();
         _mutual = another.mutual();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactObject));
+    }
+    ContactObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactObject));
+    }
+    ~ContactObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ContactObject));
     }
-    ContactObject(QObject *parent = 0) : QObject(parent){}
-    ~ContactObject(){}
 
     qint32 userId() const {
         return _userId;
@@ -626,10 +660,14 @@ public:
         _userId = another.userId();
         _accessHash = another.accessHash();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(InputPeerObject));
+    }
+    InputPeerObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(InputPeerObject));
+    }
+    ~InputPeerObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(InputPeerObject));
     }
-    InputPeerObject(QObject *parent = 0) : QObject(parent){}
-    ~InputPeerObject(){}
 
     qint32 chatId() const {
         return _chatId;
@@ -722,10 +760,14 @@ public:
         _wasOnline = another.wasOnline();
         _expires = another.expires();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserStatusObject));
+    }
+    UserStatusObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserStatusObject));
+    }
+    ~UserStatusObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(UserStatusObject));
     }
-    UserStatusObject(QObject *parent = 0) : QObject(parent){}
-    ~UserStatusObject(){}
 
     qint32 wasOnline() const {
         return _wasOnline;
@@ -802,10 +844,14 @@ public:
         _longitude = another.longitude();
         _lat = another.lat();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(GeoPointObject));
+    }
+    GeoPointObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(GeoPointObject));
+    }
+    ~GeoPointObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(GeoPointObject));
     }
-    GeoPointObject(QObject *parent = 0) : QObject(parent){}
-    ~GeoPointObject(){}
 
     double longitude() const {
         return _longitude;
@@ -886,10 +932,14 @@ public:
         _sound = another.sound();
         _showPreviews = another.showPreviews();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PeerNotifySettingsObject));
+    }
+    PeerNotifySettingsObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PeerNotifySettingsObject));
+    }
+    ~PeerNotifySettingsObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(PeerNotifySettingsObject));
     }
-    PeerNotifySettingsObject(QObject *parent = 0) : QObject(parent){}
-    ~PeerNotifySettingsObject(){}
 
     qint32 muteUntil() const {
         return _muteUntil;
@@ -994,10 +1044,14 @@ public:
     ContactsMyLinkObject(const ContactsMyLink & another, QObject *parent = 0) : QObject(parent){
         (void)another;
         _contact = another.contact();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactsMyLinkObject));
+    }
+    ContactsMyLinkObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactsMyLinkObject));
+    }
+    ~ContactsMyLinkObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ContactsMyLinkObject));
     }
-    ContactsMyLinkObject(QObject *parent = 0) : QObject(parent){}
-    ~ContactsMyLinkObject(){}
 
     bool contact() const {
         return _contact;
@@ -1048,10 +1102,14 @@ public:
         _size = another.size();
         _accessHash = another.accessHash();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedFileObject));
+    }
+    EncryptedFileObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedFileObject));
+    }
+    ~EncryptedFileObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(EncryptedFileObject));
     }
-    EncryptedFileObject(QObject *parent = 0) : QObject(parent){}
-    ~EncryptedFileObject(){}
 
     qint32 dcId() const {
         return _dcId;
@@ -1188,10 +1246,14 @@ public:
         _gAOrB = another.gAOrB();
         _participantId = another.participantId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedChatObject));
+    }
+    EncryptedChatObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedChatObject));
+    }
+    ~EncryptedChatObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(EncryptedChatObject));
     }
-    EncryptedChatObject(QObject *parent = 0) : QObject(parent){}
-    ~EncryptedChatObject(){}
 
     qint32 id() const {
         return _id;
@@ -1364,16 +1426,22 @@ class EncryptedMessageObject : public QObject
 public:
     EncryptedMessageObject(const EncryptedMessage & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _fileSource = another.file();
         _chatId = another.chatId();
         _date = another.date();
         _randomId = another.randomId();
-        _file = new EncryptedFileObject(another.file(), this);
+        _file = 0;
         _bytes = another.bytes();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedMessageObject));
+    }
+    EncryptedMessageObject(QObject *parent = 0) : QObject(parent){
+        _file = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(EncryptedMessageObject));
+    }
+    ~EncryptedMessageObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(EncryptedMessageObject));
     }
-    EncryptedMessageObject(QObject *parent = 0) : QObject(parent){}
-    ~EncryptedMessageObject(){}
 
     qint32 chatId() const {
         return _chatId;
@@ -1412,6 +1480,8 @@ public:
     }
 
     EncryptedFileObject* file() const {
+        if( !_file )
+            const_cast<EncryptedMessageObject*>(this)->init_file();
         return _file;
     }
 
@@ -1455,7 +1525,10 @@ public:
         emit dateChanged();
         _randomId = another.randomId();
         emit randomIdChanged();
-        *_file = another.file();
+        if( _file )
+            *_file = another.file();
+        else
+            _fileSource = another.file();
         emit fileChanged();
         _bytes = another.bytes();
         emit bytesChanged();
@@ -1473,6 +1546,12 @@ signals:
     void bytesChanged();
     void classTypeChanged();
 
+private:
+    void init_file() {
+        _file = new EncryptedFileObject(_fileSource, this);
+        _fileSource = EncryptedFile();
+    }
+
 private:
     qint32 _chatId;
     qint32 _date;
@@ -1480,6 +1559,7 @@ private:
     EncryptedFileObject* _file;
     QByteArray _bytes;
     qint64 _classType;
+    EncryptedFile _fileSource;
 
 };
 
@@ -1496,10 +1576,14 @@ public:
         (void)another;
         _hasPhone = another.hasPhone();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactsForeignLinkObject));
+    }
+    ContactsForeignLinkObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ContactsForeignLinkObject));
+    }
+    ~ContactsForeignLinkObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ContactsForeignLinkObject));
     }
-    ContactsForeignLinkObject(QObject *parent = 0) : QObject(parent){}
-    ~ContactsForeignLinkObject(){}
 
     bool hasPhone() const {
         return _hasPhone;
@@ -1556,14 +1640,22 @@ class NotifyPeerObject : public QObject
 public:
     NotifyPeerObject(const NotifyPeer & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _peer = new PeerObject(another.peer(), this);
+        _peerSource = another.peer();
+        _peer = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(NotifyPeerObject));
+    }
+    NotifyPeerObject(QObject *parent = 0) : QObject(parent){
+        _peer = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(NotifyPeerObject));
+    }
+    ~NotifyPeerObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(NotifyPeerObject));
     }
-    NotifyPeerObject(QObject *parent = 0) : QObject(parent){}
-    ~NotifyPeerObject(){}
 
     PeerObject* peer() const {
+        if( !_peer )
+            const_cast<NotifyPeerObject*>(this)->init_peer();
         return _peer;
     }
 
@@ -1589,7 +1681,10 @@ public:
 
 
     void operator= ( const NotifyPeer & another) {
-        *_peer = another.peer();
+        if( _peer )
+            *_peer = another.peer();
+        else
+            _peerSource = another.peer();
         emit peerChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -1601,9 +1696,16 @@ signals:
     void peerChanged();
     void classTypeChanged();
 
+private:
+    void init_peer() {
+        _peer = new PeerObject(_peerSource, this);
+        _peerSource = Peer();
+    }
+
 private:
     PeerObject* _peer;
     qint64 _classType;
+    Peer _peerSource;
 
 };
 
@@ -1624,10 +1726,14 @@ public:
         _date = another.date();
         _inviterId = another.inviterId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantObject));
+    }
+    ChatParticipantObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantObject));
+    }
+    ~ChatParticipantObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatParticipantObject));
     }
-    ChatParticipantObject(QObject *parent = 0) : QObject(parent){}
-    ~ChatParticipantObject(){}
 
     qint32 userId() const {
         return _userId;
@@ -1719,17 +1825,25 @@ class ChatParticipantsObject : public QObject
 public:
     ChatParticipantsObject(const ChatParticipants & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _participants = new ChatParticipantList(another.participants(), this);
+        _participantsSource = another.participants();
+        _participants = 0;
         _chatId = another.chatId();
         _version = another.version();
         _adminId = another.adminId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantsObject));
+    }
+    ChatParticipantsObject(QObject *parent = 0) : QObject(parent){
+        _participants = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatParticipantsObject));
+    }
+    ~ChatParticipantsObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatParticipantsObject));
     }
-    ChatParticipantsObject(QObject *parent = 0) : QObject(parent){}
-    ~ChatParticipantsObject(){}
 
     ChatParticipantList* participants() const {
+        if( !_participants )
+            const_cast<ChatParticipantsObject*>(this)->init_participants();
         return _participants;
     }
 
@@ -1791,7 +1905,10 @@ public:
 
 
     void operator= ( const ChatParticipants & another) {
-        *_participants = another.participants();
+        if( _participants )
+            *_participants = another.participants();
+        else
+            _participantsSource = another.participants();
         emit participantsChanged();
         _chatId = another.chatId();
         emit chatIdChanged();
@@ -1812,12 +1929,19 @@ signals:
     void adminIdChanged();
     void classTypeChanged();
 
+private:
+    void init_participants() {
+        _participants = new ChatParticipantList(_participantsSource, this);
+        _participantsSource = QList<ChatParticipant>();
+    }
+
 private:
     ChatParticipantList* _participants;
     qint32 _chatId;
     qint32 _version;
     qint32 _adminId;
     qint64 _classType;
+    QList<ChatParticipant> _participantsSource;
 
 };
 
@@ -1837,17 +1961,23 @@ class PhotoSizeObject : public QObject
 public:
     PhotoSizeObject(const PhotoSize & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _locationSource = another.location();
         _h = another.h();
         _type = another.type();
         _bytes = another.bytes();
-        _location = new FileLocationObject(another.location(), this);
+        _location = 0;
         _size = another.size();
         _w = another.w();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoSizeObject));
+    }
+    PhotoSizeObject(QObject *parent = 0) : QObject(parent){
+        _location = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoSizeObject));
+    }
+    ~PhotoSizeObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(PhotoSizeObject));
     }
-    PhotoSizeObject(QObject *parent = 0) : QObject(parent){}
-    ~PhotoSizeObject(){}
 
     qint32 h() const {
         return _h;
@@ -1886,6 +2016,8 @@ public:
     }
 
     FileLocationObject* location() const {
+        if( !_location )
+            const_cast<PhotoSizeObject*>(this)->init_location();
         return _location;
     }
 
@@ -1941,7 +2073,10 @@ public:
         emit typeChanged();
         _bytes = another.bytes();
         emit bytesChanged();
-        *_location = another.location();
+        if( _location )
+            *_location = another.location();
+        else
+            _locationSource = another.location();
         emit locationChanged();
         _size = another.size();
         emit sizeChanged();
@@ -1962,6 +2097,12 @@ signals:
     void wChanged();
     void classTypeChanged();
 
+private:
+    void init_location() {
+        _location = new FileLocationObject(_locationSource, this);
+        _locationSource = FileLocation();
+    }
+
 private:
     qint32 _h;
     QString _type;
@@ -1970,6 +2111,7 @@ private:
     qint32 _size;
     qint32 _w;
     qint64 _classType;
+    FileLocation _locationSource;
 
 };
 
@@ -2000,10 +2142,14 @@ public:
         _accessHash = another.accessHash();
         _userId = another.userId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(AudioObject));
+    }
+    AudioObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(AudioObject));
+    }
+    ~AudioObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(AudioObject));
     }
-    AudioObject(QObject *parent = 0) : QObject(parent){}
-    ~AudioObject(){}
 
     qint64 id() const {
         return _id;
@@ -2182,10 +2328,11 @@ class DocumentObject : public QObject
 public:
     DocumentObject(const Document & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _thumbSource = another.thumb();
         _id = another.id();
         _dcId = another.dcId();
         _mimeType = another.mimeType();
-        _thumb = new PhotoSizeObject(another.thumb(), this);
+        _thumb = 0;
         _date = another.date();
         _fileName = another.fileName();
         _accessHash = another.accessHash();
@@ -2194,10 +2341,15 @@ public:
         _encryptKey = QByteArray();
         _encryptIv = QByteArray();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DocumentObject));
+    }
+    DocumentObject(QObject *parent = 0) : QObject(parent){
+        _thumb = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DocumentObject));
+    }
+    ~DocumentObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DocumentObject));
     }
-    DocumentObject(QObject *parent = 0) : QObject(parent){}
-    ~DocumentObject(){}
 
     qint64 id() const {
         return _id;
@@ -2236,6 +2388,8 @@ public:
     }
 
     PhotoSizeObject* thumb() const {
+        if( !_thumb )
+            const_cast<DocumentObject*>(this)->init_thumb();
         return _thumb;
     }
 
@@ -2351,7 +2505,10 @@ public:
         emit dcIdChanged();
         _mimeType = another.mimeType();
         emit mimeTypeChanged();
-        *_thumb = another.thumb();
+        if( _thumb )
+            *_thumb = another.thumb();
+        else
+            _thumbSource = another.thumb();
         emit thumbChanged();
         _date = another.date();
         emit dateChanged();
@@ -2365,6 +2522,7 @@ public:
         emit sizeChanged();
         _classType = another.classType();
         emit classTypeChanged();
+
     }
 
 signals:
@@ -2382,6 +2540,12 @@ signals:
     void encryptIvChanged();
     void classTypeChanged();
 
+private:
+    void init_thumb() {
+        _thumb = new PhotoSizeObject(_thumbSource, this);
+        _thumbSource = PhotoSize();
+    }
+
 private:
     qint64 _id;
     qint32 _dcId;
@@ -2395,6 +2559,7 @@ private:
     QByteArray _encryptKey;
     QByteArray _encryptIv;
     qint64 _classType;
+    PhotoSize _thumbSource;
 
 };
 
@@ -2420,12 +2585,13 @@ class VideoObject : public QObject
 public:
     VideoObject(const Video & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _thumbSource = another.thumb();
         _id = another.id();
         _dcId = another.dcId();
         _caption = another.caption();
         _mimeType = another.mimeType();
         _date = another.date();
-        _thumb = new PhotoSizeObject(another.thumb(), this);
+        _thumb = 0;
         _duration = another.duration();
         _h = another.h();
         _size = another.size();
@@ -2433,10 +2599,15 @@ public:
         _userId = another.userId();
         _w = another.w();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(VideoObject));
+    }
+    VideoObject(QObject *parent = 0) : QObject(parent){
+        _thumb = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(VideoObject));
+    }
+    ~VideoObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(VideoObject));
     }
-    VideoObject(QObject *parent = 0) : QObject(parent){}
-    ~VideoObject(){}
 
     qint64 id() const {
         return _id;
@@ -2499,6 +2670,8 @@ public:
     }
 
     PhotoSizeObject* thumb() const {
+        if( !_thumb )
+            const_cast<VideoObject*>(this)->init_thumb();
         return _thumb;
     }
 
@@ -2606,7 +2779,10 @@ public:
         emit mimeTypeChanged();
         _date = another.date();
         emit dateChanged();
-        *_thumb = another.thumb();
+        if( _thumb )
+            *_thumb = another.thumb();
+        else
+            _thumbSource = another.thumb();
         emit thumbChanged();
         _duration = another.duration();
         emit durationChanged();
@@ -2641,6 +2817,12 @@ signals:
     void wChanged();
     void classTypeChanged();
 
+private:
+    void init_thumb() {
+        _thumb = new PhotoSizeObject(_thumbSource, this);
+        _thumbSource = PhotoSize();
+    }
+
 private:
     qint64 _id;
     qint32 _dcId;
@@ -2655,6 +2837,7 @@ private:
     qint32 _userId;
     qint32 _w;
     qint64 _classType;
+    PhotoSize _thumbSource;
 
 };
 
@@ -2675,18 +2858,26 @@ class PhotoObject : public QObject
 public:
     PhotoObject(const Photo & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _sizesSource = another.sizes();
+        _geoSource = another.geo();
         _id = another.id();
         _caption = another.caption();
         _date = another.date();
-        _sizes = new PhotoSizeList(another.sizes(), this);
-        _geo = new GeoPointObject(another.geo(), this);
+        _sizes = 0;
+        _geo = 0;
         _accessHash = another.accessHash();
         _userId = another.userId();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoObject));
+    }
+    PhotoObject(QObject *parent = 0) : QObject(parent){
+        _sizes = 0;
+        _geo = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoObject));
+    }
+    ~PhotoObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(PhotoObject));
     }
-    PhotoObject(QObject *parent = 0) : QObject(parent){}
-    ~PhotoObject(){}
 
     qint64 id() const {
         return _id;
@@ -2725,6 +2916,8 @@ public:
     }
 
     PhotoSizeList* sizes() const {
+        if( !_sizes )
+            const_cast<PhotoObject*>(this)->init_sizes();
         return _sizes;
     }
 
@@ -2737,6 +2930,8 @@ public:
     }
 
     GeoPointObject* geo() const {
+        if( !_geo )
+            const_cast<PhotoObject*>(this)->init_geo();
         return _geo;
     }
 
@@ -2792,9 +2987,15 @@ public:
         emit captionChanged();
         _date = another.date();
         emit dateChanged();
-        *_sizes = another.sizes();
+        if( _sizes )
+            *_sizes = another.sizes();
+        else
+            _sizesSource = another.sizes();
         emit sizesChanged();
-        *_geo = another.geo();
+        if( _geo )
+            *_geo = another.geo();
+        else
+            _geoSource = another.geo();
         emit geoChanged();
         _accessHash = another.accessHash();
         emit accessHashChanged();
@@ -2816,6 +3017,16 @@ signals:
     void userIdChanged();
     void classTypeChanged();
 
+private:
+    void init_sizes() {
+        _sizes = new PhotoSizeList(_sizesSource, this);
+        _sizesSource = QList<PhotoSize>();
+    }
+    void init_geo() {
+        _geo = new GeoPointObject(_geoSource, this);
+        _geoSource = GeoPoint();
+    }
+
 private:
     qint64 _id;
     QString _caption;
@@ -2825,6 +3036,8 @@ private:
     qint64 _accessHash;
     qint32 _userId;
     qint64 _classType;
+    QList<PhotoSize> _sizesSource;
+    GeoPoint _geoSource;
 
 };
 
@@ -2843,16 +3056,22 @@ class WallPaperObject : public QObject
 public:
     WallPaperObject(const WallPaper & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _sizesSource = another.sizes();
         _bgColor = another.bgColor();
         _color = another.color();
         _id = another.id();
         _title = another.title();
-        _sizes = new PhotoSizeList(another.sizes(), this);
+        _sizes = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(WallPaperObject));
+    }
+    WallPaperObject(QObject *parent = 0) : QObject(parent){
+        _sizes = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(WallPaperObject));
+    }
+    ~WallPaperObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(WallPaperObject));
     }
-    WallPaperObject(QObject *parent = 0) : QObject(parent){}
-    ~WallPaperObject(){}
 
     qint32 bgColor() const {
         return _bgColor;
@@ -2903,6 +3122,8 @@ public:
     }
 
     PhotoSizeList* sizes() const {
+        if( !_sizes )
+            const_cast<WallPaperObject*>(this)->init_sizes();
         return _sizes;
     }
 
@@ -2936,7 +3157,10 @@ public:
         emit idChanged();
         _title = another.title();
         emit titleChanged();
-        *_sizes = another.sizes();
+        if( _sizes )
+            *_sizes = another.sizes();
+        else
+            _sizesSource = another.sizes();
         emit sizesChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -2952,6 +3176,12 @@ signals:
     void sizesChanged();
     void classTypeChanged();
 
+private:
+    void init_sizes() {
+        _sizes = new PhotoSizeList(_sizesSource, this);
+        _sizesSource = QList<PhotoSize>();
+    }
+
 private:
     qint32 _bgColor;
     qint32 _color;
@@ -2959,6 +3189,7 @@ private:
     QString _title;
     PhotoSizeList* _sizes;
     qint64 _classType;
+    QList<PhotoSize> _sizesSource;
 
 };
 
@@ -2977,16 +3208,22 @@ class MessageActionObject : public QObject
 public:
     MessageActionObject(const MessageAction & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _photoSource = another.photo();
         _address = another.address();
         _userId = another.userId();
-        _photo = new PhotoObject(another.photo(), this);
+        _photo = 0;
         _title = another.title();
         _users = another.users();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageActionObject));
+    }
+    MessageActionObject(QObject *parent = 0) : QObject(parent){
+        _photo = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageActionObject));
+    }
+    ~MessageActionObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(MessageActionObject));
     }
-    MessageActionObject(QObject *parent = 0) : QObject(parent){}
-    ~MessageActionObject(){}
 
     QString address() const {
         return _address;
@@ -3013,6 +3250,8 @@ public:
     }
 
     PhotoObject* photo() const {
+        if( !_photo )
+            const_cast<MessageActionObject*>(this)->init_photo();
         return _photo;
     }
 
@@ -3066,7 +3305,10 @@ public:
         emit addressChanged();
         _userId = another.userId();
         emit userIdChanged();
-        *_photo = another.photo();
+        if( _photo )
+            *_photo = another.photo();
+        else
+            _photoSource = another.photo();
         emit photoChanged();
         _title = another.title();
         emit titleChanged();
@@ -3086,6 +3328,12 @@ signals:
     void usersChanged();
     void classTypeChanged();
 
+private:
+    void init_photo() {
+        _photo = new PhotoObject(_photoSource, this);
+        _photoSource = Photo();
+    }
+
 private:
     QString _address;
     qint32 _userId;
@@ -3093,6 +3341,7 @@ private:
     QString _title;
     QList<qint32> _users;
     qint64 _classType;
+    Photo _photoSource;
 
 };
 
@@ -3108,15 +3357,25 @@ class ChatPhotoObject : public QObject
 public:
     ChatPhotoObject(const ChatPhoto & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _photoBig = new FileLocationObject(another.photoBig(), this);
-        _photoSmall = new FileLocationObject(another.photoSmall(), this);
+        _photoBigSource = another.photoBig();
+        _photoSmallSource = another.photoSmall();
+        _photoBig = 0;
+        _photoSmall = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatPhotoObject));
+    }
+    ChatPhotoObject(QObject *parent = 0) : QObject(parent){
+        _photoBig = 0;
+        _photoSmall = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatPhotoObject));
+    }
+    ~ChatPhotoObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatPhotoObject));
     }
-    ChatPhotoObject(QObject *parent = 0) : QObject(parent){}
-    ~ChatPhotoObject(){}
 
     FileLocationObject* photoBig() const {
+        if( !_photoBig )
+            const_cast<ChatPhotoObject*>(this)->init_photoBig();
         return _photoBig;
     }
 
@@ -3129,6 +3388,8 @@ public:
     }
 
     FileLocationObject* photoSmall() const {
+        if( !_photoSmall )
+            const_cast<ChatPhotoObject*>(this)->init_photoSmall();
         return _photoSmall;
     }
 
@@ -3154,9 +3415,15 @@ public:
 
 
     void operator= ( const ChatPhoto & another) {
-        *_photoBig = another.photoBig();
+        if( _photoBig )
+            *_photoBig = another.photoBig();
+        else
+            _photoBigSource = another.photoBig();
         emit photoBigChanged();
-        *_photoSmall = another.photoSmall();
+        if( _photoSmall )
+            *_photoSmall = another.photoSmall();
+        else
+            _photoSmallSource = another.photoSmall();
         emit photoSmallChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -3169,10 +3436,22 @@ signals:
     void photoSmallChanged();
     void classTypeChanged();
 
+private:
+    void init_photoBig() {
+        _photoBig = new FileLocationObject(_photoBigSource, this);
+        _photoBigSource = FileLocation();
+    }
+    void init_photoSmall() {
+        _photoSmall = new FileLocationObject(_photoSmallSource, this);
+        _photoSmallSource = FileLocation();
+    }
+
 private:
     FileLocationObject* _photoBig;
     FileLocationObject* _photoSmall;
     qint64 _classType;
+    FileLocation _photoBigSource;
+    FileLocation _photoSmallSource;
 
 };
 
@@ -3190,17 +3469,29 @@ class ChatFullObject : public QObject
 public:
     ChatFullObject(const ChatFull & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _participants = new ChatParticipantsObject(another.participants(), this);
-        _chatPhoto = new PhotoObject(another.chatPhoto(), this);
+        _participantsSource = another.participants();
+        _chatPhotoSource = another.chatPhoto();
+        _notifySettingsSource = another.notifySettings();
+        _participants = 0;
+        _chatPhoto = 0;
         _id = another.id();
-        _notifySettings = new PeerNotifySettingsObject(another.notifySettings(), this);
+        _notifySettings = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatFullObject));
+    }
+    ChatFullObject(QObject *parent = 0) : QObject(parent){
+        _participants = 0;
+        _chatPhoto = 0;
+        _notifySettings = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatFullObject));
+    }
+    ~ChatFullObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatFullObject));
     }
-    ChatFullObject(QObject *parent = 0) : QObject(parent){}
-    ~ChatFullObject(){}
 
     ChatParticipantsObject* participants() const {
+        if( !_participants )
+            const_cast<ChatFullObject*>(this)->init_participants();
         return _participants;
     }
 
@@ -3213,6 +3504,8 @@ public:
     }
 
     PhotoObject* chatPhoto() const {
+        if( !_chatPhoto )
+            const_cast<ChatFullObject*>(this)->init_chatPhoto();
         return _chatPhoto;
     }
 
@@ -3237,6 +3530,8 @@ public:
     }
 
     PeerNotifySettingsObject* notifySettings() const {
+        if( !_notifySettings )
+            const_cast<ChatFullObject*>(this)->init_notifySettings();
         return _notifySettings;
     }
 
@@ -3262,13 +3557,22 @@ public:
 
 
     void operator= ( const ChatFull & another) {
-        *_participants = another.participants();
+        if( _participants )
+            *_participants = another.participants();
+        else
+            _participantsSource = another.participants();
         emit participantsChanged();
-        *_chatPhoto = another.chatPhoto();
+        if( _chatPhoto )
+            *_chatPhoto = another.chatPhoto();
+        else
+            _chatPhotoSource = another.chatPhoto();
         emit chatPhotoChanged();
         _id = another.id();
         emit idChanged();
-        *_notifySettings = another.notifySettings();
+        if( _notifySettings )
+            *_notifySettings = another.notifySettings();
+        else
+            _notifySettingsSource = another.notifySettings();
         emit notifySettingsChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -3283,12 +3587,29 @@ signals:
     void notifySettingsChanged();
     void classTypeChanged();
 
+private:
+    void init_participants() {
+        _participants = new ChatParticipantsObject(_participantsSource, this);
+        _participantsSource = ChatParticipants();
+    }
+    void init_chatPhoto() {
+        _chatPhoto = new PhotoObject(_chatPhotoSource, this);
+        _chatPhotoSource = Photo();
+    }
+    void init_notifySettings() {
+        _notifySettings = new PeerNotifySettingsObject(_notifySettingsSource, this);
+        _notifySettingsSource = PeerNotifySettings();
+    }
+
 private:
     ChatParticipantsObject* _participants;
     PhotoObject* _chatPhoto;
     qint32 _id;
     PeerNotifySettingsObject* _notifySettings;
     qint64 _classType;
+    ChatParticipants _participantsSource;
+    Photo _chatPhotoSource;
+    PeerNotifySettings _notifySettingsSource;
 
 };
 
@@ -3305,14 +3626,22 @@ class UserProfilePhotoObject : public QObject
 public:
     UserProfilePhotoObject(const UserProfilePhoto & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _photoBigSource = another.photoBig();
+        _photoSmallSource = another.photoSmall();
         _photoId = another.photoId();
-        _photoBig = new FileLocationObject(another.photoBig(), this);
-        _photoSmall = new FileLocationObject(another.photoSmall(), this);
+        _photoBig = 0;
+        _photoSmall = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserProfilePhotoObject));
+    }
+    UserProfilePhotoObject(QObject *parent = 0) : QObject(parent){
+        _photoBig = 0;
+        _photoSmall = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserProfilePhotoObject));
+    }
+    ~UserProfilePhotoObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(UserProfilePhotoObject));
     }
-    UserProfilePhotoObject(QObject *parent = 0) : QObject(parent){}
-    ~UserProfilePhotoObject(){}
 
     qint64 photoId() const {
         return _photoId;
@@ -3327,6 +3656,8 @@ public:
     }
 
     FileLocationObject* photoBig() const {
+        if( !_photoBig )
+            const_cast<UserProfilePhotoObject*>(this)->init_photoBig();
         return _photoBig;
     }
 
@@ -3339,6 +3670,8 @@ public:
     }
 
     FileLocationObject* photoSmall() const {
+        if( !_photoSmall )
+            const_cast<UserProfilePhotoObject*>(this)->init_photoSmall();
         return _photoSmall;
     }
 
@@ -3366,9 +3699,15 @@ public:
     void operator= ( const UserProfilePhoto & another) {
         _photoId = another.photoId();
         emit photoIdChanged();
-        *_photoBig = another.photoBig();
+        if( _photoBig )
+            *_photoBig = another.photoBig();
+        else
+            _photoBigSource = another.photoBig();
         emit photoBigChanged();
-        *_photoSmall = another.photoSmall();
+        if( _photoSmall )
+            *_photoSmall = another.photoSmall();
+        else
+            _photoSmallSource = another.photoSmall();
         emit photoSmallChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -3382,11 +3721,23 @@ signals:
     void photoSmallChanged();
     void classTypeChanged();
 
+private:
+    void init_photoBig() {
+        _photoBig = new FileLocationObject(_photoBigSource, this);
+        _photoBigSource = FileLocation();
+    }
+    void init_photoSmall() {
+        _photoSmall = new FileLocationObject(_photoSmallSource, this);
+        _photoSmallSource = FileLocation();
+    }
+
 private:
     qint64 _photoId;
     FileLocationObject* _photoBig;
     FileLocationObject* _photoSmall;
     qint64 _classType;
+    FileLocation _photoBigSource;
+    FileLocation _photoSmallSource;
 
 };
 
@@ -3412,6 +3763,8 @@ class ChatObject : public QObject
 public:
     ChatObject(const Chat & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _photoSource = another.photo();
+        _geoSource = another.geo();
         _participantsCount = another.participantsCount();
         _id = another.id();
         _version = another.version();
@@ -3419,16 +3772,22 @@ public:
         _title = another.title();
         _address = another.address();
         _date = another.date();
-        _photo = new ChatPhotoObject(another.photo(), this);
-        _geo = new GeoPointObject(another.geo(), this);
+        _photo = 0;
+        _geo = 0;
         _accessHash = another.accessHash();
         _checkedIn = another.checkedIn();
         _left = another.left();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatObject));
+    }
+    ChatObject(QObject *parent = 0) : QObject(parent){
+        _photo = 0;
+        _geo = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(ChatObject));
+    }
+    ~ChatObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(ChatObject));
     }
-    ChatObject(QObject *parent = 0) : QObject(parent){}
-    ~ChatObject(){}
 
     qint32 participantsCount() const {
         return _participantsCount;
@@ -3515,6 +3874,8 @@ public:
     }
 
     ChatPhotoObject* photo() const {
+        if( !_photo )
+            const_cast<ChatObject*>(this)->init_photo();
         return _photo;
     }
 
@@ -3527,6 +3888,8 @@ public:
     }
 
     GeoPointObject* geo() const {
+        if( !_geo )
+            const_cast<ChatObject*>(this)->init_geo();
         return _geo;
     }
 
@@ -3602,9 +3965,15 @@ public:
         emit addressChanged();
         _date = another.date();
         emit dateChanged();
-        *_photo = another.photo();
+        if( _photo )
+            *_photo = another.photo();
+        else
+            _photoSource = another.photo();
         emit photoChanged();
-        *_geo = another.geo();
+        if( _geo )
+            *_geo = another.geo();
+        else
+            _geoSource = another.geo();
         emit geoChanged();
         _accessHash = another.accessHash();
         emit accessHashChanged();
@@ -3633,6 +4002,16 @@ signals:
     void leftChanged();
     void classTypeChanged();
 
+private:
+    void init_photo() {
+        _photo = new ChatPhotoObject(_photoSource, this);
+        _photoSource = ChatPhoto();
+    }
+    void init_geo() {
+        _geo = new GeoPointObject(_geoSource, this);
+        _geoSource = GeoPoint();
+    }
+
 private:
     qint32 _participantsCount;
     qint32 _id;
@@ -3647,6 +4026,8 @@ private:
     bool _checkedIn;
     bool _left;
     qint64 _classType;
+    ChatPhoto _photoSource;
+    GeoPoint _geoSource;
 
 };
 
@@ -3666,18 +4047,28 @@ class DialogObject : public QObject
 public:
     DialogObject(const Dialog & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _peer = new PeerObject(another.peer(), this);
-        _notifySettings = new PeerNotifySettingsObject(another.notifySettings(), this);
+        _peerSource = another.peer();
+        _notifySettingsSource = another.notifySettings();
+        _peer = 0;
+        _notifySettings = 0;
         _topMessage = another.topMessage();
         _unreadCount = another.unreadCount();
         _encrypted = false;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DialogObject));
+    }
+    DialogObject(QObject *parent = 0) : QObject(parent){
+        _peer = 0;
+        _notifySettings = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DialogObject));
+    }
+    ~DialogObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DialogObject));
     }
-    DialogObject(QObject *parent = 0) : QObject(parent){}
-    ~DialogObject(){}
 
     PeerObject* peer() const {
+        if( !_peer )
+            const_cast<DialogObject*>(this)->init_peer();
         return _peer;
     }
 
@@ -3690,6 +4081,8 @@ public:
     }
 
     PeerNotifySettingsObject* notifySettings() const {
+        if( !_notifySettings )
+            const_cast<DialogObject*>(this)->init_notifySettings();
         return _notifySettings;
     }
 
@@ -3763,9 +4156,15 @@ public:
 
 
     void operator= ( const Dialog & another) {
-        *_peer = another.peer();
+        if( _peer )
+            *_peer = another.peer();
+        else
+            _peerSource = another.peer();
         emit peerChanged();
-        *_notifySettings = another.notifySettings();
+        if( _notifySettings )
+            *_notifySettings = another.notifySettings();
+        else
+            _notifySettingsSource = another.notifySettings();
         emit notifySettingsChanged();
         _topMessage = another.topMessage();
         emit topMessageChanged();
@@ -3788,6 +4187,16 @@ signals:
     void typingUsersChanged();
     void classTypeChanged();
 
+private:
+    void init_peer() {
+        _peer = new PeerObject(_peerSource, this);
+        _peerSource = Peer();
+    }
+    void init_notifySettings() {
+        _notifySettings = new PeerNotifySettingsObject(_notifySettingsSource, this);
+        _notifySettingsSource = PeerNotifySettings();
+    }
+
 private:
     PeerObject* _peer;
     PeerNotifySettingsObject* _notifySettings;
@@ -3796,6 +4205,8 @@ private:
     bool _encrypted;
     QStringList _typingUsers;
     qint64 _classType;
+    Peer _peerSource;
+    PeerNotifySettings _notifySettingsSource;
 
 };
 
@@ -3810,10 +4221,14 @@ public:
     SendMessageActionObject(const SendMessageAction & another, QObject *parent = 0) : QObject(parent){
         (void)another;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(SendMessageActionObject));
+    }
+    SendMessageActionObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(SendMessageActionObject));
+    }
+    ~SendMessageActionObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(SendMessageActionObject));
     }
-    SendMessageActionObject(QObject *parent = 0) : QObject(parent){}
-    ~SendMessageActionObject(){}
 
     qint64 classType() const {
         return _classType;
@@ -3859,17 +4274,23 @@ class DecryptedMessageActionObject : public QObject
 public:
     DecryptedMessageActionObject(const DecryptedMessageAction & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _actionSource = another.action();
         _layer = another.layer();
         _randomIds = another.randomIds();
         _ttlSeconds = another.ttlSeconds();
         _startSeqNo = another.startSeqNo();
         _endSeqNo = another.endSeqNo();
-        _action = new SendMessageActionObject(another.action(), this);
+        _action = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageActionObject));
+    }
+    DecryptedMessageActionObject(QObject *parent = 0) : QObject(parent){
+        _action = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageActionObject));
+    }
+    ~DecryptedMessageActionObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DecryptedMessageActionObject));
     }
-    DecryptedMessageActionObject(QObject *parent = 0) : QObject(parent){}
-    ~DecryptedMessageActionObject(){}
 
     qint32 layer() const {
         return _layer;
@@ -3932,6 +4353,8 @@ public:
     }
 
     SendMessageActionObject* action() const {
+        if( !_action )
+            const_cast<DecryptedMessageActionObject*>(this)->init_action();
         return _action;
     }
 
@@ -3967,7 +4390,10 @@ public:
         emit startSeqNoChanged();
         _endSeqNo = another.endSeqNo();
         emit endSeqNoChanged();
-        *_action = another.action();
+        if( _action )
+            *_action = another.action();
+        else
+            _actionSource = another.action();
         emit actionChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -3984,6 +4410,12 @@ signals:
     void actionChanged();
     void classTypeChanged();
 
+private:
+    void init_action() {
+        _action = new SendMessageActionObject(_actionSource, this);
+        _actionSource = SendMessageAction();
+    }
+
 private:
     qint32 _layer;
     QList<qint64> _randomIds;
@@ -3992,6 +4424,7 @@ private:
     qint32 _endSeqNo;
     SendMessageActionObject* _action;
     qint64 _classType;
+    SendMessageAction _actionSource;
 
 };
 
@@ -4040,10 +4473,14 @@ public:
         _fileName = another.fileName();
         _mimeType = another.mimeType();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageMediaObject));
+    }
+    DecryptedMessageMediaObject(QObject *parent = 0) : QObject(parent){
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageMediaObject));
+    }
+    ~DecryptedMessageMediaObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DecryptedMessageMediaObject));
     }
-    DecryptedMessageMediaObject(QObject *parent = 0) : QObject(parent){}
-    ~DecryptedMessageMediaObject(){}
 
     QByteArray thumb() const {
         return _thumb;
@@ -4361,17 +4798,25 @@ class DecryptedMessageObject : public QObject
 public:
     DecryptedMessageObject(const DecryptedMessage & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _mediaSource = another.media();
+        _actionSource = another.action();
         _randomId = another.randomId();
         _ttl = another.ttl();
         _randomBytes = another.randomBytes();
         _message = another.message();
-        _media = new DecryptedMessageMediaObject(another.media(), this);
-        _action = new DecryptedMessageActionObject(another.action(), this);
+        _media = 0;
+        _action = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageObject));
+    }
+    DecryptedMessageObject(QObject *parent = 0) : QObject(parent){
+        _media = 0;
+        _action = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(DecryptedMessageObject));
+    }
+    ~DecryptedMessageObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(DecryptedMessageObject));
     }
-    DecryptedMessageObject(QObject *parent = 0) : QObject(parent){}
-    ~DecryptedMessageObject(){}
 
     qint64 randomId() const {
         return _randomId;
@@ -4422,6 +4867,8 @@ public:
     }
 
     DecryptedMessageMediaObject* media() const {
+        if( !_media )
+            const_cast<DecryptedMessageObject*>(this)->init_media();
         return _media;
     }
 
@@ -4434,6 +4881,8 @@ public:
     }
 
     DecryptedMessageActionObject* action() const {
+        if( !_action )
+            const_cast<DecryptedMessageObject*>(this)->init_action();
         return _action;
     }
 
@@ -4467,9 +4916,15 @@ public:
         emit randomBytesChanged();
         _message = another.message();
         emit messageChanged();
-        *_media = another.media();
+        if( _media )
+            *_media = another.media();
+        else
+            _mediaSource = another.media();
         emit mediaChanged();
-        *_action = another.action();
+        if( _action )
+            *_action = another.action();
+        else
+            _actionSource = another.action();
         emit actionChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -4486,6 +4941,16 @@ signals:
     void actionChanged();
     void classTypeChanged();
 
+private:
+    void init_media() {
+        _media = new DecryptedMessageMediaObject(_mediaSource, this);
+        _mediaSource = DecryptedMessageMedia();
+    }
+    void init_action() {
+        _action = new DecryptedMessageActionObject(_actionSource, this);
+        _actionSource = DecryptedMessageAction();
+    }
+
 private:
     qint64 _randomId;
     qint32 _ttl;
@@ -4494,6 +4959,8 @@ private:
     DecryptedMessageMediaObject* _media;
     DecryptedMessageActionObject* _action;
     qint64 _classType;
+    DecryptedMessageMedia _mediaSource;
+    DecryptedMessageAction _actionSource;
 
 };
 
@@ -4517,23 +4984,39 @@ class MessageMediaObject : public QObject
 public:
     MessageMediaObject(const MessageMedia & another, QObject *parent = 0) : QObject(parent){
         (void)another;
-        _audio = new AudioObject(another.audio(), this);
+        _audioSource = another.audio();
+        _documentSource = another.document();
+        _geoSource = another.geo();
+        _photoSource = another.photo();
+        _videoSource = another.video();
+        _audio = 0;
         _lastName = another.lastName();
         _bytes = another.bytes();
         _firstName = another.firstName();
-        _document = new DocumentObject(another.document(), this);
-        _geo = new GeoPointObject(another.geo(), this);
-        _photo = new PhotoObject(another.photo(), this);
+        _document = 0;
+        _geo = 0;
+        _photo = 0;
         _phoneNumber = another.phoneNumber();
         _userId = another.userId();
-        _video = new VideoObject(another.video(), this);
+        _video = 0;
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageMediaObject));
+    }
+    MessageMediaObject(QObject *parent = 0) : QObject(parent){
+        _audio = 0;
+        _document = 0;
+        _geo = 0;
+        _photo = 0;
+        _video = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageMediaObject));
+    }
+    ~MessageMediaObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(MessageMediaObject));
     }
-    MessageMediaObject(QObject *parent = 0) : QObject(parent){}
-    ~MessageMediaObject(){}
 
     AudioObject* audio() const {
+        if( !_audio )
+            const_cast<MessageMediaObject*>(this)->init_audio();
         return _audio;
     }
 
@@ -4582,6 +5065,8 @@ public:
     }
 
     DocumentObject* document() const {
+        if( !_document )
+            const_cast<MessageMediaObject*>(this)->init_document();
         return _document;
     }
 
@@ -4594,6 +5079,8 @@ public:
     }
 
     GeoPointObject* geo() const {
+        if( !_geo )
+            const_cast<MessageMediaObject*>(this)->init_geo();
         return _geo;
     }
 
@@ -4606,6 +5093,8 @@ public:
     }
 
     PhotoObject* photo() const {
+        if( !_photo )
+            const_cast<MessageMediaObject*>(this)->init_photo();
         return _photo;
     }
 
@@ -4642,6 +5131,8 @@ public:
     }
 
     VideoObject* video() const {
+        if( !_video )
+            const_cast<MessageMediaObject*>(this)->init_video();
         return _video;
     }
 
@@ -4667,7 +5158,10 @@ public:
 
 
     void operator= ( const MessageMedia & another) {
-        *_audio = another.audio();
+        if( _audio )
+            *_audio = another.audio();
+        else
+            _audioSource = another.audio();
         emit audioChanged();
         _lastName = another.lastName();
         emit lastNameChanged();
@@ -4675,17 +5169,29 @@ public:
         emit bytesChanged();
         _firstName = another.firstName();
         emit firstNameChanged();
-        *_document = another.document();
+        if( _document )
+            *_document = another.document();
+        else
+            _documentSource = another.document();
         emit documentChanged();
-        *_geo = another.geo();
+        if( _geo )
+            *_geo = another.geo();
+        else
+            _geoSource = another.geo();
         emit geoChanged();
-        *_photo = another.photo();
+        if( _photo )
+            *_photo = another.photo();
+        else
+            _photoSource = another.photo();
         emit photoChanged();
         _phoneNumber = another.phoneNumber();
         emit phoneNumberChanged();
         _userId = another.userId();
         emit userIdChanged();
-        *_video = another.video();
+        if( _video )
+            *_video = another.video();
+        else
+            _videoSource = another.video();
         emit videoChanged();
         _classType = another.classType();
         emit classTypeChanged();
@@ -4706,6 +5212,28 @@ signals:
     void videoChanged();
     void classTypeChanged();
 
+private:
+    void init_audio() {
+        _audio = new AudioObject(_audioSource, this);
+        _audioSource = Audio();
+    }
+    void init_document() {
+        _document = new DocumentObject(_documentSource, this);
+        _documentSource = Document();
+    }
+    void init_geo() {
+        _geo = new GeoPointObject(_geoSource, this);
+        _geoSource = GeoPoint();
+    }
+    void init_photo() {
+        _photo = new PhotoObject(_photoSource, this);
+        _photoSource = Photo();
+    }
+    void init_video() {
+        _video = new VideoObject(_videoSource, this);
+        _videoSource = Video();
+    }
+
 private:
     AudioObject* _audio;
     QString _lastName;
@@ -4718,6 +5246,11 @@ private:
     qint32 _userId;
     VideoObject* _video;
     qint64 _classType;
+    Audio _audioSource;
+    Document _documentSource;
+    GeoPoint _geoSource;
+    Photo _photoSource;
+    Video _videoSource;
 
 };
 
@@ -4745,25 +5278,36 @@ class MessageObject : public QObject
 public:
     MessageObject(const Message & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _toIdSource = another.toId();
+        _actionSource = another.action();
+        _mediaSource = another.media();
         _id = another.id();
         _sent = true;
         _encrypted = false;
-        _upload = new UploadObject(this);
-        _toId = new PeerObject(another.toId(), this);
+        _upload = 0;
+        _toId = 0;
         _unread = another.unread();
-        _action = new MessageActionObject(another.action(), this);
+        _action = 0;
         _fromId = another.fromId();
         _out = another.out();
         _date = another.date();
-        _media = new MessageMediaObject(another.media(), this);
+        _media = 0;
         _fwdDate = another.fwdDate();
         _fwdFromId = another.fwdFromId();
         _message = another.message();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageObject));
+    }
+    MessageObject(QObject *parent = 0) : QObject(parent){
+        _upload = 0;
+        _toId = 0;
+        _action = 0;
+        _media = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(MessageObject));
+    }
+    ~MessageObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(MessageObject));
     }
-    MessageObject(QObject *parent = 0) : QObject(parent){}
-    ~MessageObject(){}
 
     qint32 id() const {
         return _id;
@@ -4802,6 +5346,8 @@ public:
     }
 
     UploadObject* upload() const {
+        if( !_upload )
+            const_cast<MessageObject*>(this)->init_upload();
         return _upload;
     }
 
@@ -4814,6 +5360,8 @@ public:
     }
 
     PeerObject* toId() const {
+        if( !_toId )
+            const_cast<MessageObject*>(this)->init_toId();
         return _toId;
     }
 
@@ -4838,6 +5386,8 @@ public:
     }
 
     MessageActionObject* action() const {
+        if( !_action )
+            const_cast<MessageObject*>(this)->init_action();
         return _action;
     }
 
@@ -4886,6 +5436,8 @@ public:
     }
 
     MessageMediaObject* media() const {
+        if( !_media )
+            const_cast<MessageObject*>(this)->init_media();
         return _media;
     }
 
@@ -4951,11 +5503,17 @@ public:
         emit idChanged();
         _sent = true;
         emit sentChanged();
-        *_toId = another.toId();
+        if( _toId )
+            *_toId = another.toId();
+        else
+            _toIdSource = another.toId();
         emit toIdChanged();
         _unread = another.unread();
         emit unreadChanged();
-        *_action = another.action();
+        if( _action )
+            *_action = another.action();
+        else
+            _actionSource = another.action();
         emit actionChanged();
         _fromId = another.fromId();
         emit fromIdChanged();
@@ -4963,7 +5521,10 @@ public:
         emit outChanged();
         _date = another.date();
         emit dateChanged();
-        *_media = another.media();
+        if( _media )
+            *_media = another.media();
+        else
+            _mediaSource = another.media();
         emit mediaChanged();
         _fwdDate = another.fwdDate();
         emit fwdDateChanged();
@@ -4994,6 +5555,23 @@ signals:
     void messageChanged();
     void classTypeChanged();
 
+private:
+    void init_upload() {
+        _upload = new UploadObject(this);
+    }
+    void init_toId() {
+        _toId = new PeerObject(_toIdSource, this);
+        _toIdSource = Peer();
+    }
+    void init_action() {
+        _action = new MessageActionObject(_actionSource, this);
+        _actionSource = MessageAction();
+    }
+    void init_media() {
+        _media = new MessageMediaObject(_mediaSource, this);
+        _mediaSource = MessageMedia();
+    }
+
 private:
     qint32 _id;
     bool _sent;
@@ -5010,6 +5588,9 @@ private:
     qint32 _fwdFromId;
     QString _message;
     qint64 _classType;
+    Peer _toIdSource;
+    MessageAction _actionSource;
+    MessageMedia _mediaSource;
 
 };
 
@@ -5030,18 +5611,26 @@ class GeoChatMessageObject : public QObject
 public:
     GeoChatMessageObject(const GeoChatMessage & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _actionSource = another.action();
+        _mediaSource = another.media();
         _id = another.id();
-        _action = new MessageActionObject(another.action(), this);
+        _action = 0;
         _fromId = another.fromId();
         _date = another.date();
-        _media = new MessageMediaObject(another.media(), this);
+        _media = 0;
         _chatId = another.chatId();
         _message = another.message();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(GeoChatMessageObject));
+    }
+    GeoChatMessageObject(QObject *parent = 0) : QObject(parent){
+        _action = 0;
+        _media = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(GeoChatMessageObject));
+    }
+    ~GeoChatMessageObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(GeoChatMessageObject));
     }
-    GeoChatMessageObject(QObject *parent = 0) : QObject(parent){}
-    ~GeoChatMessageObject(){}
 
     qint32 id() const {
         return _id;
@@ -5056,6 +5645,8 @@ public:
     }
 
     MessageActionObject* action() const {
+        if( !_action )
+            const_cast<GeoChatMessageObject*>(this)->init_action();
         return _action;
     }
 
@@ -5092,6 +5683,8 @@ public:
     }
 
     MessageMediaObject* media() const {
+        if( !_media )
+            const_cast<GeoChatMessageObject*>(this)->init_media();
         return _media;
     }
 
@@ -5143,13 +5736,19 @@ public:
     void operator= ( const GeoChatMessage & another) {
         _id = another.id();
         emit idChanged();
-        *_action = another.action();
+        if( _action )
+            *_action = another.action();
+        else
+            _actionSource = another.action();
         emit actionChanged();
         _fromId = another.fromId();
         emit fromIdChanged();
         _date = another.date();
         emit dateChanged();
-        *_media = another.media();
+        if( _media )
+            *_media = another.media();
+        else
+            _mediaSource = another.media();
         emit mediaChanged();
         _chatId = another.chatId();
         emit chatIdChanged();
@@ -5171,6 +5770,16 @@ signals:
     void messageChanged();
     void classTypeChanged();
 
+private:
+    void init_action() {
+        _action = new MessageActionObject(_actionSource, this);
+        _actionSource = MessageAction();
+    }
+    void init_media() {
+        _media = new MessageMediaObject(_mediaSource, this);
+        _mediaSource = MessageMedia();
+    }
+
 private:
     qint32 _id;
     MessageActionObject* _action;
@@ -5180,6 +5789,8 @@ private:
     qint32 _chatId;
     QString _message;
     qint64 _classType;
+    MessageAction _actionSource;
+    MessageMedia _mediaSource;
 
 };
 
@@ -5202,20 +5813,28 @@ class UserObject : public QObject
 public:
     UserObject(const User & another, QObject *parent = 0) : QObject(parent){
         (void)another;
+        _photoSource = another.photo();
+        _statusSource = another.status();
         _id = another.id();
         _accessHash = another.accessHash();
         _inactive = another.inactive();
         _phone = another.phone();
         _firstName = another.firstName();
-        _photo = new UserProfilePhotoObject(another.photo(), this);
-        _status = new UserStatusObject(another.status(), this);
+        _photo = 0;
+        _status = 0;
         _lastName = another.lastName();
         _username = another.username();
         _classType = another.classType();
-
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserObject));
+    }
+    UserObject(QObject *parent = 0) : QObject(parent){
+        _photo = 0;
+        _status = 0;
+        TypeObjectCounter::created(&staticMetaObject, sizeof(UserObject));
+    }
+    ~UserObject(){
+        TypeObjectCounter::destroyed(&staticMetaObject, sizeof(UserObject));
     }
-    UserObject(QObject *parent = 0) : QObject(parent){}
-    ~UserObject(){}
 
     qint32 id() const {
         return _id;
@@ -5278,6 +5897,8 @@ public:
     }
 
     UserProfilePhotoObject* photo() const {
+        if( !_photo )
+            const_cast<UserObject*>(this)->init_photo();
         return _photo;
     }
 
@@ -5290,6 +5911,8 @@ public:
     }
 
     UserStatusObject* status() const {
+        if( !_status )
+            const_cast<UserObject*>(this)->init_status();
         return _status;
     }
 
@@ -5349,9 +5972,15 @@ public:
         emit phoneChanged();
         _firstName = another.firstName();
         emit firstNameChanged();
-        *_photo = another.photo();
+        if( _photo )
+            *_photo = another.photo();
+        else
+            _photoSource = another.photo();
         emit photoChanged();
-        *_status = another.status();
+        if( _status )
+            *_status = another.status();
+        else
+            _statusSource = another.status();
         emit statusChanged();
         _lastName = another.lastName();
         emit lastNameChanged();
@@ -5375,6 +6004,16 @@ signals:
     void usernameChanged();
     void classTypeChanged();
 
+private:
+    void init_photo() {
+        _photo = new UserProfilePhotoObject(_photoSource, this);
+        _photoSource = UserProfilePhoto();
+    }
+    void init_status() {
+        _status = new UserStatusObject(_statusSource, this);
+        _statusSource = UserStatus();
+    }
+
 private:
     qint32 _id;
     qint64 _accessHash;
@@ -5386,6 +6025,8 @@ private:
     QString _lastName;
     QString _username;
     qint64 _classType;
+    UserProfilePhoto _photoSource;
+    UserStatus _statusSource;
 
 };
 
@@ -5505,7 +6146,6 @@ static bool initialize() {
     qmlRegisterType<UserObject>("CutegramTypes", 1, 0, "User");
     qRegisterMetaType<UserObject*>("UserObject*");
 
-
     qmlRegisterType<PhotoSizeList>("CutegramTypes", 1, 0, "PhotoSizeList");
     qRegisterMetaType<PhotoSizeList*>("PhotoSizeList*");
     
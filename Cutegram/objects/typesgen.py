@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+#
+# Generates types.h from types.sco and the templates directory. It reads
+# the same input format as Aseman Object Creator, plus the extensions the
+# type objects need:
+#
+#   Type name rw lazy = new TypeObject(another.%name(), this);
+#       The child is built on first access by init_<name>(). Until then
+#       only its own source value is kept, and operator= updates either
+#       the built child or that value.
+#
+#   Type name rw keep = value;
+#       The property is set by the constructor only, operator= leaves it.
+#
+#   assign {
+#       ...
+#   }
+#       Code put at the start of operator=, before the generated part.
+#
+# Objects without any property taken from "another" get no source type:
+# only a default constructor and no operator=.
+#
+# Usage: typesgen.py types.sco templates types.h
+
+import os
+import re
+import sys
+
+PROPERTY_RE = re.compile(r'^\s*(\S+)\s+(\w+)\s+rw((?:\s+(?:lazy|keep))*)\s*(?:=\s*(.*?))?\s*;\s*$')
+CHILD_RE = re.compile(r'^new\s+(\w+)\((.*)\)$')
+
+
+class Property:
+    def __init__(self, type, name, flags, init):
+        self.type = type
+        self.name = name
+        self.lazy = 'lazy' in flags
+        self.keep = 'keep' in flags
+        self.init = init.replace('%name', name) if init is not None else None
+
+    def pointer(self):
+        return self.type.endswith('*')
+
+    def fromSource(self):
+        return self.init is not None and 'another.' in self.init
+
+    def child(self):
+        # Class name and constructor arguments of a "new X(...)" initializer
+        m = CHILD_RE.match(self.init or '')
+        return (m.group(1), m.group(2)) if m else (None, None)
+
+    def sourceType(self):
+        cls = self.child()[0]
+        if cls.endswith('Object'):
+            return cls[:-len('Object')]
+        if cls.endswith('List'):
+            return 'QList<%s>' % cls[:-len('List')]
+        raise ValueError('No source type for ' + cls)
+
+    def lazySource(self):
+        return self.lazy and self.fromSource()
+
+    def cap(self):
+        return self.name[0].upper() + self.name[1:]
+
+
+class Object:
+    def __init__(self, name):
+        self.name = name
+        self.properties = []
+        self.assign = []
+
+    def hasSource(self):
+        return any(p.fromSource() for p in self.properties)
+
+
+def parse(path):
+    title = ''
+    includes = []
+    objects = []
+    obj = None
+    assign = False
+    for line in open(path).read().split('\n'):
+        stripped = line.strip()
+        if assign:
+            depth += line.count('{') - line.count('}')
+            if depth < 0:
+                assign = False
+            else:
+                obj.assign.append(line)
+            continue
+        if not stripped:
+            continue
+        if stripped.startswith('#'):
+            title = stripped[1:]
+        elif stripped.startswith('include '):
+            includes.append('#include ' + stripped[len('include '):].rstrip(';').strip())
+        elif stripped.startswith('object '):
+            obj = Object(stripped[len('object '):].rstrip('{').strip())
+            objects.append(obj)
+        elif stripped == '}':
+            obj = None
+        elif stripped == 'assign {':
+            assign = True
+            depth = 0
+        elif obj is not None:
+            m = PROPERTY_RE.match(line)
+            if m:
+                obj.properties.append(Property(m.group(1), m.group(2), m.group(3).split(), m.group(4)))
+    return title, includes, objects
+
+
+def fill(template, values):
+    # A line holding only a placeholder that expands to nothing is dropped
+    out = []
+    for line in template.split('\n'):
+        key = line.strip()
+        if key in values and not values[key]:
+            continue
+        for k in sorted(values.keys(), key=len, reverse=True):
+            line = line.replace(k, values[k])
+        out.append(line)
+    return '\n'.join(out)
+
+
+def lines(items):
+    return '\n'.join(items)
+
+
+def generateObject(obj, templates):
+    n = obj.name
+    props = obj.properties
+
+    properties = lines('    Q_PROPERTY(%s %s READ %s WRITE set%s NOTIFY %sChanged)' % (p.type, p.name, p.name, p.cap(), p.name)
+                       for p in props)
+
+    body = []
+    for p in props:
+        getter = ['    %s %s() const {' % (p.type, p.name)]
+        if p.lazy:
+            getter += ['        if( !_%s )' % p.name,
+                       '            const_cast<%sObject*>(this)->init_%s();' % (n, p.name)]
+        getter += ['        return _%s;' % p.name, '    }', '']
+        setter = ['    void set%s(%s value) {' % (p.cap(), p.type),
+                  '        if( value == _%s )' % p.name,
+                  '            return;',
+                  '        _%s = value;' % p.name,
+                  '        emit %sChanged();' % p.name,
+                  '        emit changed();',
+                  '    }', '']
+        body += getter + setter
+
+    presets = []
+    for p in props:
+        if p.init is None:
+            continue
+        presets.append('        _%s = %s;' % (p.name, '0' if p.lazy else p.init))
+
+    lazysources = lines('        _%sSource = another.%s();' % (p.name, p.name) for p in props if p.lazySource())
+    lazypresets = lines('        _%s = 0;' % p.name for p in props if p.lazy)
+
+    equals = list(obj.assign)
+    for p in props:
+        if p.keep:
+            continue
+        if p.lazySource():
+            equals += ['        if( _%s )' % p.name,
+                       '            *_%s = another.%s();' % (p.name, p.name),
+                       '        else',
+                       '            _%sSource = another.%s();' % (p.name, p.name)]
+        elif p.lazy:
+            continue
+        elif p.pointer() and p.fromSource():
+            equals.append('        *_%s = another.%s();' % (p.name, p.name))
+        elif p.init is None:
+            equals.append('        _%s.clear();' % p.name)
+        else:
+            equals.append('        _%s = %s;' % (p.name, p.init))
+        equals.append('        emit %sChanged();' % p.name)
+
+    lazyinits = []
+    for p in props:
+        if not p.lazy:
+            continue
+        cls, args = p.child()
+        lazyinits += ['    void init_%s() {' % p.name]
+        if p.lazySource():
+            lazyinits += ['        _%s = new %s(_%sSource, this);' % (p.name, cls, p.name),
+                          '        _%sSource = %s();' % (p.name, p.sourceType())]
+        else:
+            lazyinits += ['        _%s = %s;' % (p.name, p.init)]
+        lazyinits += ['    }']
+    if lazyinits:
+        lazyinits = ['private:'] + lazyinits + ['']
+
+    values = {
+        '%properties': properties,
+        '%lazysources': lazysources,
+        '%presets': lines(presets),
+        '%lazypresets': lazypresets,
+        '%body': lines(body),
+        '%equals': lines(equals),
+        '%notifies': lines('    void %sChanged();' % p.name for p in props),
+        '%lazyinits': lines(lazyinits),
+        '%variables': lines('    %s _%s;' % (p.type, p.name) for p in props),
+        '%lazyvariables': lines('    %s _%sSource;' % (p.sourceType(), p.name) for p in props if p.lazySource()),
+        '%name': n,
+    }
+
+    template = templates['class' if obj.hasSource() else 'plain']
+    return fill(template, values)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.stderr.write('Usage: %s types.sco templates types.h\n' % sys.argv[0])
+        return 1
+
+    sco, tdir, output = sys.argv[1:]
+    templates = {}
+    for t in ('file', 'class', 'plain', 'initialize'):
+        templates[t] = open(os.path.join(tdir, t + '.template')).read()
+
+    title, includes, objects = parse(sco)
+    classes = ''.join(generateObject(obj, templates) for obj in objects)
+    initializes = '\n'.join(fill(templates['initialize'], {'%name': obj.name, '%intializes': ''}) for obj in objects)
+
+    result = fill(templates['file'], {
+        '%title': title,
+        '%includes': lines(includes),
+        '%classes': classes,
+        '%intializes': initializes,
+    })
+
+    open(output, 'w').write(result)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -18,6 +18,7 @@
 
 #include "photosizelist.h"
 #include "objects/types.h"
+#include "typeobjectcounter.h"
 
 class PhotoSizeListPrivate
 {
@@ -29,12 +30,14 @@ PhotoSizeList::PhotoSizeList(QObject *parent) :
     QObject(parent)
 {
     p = new PhotoSizeListPrivate;
+    TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoSizeList)+sizeof(PhotoSizeListPrivate));
 }
 
 PhotoSizeList::PhotoSizeList(const QList<PhotoSize> & another, QObject *parent) :
     QObject(parent)
 {
     p = new PhotoSizeListPrivate;
+    TypeObjectCounter::created(&staticMetaObject, sizeof(PhotoSizeList)+sizeof(PhotoSizeListPrivate));
     operator =(another);
 }
 
@@ -95,5 +98,6 @@ PhotoSizeObject *PhotoSizeList::at(int idx)
 
 PhotoSizeList::~PhotoSizeList()
 {
+    TypeObjectCounter::destroyed(&staticMetaObject, sizeof(PhotoSizeList)+sizeof(PhotoSizeListPrivate));
     delete p;
 }
@@ -26,13 +26,22 @@ Item {
 
     property bool hasAction: action.classType != typeMessageActionEmpty
 
+    property variant requestedLocation
+
     onImgLocationChanged: {
+        if(requestedLocation) {
+            telegramObject.releaseFile(requestedLocation)
+            requestedLocation = undefined
+        }
         if(imgLocation == telegramObject.nullLocation)
             return
 
+        requestedLocation = imgLocation
         telegramObject.getFile(imgLocation)
     }
 
+    Component.onDestruction: if(requestedLocation) telegramObject.releaseFile(requestedLocation)
+
     Column {
         id: column
         anchors.left: parent.left
@@ -26,6 +26,7 @@ Item {
     property bool visibleNames: true
 
     property Message message
+    property Message retainedMessage
     property User user: telegramObject.user(message.fromId)
     property User fwdUser: telegramObject.user(message.fwdFromId)
 
@@ -59,6 +60,16 @@ Item {
             indicator.start()
     }
 
+    onMessageChanged: {
+        if(retainedMessage)
+            telegramObject.releaseMessage(retainedMessage)
+        retainedMessage = message
+        if(retainedMessage)
+            telegramObject.retainMessage(retainedMessage)
+    }
+
+    Component.onDestruction: if(retainedMessage) telegramObject.releaseMessage(retainedMessage)
+
     Connections {
         target: telegramObject.userData
         onLoadLinkChanged: {
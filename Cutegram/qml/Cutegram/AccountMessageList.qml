@@ -61,6 +61,7 @@ Rectangle {
                     focus_msg_timer.restart()
             }
         }
+        onMessagesLoaded: emojis.prerender(texts)
         onHasNewMessageChanged: {
             if(!hasNewMessageChanged)
                 return
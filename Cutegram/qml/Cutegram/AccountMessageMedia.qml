@@ -32,6 +32,7 @@ Item {
     property real typeInputDocumentFileLocation: 0x4e45abe9
 
     property variant mediaPlayer
+    property variant thumbLocation
     property bool mediaPlayerState: media.classType == typeMessageMediaAudio
     onMediaPlayerStateChanged: {
         if(mediaPlayerState) {
@@ -78,28 +79,36 @@ Item {
     }
 
     onHasMediaChanged: {
+        if(thumbLocation) {
+            telegramObject.releaseFile(thumbLocation)
+            thumbLocation = undefined
+        }
         if( !hasMedia )
             return
 
         switch( media.classType )
         {
         case typeMessageMediaPhoto:
-            telegramObject.getFile(media.photo.sizes.last.location)
+            thumbLocation = media.photo.sizes.last.location
             break;
 
         case typeMessageMediaVideo:
-            telegramObject.getFile(media.video.thumb.location)
+            thumbLocation = media.video.thumb.location
             break;
 
         case typeMessageMediaDocument:
-            telegramObject.getFile(media.document.thumb.location)
+            thumbLocation = media.document.thumb.location
             break;
 
         default:
-            break;
+            return
         }
+
+        telegramObject.getFile(thumbLocation)
     }
 
+    Component.onDestruction: if(thumbLocation) telegramObject.releaseFile(thumbLocation)
+
     width: {
         var result
         if(mediaPlayer)
@@ -30,6 +30,7 @@ Rectangle {
         id: emojis_obj
         currentTheme: "twitter"
         userData: telegramObject.userData
+        onHtmlsPrerendered: Cutegram.prefetchHtmlWidths(htmls)
     }
 
     HashObject {
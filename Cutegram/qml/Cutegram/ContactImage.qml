@@ -51,11 +51,22 @@ Item {
         }
     }
 
-    onLocationObjChanged: telegram.getFile(locationObj)
+    property variant requestedLocation
+
+    onLocationObjChanged: requestFile()
+    Component.onDestruction: if(requestedLocation) telegram.releaseFile(requestedLocation)
 
     Connections {
         target: locationObj
-        onDownloadChanged: telegram.getFile(locationObj)
+        onDownloadChanged: requestFile()
+    }
+
+    function requestFile() {
+        if(requestedLocation)
+            telegram.releaseFile(requestedLocation)
+
+        requestedLocation = locationObj
+        telegram.getFile(locationObj)
     }
 
     Rectangle {
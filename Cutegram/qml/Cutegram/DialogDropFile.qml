@@ -162,13 +162,16 @@ Item {
             else
             if( drop.hasUrls ) {
                 var urls = drop.urls
+                var files = new Array
                 for( var i=0; i<urls.length; i++ ) {
                     var url = urls[i]
                     if(url.slice(0,7) == "file://")
-                        telegramObject.sendFile(dId, url, !normalDrop)
+                        files[files.length] = url
                     else
                         telegramObject.sendMessage(dId, url)
                 }
+                if(files.length != 0)
+                    telegramObject.sendFiles(dId, files, !normalDrop)
 
                 am_dropfile.dropped()
             }
@@ -1,5 +1,6 @@
 #include "tagfiltermodel.h"
 #include "userdata.h"
+#include "asemantools/asemanlistdiff.h"
 
 #include <QPointer>
 #include <QStringList>
@@ -115,66 +116,15 @@ void TagFilterModel::listChanged()
 {
     QStringList tags;
     if(p->userData)
-        tags = p->userData->tags();
-
-    const QString &keywod = p->keyword.toLower();
-    for(int i=0; i<tags.count(); i++)
-    {
-        if(tags.at(i).contains(keywod))
-            continue;
-
-        tags.removeAt(i);
-        i--;
-    }
-
-    for( int i=0 ; i<p->tags.count() ; i++ )
-    {
-        const QString &tag = p->tags.at(i);
-        if( tags.contains(tag) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->tags.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
-
-
-    QStringList temp_tags = tags;
-    for( int i=0 ; i<temp_tags.count() ; i++ )
-    {
-        const QString &tag = temp_tags.at(i);
-        if( p->tags.contains(tag) )
-            continue;
-
-        temp_tags.removeAt(i);
-        i--;
-    }
-    while( p->tags != temp_tags )
-        for( int i=0 ; i<p->tags.count() ; i++ )
-        {
-            const QString &tag = p->tags.at(i);
-            int nw = temp_tags.indexOf(tag);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->tags.move( i, nw );
-            endMoveRows();
-        }
-
-
-    for( int i=0 ; i<tags.count() ; i++ )
     {
-        const QString &tag = tags.at(i);
-        if( p->tags.contains(tag) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->tags.insert( i, tag );
-        endInsertRows();
+        const QString &keywod = p->keyword.toLower();
+        const QStringList &ranked = p->userData->tags();
+        foreach(const QString &tag, ranked)
+            if(tag.contains(keywod))
+                tags << tag;
     }
 
+    AsemanListDiff::apply(this, p->tags, tags);
     emit countChanged();
 }
 
@@ -8,6 +8,7 @@ class TagFilterModelPrivate;
 class TagFilterModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
     Q_PROPERTY(UserData* userData READ userData WRITE setUserData NOTIFY userDataChanged)
     Q_PROPERTY(QString keyword READ keyword WRITE setKeyword NOTIFY keywordChanged)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
@@ -21,6 +21,7 @@
 #include "objects/types.h"
 #include "userdata.h"
 #include "database.h"
+#include "asemantools/asemanlistdiff.h"
 
 #include <telegram.h>
 
@@ -33,6 +34,7 @@ public:
     int refresh_timer;
 
     QList<qint64> dialogs;
+    int specials;
 };
 
 TelegramDialogsModel::TelegramDialogsModel(QObject *parent) :
@@ -42,6 +44,7 @@ TelegramDialogsModel::TelegramDialogsModel(QObject *parent) :
     p->telegram = 0;
     p->initializing = false;
     p->refresh_timer = 0;
+    p->specials = 0;
 }
 
 TelegramQml *TelegramDialogsModel::telegram() const
@@ -69,6 +72,7 @@ void TelegramDialogsModel::setTelegram(TelegramQml *tgo)
         return;
 
     connect( p->telegram, SIGNAL(dialogsChanged(bool)), SLOT(dialogsChanged(bool)) );
+    connect( p->telegram, SIGNAL(dialogIndexChanged(qint64,int,int)), SLOT(dialogIndexChanged(qint64,int,int)) );
     connect( p->telegram, SIGNAL(phoneNumberChanged()), SLOT(refreshDatabase()), Qt::QueuedConnection );
 
     connect( p->telegram->userData(), SIGNAL(favoriteChanged(int)) , this, SLOT(userDataChanged()) );
@@ -167,57 +171,58 @@ void TelegramDialogsModel::dialogsChanged(bool cachedData)
     p->refresh_timer = startTimer(100);
 }
 
-void TelegramDialogsModel::dialogsChanged_priv()
+void TelegramDialogsModel::dialogIndexChanged(qint64 dId, int from, int to)
 {
-    const QList<qint64> & dialogs = fixDialogs(p->telegram->dialogs());
-
-    for( int i=0 ; i<p->dialogs.count() ; i++ )
+    UserData *udata = p->telegram->userData();
+    if( p->initializing || p->refresh_timer || dId == udata->value("love").toLongLong() || udata->isFavorited(dId) )
     {
-        const qint64 dId = p->dialogs.at(i);
-        if( dialogs.contains(dId) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->dialogs.removeAt(i);
-        i--;
-        endRemoveRows();
+        dialogsChanged(false);
+        return;
     }
 
+    // The specials are listed first and the other rows keep the order of
+    // the dialogs list, so the old row is the old index shifted past them.
+    // That misses when a special came before this dialog in the list.
+    int row = from + p->specials;
+    if( row < 0 || row >= p->dialogs.count() || p->dialogs.at(row) != dId )
+        row = p->dialogs.indexOf(dId);
 
-    QList<qint64> temp_msgs = dialogs;
-    for( int i=0 ; i<temp_msgs.count() ; i++ )
-    {
-        const qint64 dId = temp_msgs.at(i);
-        if( p->dialogs.contains(dId) )
-            continue;
+    const int idx = to;
 
-        temp_msgs.removeAt(i);
-        i--;
+    int lo = p->specials;
+    int hi = p->dialogs.count() - (row==-1? 0 : 1);
+    while( lo < hi )
+    {
+        const int mid = (lo+hi)/2;
+        const qint64 mId = p->dialogs.at( row!=-1 && mid>=row? mid+1 : mid );
+        if( p->telegram->dialogIndexOf(mId) < idx )
+            lo = mid+1;
+        else
+            hi = mid;
     }
-    while( p->dialogs != temp_msgs )
-        for( int i=0 ; i<p->dialogs.count() ; i++ )
-        {
-            const qint64 dId = p->dialogs.at(i);
-            int nw = temp_msgs.indexOf(dId);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->dialogs.move( i, nw );
-            endMoveRows();
-        }
 
-
-    for( int i=0 ; i<dialogs.count() ; i++ )
+    if( row == -1 )
     {
-        const qint64 dId = dialogs.at(i);
-        if( p->dialogs.contains(dId) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->dialogs.insert( i, dId );
+        beginInsertRows(QModelIndex(), lo, lo);
+        p->dialogs.insert(lo, dId);
         endInsertRows();
+        emit countChanged();
     }
+    else
+    if( row != lo )
+    {
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), lo>row? lo+1 : lo);
+        p->dialogs.move(row, lo);
+        endMoveRows();
+    }
+}
+
+void TelegramDialogsModel::dialogsChanged_priv()
+{
+    const QList<qint64> & dialogs = fixDialogs(p->telegram->dialogs());
+
+    AsemanListDiff::apply(this, p->dialogs, dialogs);
+    refreshSpecials();
 
     emit countChanged();
 }
@@ -240,6 +245,24 @@ void TelegramDialogsModel::userDataChanged()
         p->dialogs.insert( i, dId );
         endInsertRows();
     }
+
+    refreshSpecials();
+}
+
+void TelegramDialogsModel::refreshSpecials()
+{
+    UserData *udata = p->telegram->userData();
+    const qint64 love_id = udata->value("love").toLongLong();
+
+    p->specials = 0;
+    while( p->specials<p->dialogs.count() )
+    {
+        const qint64 sId = p->dialogs.at(p->specials);
+        if( sId != love_id && !udata->isFavorited(sId) )
+            break;
+
+        p->specials++;
+    }
 }
 
 QList<qint64> TelegramDialogsModel::fixDialogs(QList<qint64> dialogs)
@@ -27,6 +27,7 @@ class TelegramDialogsModelPrivate;
 class TelegramDialogsModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
 
     Q_PROPERTY(TelegramQml* telegram READ telegram WRITE setTelegram NOTIFY telegramChanged)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
@@ -67,7 +68,9 @@ signals:
 private slots:
     void dialogsChanged(bool cachedData);
     void dialogsChanged_priv();
+    void dialogIndexChanged(qint64 dId, int from, int to);
     void userDataChanged();
+    void refreshSpecials();
 
     QList<qint64> fixDialogs(QList<qint64> dialogs );
 
@@ -23,9 +23,11 @@
 #include "database.h"
 #include "cutegramdialog.h"
 #include "objects/types.h"
+#include "asemantools/asemanlistdiff.h"
 
 #include <telegram.h>
 #include <QPointer>
+#include <QSet>
 
 class TelegramMessagesModelPrivate
 {
@@ -38,6 +40,9 @@ public:
     QList<qint64> messages;
     QPointer<DialogObject> dialog;
 
+    QPointer<TelegramQml> retainedTelegram;
+    qint64 retainedDialog;
+
     int load_count;
     int load_limit;
     int refresh_timer;
@@ -57,6 +62,7 @@ TelegramMessagesModel::TelegramMessagesModel(QObject *parent) :
     p->refresh_timer = 0;
     p->maxId = 0;
     p->unreadCount = 0;
+    p->retainedDialog = 0;
 }
 
 TelegramQml *TelegramMessagesModel::telegram() const
@@ -72,6 +78,7 @@ void TelegramMessagesModel::setTelegram(TelegramQml *tgo)
 
     p->telegram = tg;
     p->initializing = tg;
+    updateRetainedDialog();
     emit telegramChanged();
     emit initializingChanged();
     if( !p->telegram )
@@ -93,6 +100,7 @@ void TelegramMessagesModel::setDialog(DialogObject *dlg)
         return;
 
     p->dialog = dlg;
+    updateRetainedDialog();
     emit dialogChanged();
 
     beginResetModel();
@@ -189,6 +197,7 @@ void TelegramMessagesModel::loadMore(bool force)
         return;
 
     p->load_limit = p->load_count + LOAD_STEP_COUNT;
+    const qint64 lastId = p->messages.isEmpty()? 0 : p->messages.last();
 
     Telegram *tgObject = p->telegram->telegram();
     if(p->dialog->encrypted())
@@ -196,7 +205,7 @@ void TelegramMessagesModel::loadMore(bool force)
         Peer peer(Peer::typePeerChat);
         peer.setChatId(p->dialog->peer()->userId());
 
-        p->telegram->database()->readMessages(peer, p->load_count, LOAD_STEP_COUNT);
+        p->telegram->database()->readMessages(peer, lastId, LOAD_STEP_COUNT);
         return;
     }
 
@@ -208,7 +217,7 @@ void TelegramMessagesModel::loadMore(bool force)
         p->refreshing = true;
     }
 
-    p->telegram->database()->readMessages(TelegramMessagesModel::peer(), p->load_count, LOAD_STEP_COUNT);
+    p->telegram->database()->readMessages(TelegramMessagesModel::peer(), lastId, LOAD_STEP_COUNT);
 
     emit refreshingChanged();
 }
@@ -315,6 +324,21 @@ qint64 TelegramMessagesModel::peerId() const
         return p->dialog->peer()->userId();
 }
 
+void TelegramMessagesModel::updateRetainedDialog()
+{
+    if( p->retainedTelegram && p->retainedDialog )
+        p->retainedTelegram->releaseDialog(p->retainedDialog);
+
+    p->retainedTelegram = p->telegram;
+    p->retainedDialog = 0;
+    if( !p->telegram || !p->dialog )
+        return;
+
+    p->retainedDialog = peerId();
+    if( p->retainedDialog )
+        p->telegram->retainDialog(p->retainedDialog);
+}
+
 Peer TelegramMessagesModel::peer() const
 {
     Peer peer( static_cast<Peer::PeerType>(p->dialog->peer()->classType()) );
@@ -343,61 +367,35 @@ void TelegramMessagesModel::messagesChanged_priv()
         return;
 
     qint32 did = p->dialog->peer()->classType()==Peer::typePeerChat? p->dialog->peer()->chatId() : p->dialog->peer()->userId();
-    const QList<qint64> & messages = p->telegram->messages(did, p->maxId).mid(0,p->load_limit);
-
-    for( int i=0 ; i<p->messages.count() ; i++ )
-    {
-        const qint64 msgId = p->messages.at(i);
-        if( messages.contains(msgId) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->messages.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
-
-
-    QList<qint64> temp_msgs = messages;
-    for( int i=0 ; i<temp_msgs.count() ; i++ )
-    {
-        const qint64 msgId = temp_msgs.at(i);
-        if( p->messages.contains(msgId) )
-            continue;
-
-        temp_msgs.removeAt(i);
-        i--;
-    }
-    while( p->messages != temp_msgs )
-        for( int i=0 ; i<p->messages.count() ; i++ )
-        {
-            const qint64 msgId = p->messages.at(i);
-            int nw = temp_msgs.indexOf(msgId);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->messages.move( i, nw );
-            endMoveRows();
-        }
+    const QList<qint64> & messages = p->telegram->messages(did, p->maxId, p->load_limit);
 
+    const QSet<qint64> & currents = p->messages.toSet();
 
+    QList<qint64> addeds;
     for( int i=0 ; i<messages.count() ; i++ )
     {
         const qint64 msgId = messages.at(i);
-        if( p->messages.contains(msgId) )
+        if( currents.contains(msgId) )
             continue;
 
         if(!p->refreshing && i<p->unreadCount)
             p->unreadCount++;
 
-        beginInsertRows(QModelIndex(), i, i );
-        p->messages.insert( i, msgId );
-        endInsertRows();
+        addeds << msgId;
+    }
+
+    AsemanListDiff::apply(this, p->messages, messages);
 
+    QStringList addedTexts;
+    foreach(qint64 msgId, addeds)
+    {
+        addedTexts << p->telegram->messageText(msgId);
         emit messageAdded(msgId);
     }
 
+    if(!addedTexts.isEmpty())
+        emit messagesLoaded(addedTexts);
+
     p->load_count = p->messages.count();
     emit countChanged();
 }
@@ -416,5 +414,8 @@ void TelegramMessagesModel::timerEvent(QTimerEvent *e)
 
 TelegramMessagesModel::~TelegramMessagesModel()
 {
+    if( p->retainedTelegram && p->retainedDialog )
+        p->retainedTelegram->releaseDialog(p->retainedDialog);
+
     delete p;
 }
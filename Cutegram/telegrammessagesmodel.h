@@ -20,6 +20,7 @@
 #define TELEGRAMMESSAGESMODEL_H
 
 #include <QAbstractListModel>
+#include <QStringList>
 
 class TelegramQml;
 class Peer;
@@ -29,6 +30,7 @@ class TelegramMessagesModelPrivate;
 class TelegramMessagesModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
 
     Q_PROPERTY(TelegramQml* telegram READ telegram WRITE setTelegram NOTIFY telegramChanged)
     Q_PROPERTY(DialogObject* dialog READ dialog WRITE setDialog NOTIFY dialogChanged)
@@ -88,6 +90,7 @@ signals:
     void refreshingChanged();
     void maxIdChanged();
     void messageAdded(qint64 msgId);
+    void messagesLoaded(const QStringList &texts);
     void hasNewMessageChanged();
 
 private slots:
@@ -98,6 +101,9 @@ private slots:
 protected:
     void timerEvent(QTimerEvent *e);
 
+private:
+    void updateRetainedDialog();
+
 private:
     TelegramMessagesModelPrivate *p;
 };
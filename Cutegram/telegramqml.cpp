@@ -21,6 +21,12 @@
 #include "asemantools/asemandevices.h"
 #include "telegramqml.h"
 #include "userdata.h"
+#include "downloadsink.h"
+#include "downloadscheduler.h"
+#include "uploadpipeline.h"
+#include "typeobjectcounter.h"
+#include "messagestore.h"
+#include "ephemeraltimer.h"
 #include "database.h"
 #include "cutegramdialog.h"
 #include "objects/types.h"
@@ -29,19 +35,24 @@
 #include <secret/decrypter.h>
 #include <telegram.h>
 #include <types/decryptedmessage.h>
+#include <types/updatesstate.h>
 #include <limits>
+#include <algorithm>
+#include <iterator>
 
 #include <QPointer>
 #include <QTimerEvent>
 #include <QDebug>
 #include <QHash>
 #include <QDateTime>
+#include <QtMath>
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QImage>
 #include <QImageReader>
 #include <QImageWriter>
 #include <QBuffer>
+#include <QFileSystemWatcher>
 
 #ifdef Q_OS_WIN
 #define FILES_PRE_STR QString("file:///")
@@ -49,10 +60,121 @@
 #define FILES_PRE_STR QString("file://")
 #endif
 
+#define MESSAGE_POOL_SIZE 64
+#define FILE_LOCATION_WATCH_LIMIT 64
+#define UPDATES_GAP_TIMEOUT 1000
+#define TYPING_TIMEOUT 6000
+#define TYPING_FLUSH_INTERVAL 250
+#define UPDATES_DIFFERENCE_SLICES 10
+#define UPDATES_PENDING_LIMIT 1000
+
 
 TelegramQmlPrivate *telegramp_qml_tmp = 0;
 bool checkDialogLessThan( qint64 a, qint64 b );
 bool checkMessageLessThan( qint64 a, qint64 b );
+bool checkDialogAccessLessThan( qint64 a, qint64 b );
+
+class UserIndexMatch
+{
+public:
+    UserIndexMatch(): score(0), id(0){}
+    bool operator<(const UserIndexMatch &b) const {
+        if(score != b.score)
+            return score < b.score;
+        if(name != b.name)
+            return name < b.name;
+        return id < b.id;
+    }
+
+    int score;
+    QString name;
+    qint64 id;
+};
+
+/*!
+ * One ordered unit of the update stream: an updates container, a short
+ * message, a secret chat message or just the state change of a request's
+ * answer. It says itself whether it fits on top of the current state.
+ */
+class TelegramQmlPendingUpdates
+{
+public:
+    enum Order {
+        Apply,
+        Hold,
+        Skip
+    };
+
+    TelegramQmlPendingUpdates(): seqStart(0), seq(0), pts(0), ptsCount(0), qts(0), qtsCount(0), date(0){}
+
+    void setUpdates(const QList<Update> &list) {
+        updates = list;
+        foreach(const Update &u, list)
+        {
+            int count = 0;
+            switch(static_cast<int>(u.classType()))
+            {
+            case Update::typeUpdateNewMessage:
+                count = 1;
+                break;
+            case Update::typeUpdateReadMessages:
+            case Update::typeUpdateDeleteMessages:
+            case Update::typeUpdateRestoreMessages:
+                count = u.messages().count();
+                break;
+            }
+
+            if(!count || !u.pts())
+                continue;
+
+            pts = qMax(pts, u.pts());
+            ptsCount += count;
+        }
+    }
+
+    bool ordered() const {
+        return seq || pts || qts;
+    }
+
+    Order order(qint32 stateSeq, qint32 statePts, qint32 stateQts) const {
+        if(seq && stateSeq)
+        {
+            if(seq <= stateSeq)
+                return Skip;
+            if((seqStart? seqStart : seq) != stateSeq+1)
+                return Hold;
+        }
+        // A negative count is an answer that can not tell how far it moves pts
+        if(pts && statePts && ptsCount >= 0)
+        {
+            if(pts <= statePts && !seq)
+                return Skip;
+            if(pts - ptsCount > statePts)
+                return Hold;
+        }
+        if(qts && stateQts)
+        {
+            if(qts <= stateQts)
+                return Skip;
+            if(qts - qtsCount > stateQts)
+                return Hold;
+        }
+        return Apply;
+    }
+
+    qint32 seqStart;
+    qint32 seq;
+    qint32 pts;
+    qint32 ptsCount;
+    qint32 qts;
+    qint32 qtsCount;
+    qint32 date;
+    QList<Update> updates;
+    QList<Message> messages;
+    QList<SecretChatMessage> secretMessages;
+    QList<User> users;
+    QList<Chat> chats;
+};
 
 class TelegramQmlPrivate
 {
@@ -95,25 +217,72 @@ public:
     QHash<qint64,EncryptedChatObject*> encchats;
 
     QMultiMap<QString, qint64> userNameIndexes;
+    QHash<QString, QSet<qint64> > userNameTrigrams;
+    QHash<qint64, QStringList> userNameTokens;
 
     QHash<qint64,DialogObject*> fakeDialogs;
 
     QList<qint64> dialogs_list;
+    QHash<qint64, QPair<qint64,qint64> > dialogs_keys;
     QHash<qint64, QList<qint64> > messages_list;
+
+    MessageStore store;
+    QList<MessageObject*> messages_pool;
+    QHash<MessageObject*, int> messages_refs;
+    QHash<qint64, int> messages_touch;
+    int messages_generation;
+
+    QHash<qint64, qint64> dialogs_access;
+    QHash<qint64, int> retained_dialogs;
+    QSet<qint64> evicted_messages;
+    QSet<qint64> rehydrate_messages;
+    qint64 access_tick;
+    qint64 messages_budget;
+    int residency_timer;
+
+    QList<qint64> dialogs_refetches;
+
+    qint32 state_pts;
+    qint32 state_qts;
+    qint32 state_date;
+    qint32 state_seq;
+    bool state_loaded;
+    bool state_loading;
+    int state_flush_timer;
+    QList<TelegramQmlPendingUpdates> pending_updates;
+    int pending_updates_timer;
+    qint64 state_req_id;
+    qint64 difference_req_id;
+    int difference_slices;
+
     QMap<qint64, WallPaperObject*> wallpapers_map;
 
     QHash<qint64,MessageObject*> pend_messages;
-    QHash<qint64,FileLocationObject*> downloads;
+    QHash<qint64,QString> downloads;
+    QHash<qint64,QString> search_requests;
+    DownloadSink *download_sink;
+    DownloadScheduler *download_scheduler;
+    UploadPipeline *upload_pipeline;
     QHash<qint64,MessageObject*> uploads;
+    qint64 uploads_total;
+    qint64 uploads_uploaded;
+    qreal uploads_speed;
+    qint64 uploads_progress_time;
     QHash<qint64,FileLocationObject*> accessHashes;
     QHash<qint64,qint64> delete_history_requests;
 
     QSet<QObject*> garbages;
 
-    QHash<int, QPair<qint64,qint64> > typing_timers;
+    EphemeralTimer *ephemeral;
+    QHash<qint64, QSet<qint64> > typing_users;
+    QSet<qint64> typing_changed;
+    int typing_flush_timer;
     int upd_dialogs_timer;
     int garbage_checker_timer;
 
+    QHash<QString,TagUsage> pending_tags;
+    int tags_flush_timer;
+
     DialogObject *nullDialog;
     MessageObject *nullMessage;
     ChatObject *nullChat;
@@ -129,6 +298,12 @@ public:
 
     QMimeDatabase mime_db;
 
+    QHash<QString, QHash<QString,QString> > file_locations;
+    QStringList file_location_dirs;
+    QFileSystemWatcher *file_watcher;
+    qint64 file_location_hits;
+    qint64 file_location_misses;
+
     qint32 msg_send_id_counter;
     qint64 msg_send_random_id;
 
@@ -141,15 +316,57 @@ TelegramQml::TelegramQml(QObject *parent) :
     p = new TelegramQmlPrivate;
     p->upd_dialogs_timer = 0;
     p->garbage_checker_timer = 0;
+    p->tags_flush_timer = 0;
+    p->typing_flush_timer = 0;
+    p->residency_timer = 0;
+    p->state_pts = 0;
+    p->state_qts = 0;
+    p->state_date = 0;
+    p->state_seq = 0;
+    p->state_loaded = false;
+    p->state_loading = false;
+    p->state_flush_timer = 0;
+    p->pending_updates_timer = 0;
+    p->state_req_id = 0;
+    p->difference_req_id = 0;
+    p->difference_slices = 0;
+    p->access_tick = 0;
+    p->messages_generation = 0;
+    p->messages_budget = qMax(1, AsemanApplication::settings()->value("Messages/memoryBudget", 64).toInt())*1024*1024;
+    p->uploads_total = 0;
+    p->uploads_uploaded = 0;
+    p->uploads_speed = 0;
+    p->uploads_progress_time = 0;
     p->unreadCount = 0;
     p->online = false;
     p->invisible = false;
     p->msg_send_id_counter = INT_MAX - 100000;
     p->msg_send_random_id = 0;
     p->cutegram_dlg = 0;
+    p->file_location_hits = 0;
+    p->file_location_misses = 0;
+
+    p->file_watcher = new QFileSystemWatcher(this);
+    connect(p->file_watcher, SIGNAL(directoryChanged(QString)), SLOT(fileLocationsChanged(QString)));
 
     p->userdata = new UserData(this);
     p->database = new Database(this);
+    connect(p->database, SIGNAL(valueFounded(QString,QString)), SLOT(dbValueFounded(QString,QString)));
+    connect(p->database, SIGNAL(statementStatsFounded(qint64,qint64)), SIGNAL(databaseStatsFounded(qint64,qint64)));
+
+    p->download_sink = new DownloadSink(this);
+    connect(p->download_sink, SIGNAL(finished(qint64,QString)), SLOT(downloadFinished(qint64,QString)));
+
+    p->download_scheduler = new DownloadScheduler(this);
+    connect(p->download_scheduler, SIGNAL(started(qint64,FileLocationObject*)), SLOT(downloadStarted(qint64,FileLocationObject*)));
+
+    p->ephemeral = new EphemeralTimer(this);
+    p->ephemeral->setResolution(TYPING_FLUSH_INTERVAL);
+    connect(p->ephemeral, SIGNAL(expired(int,qint64,qint64)), SLOT(ephemeralExpired(int,qint64,qint64)));
+
+    p->upload_pipeline = new UploadPipeline(this);
+    connect(p->upload_pipeline, SIGNAL(started(qint64,qint64)), SLOT(uploadStarted(qint64,qint64)));
+    connect(p->upload_pipeline, SIGNAL(failed(qint64))        , SLOT(uploadFailed(qint64))        );
 
     p->telegram = 0;
     p->tsettings = 0;
@@ -187,6 +404,15 @@ void TelegramQml::setPhoneNumber(const QString &phone)
     if( p->phoneNumber == phone )
         return;
 
+    flushTags();
+    flushUpdatesState();
+    p->state_pts = 0;
+    p->state_qts = 0;
+    p->state_date = 0;
+    p->state_seq = 0;
+    p->state_loaded = false;
+    p->state_loading = false;
+    p->pending_updates.clear();
     p->phoneNumber = phone;
     p->userdata->setPhoneNumber(phone);
     p->database->setPhoneNumber(phone);
@@ -200,7 +426,8 @@ void TelegramQml::setPhoneNumber(const QString &phone)
     connect(p->database, SIGNAL(chatFounded(Chat))         , SLOT(dbChatFounded(Chat))         );
     connect(p->database, SIGNAL(userFounded(User))         , SLOT(dbUserFounded(User))         );
     connect(p->database, SIGNAL(dialogFounded(Dialog,bool)), SLOT(dbDialogFounded(Dialog,bool)));
-    connect(p->database, SIGNAL(messageFounded(Message))   , SLOT(dbMessageFounded(Message))   );
+    connect(p->database, SIGNAL(messagesFounded(QList<Message>)), SLOT(dbMessagesFounded(QList<Message>)));
+    connect(p->database, SIGNAL(messagesSearched(QString,QList<qint64>)), SIGNAL(localSearchDone(QString,QList<qint64>)));
     connect(p->database, SIGNAL(mediaKeyFounded(qint64,QByteArray,QByteArray)),
             SLOT(dbMediaKeysFounded(qint64,QByteArray,QByteArray)) );
 }
@@ -380,6 +607,29 @@ bool TelegramQml::uploadingProfilePhoto() const
     return p->profile_upload_id != 0;
 }
 
+qint64 TelegramQml::uploadsTotalSize() const
+{
+    return p->uploads_total;
+}
+
+qint64 TelegramQml::uploadsUploaded() const
+{
+    return p->uploads_uploaded;
+}
+
+qreal TelegramQml::uploadsSpeed() const
+{
+    return p->uploads_speed;
+}
+
+int TelegramQml::uploadsEta() const
+{
+    if(p->uploads_speed <= 0)
+        return -1;
+
+    return qCeil((p->uploads_total-p->uploads_uploaded)/p->uploads_speed);
+}
+
 QString TelegramQml::authSignUpError() const
 {
     return p->authSignUpError;
@@ -406,11 +656,109 @@ DialogObject *TelegramQml::dialog(qint64 id) const
 MessageObject *TelegramQml::message(qint64 id) const
 {
     MessageObject *res = p->messages.value(id);
-    if( !res )
-        res = p->nullMessage;
+    if( !res && p->store.contains(id) )
+        res = const_cast<TelegramQml*>(this)->materializeMessage(id);
+    if( res )
+    {
+        p->messages_touch[id] = p->messages_generation;
+        return res;
+    }
+
+    if( p->evicted_messages.contains(id) && !p->rehydrate_messages.contains(id) )
+    {
+        p->rehydrate_messages.insert(id);
+        if( p->rehydrate_messages.count() == 1 )
+            QMetaObject::invokeMethod(const_cast<TelegramQml*>(this), "rehydrateMessages", Qt::QueuedConnection);
+    }
+
+    return p->nullMessage;
+}
+
+QString TelegramQml::messageText(qint64 id) const
+{
+    return p->store.text(id);
+}
+
+void TelegramQml::retainMessage(MessageObject *msg)
+{
+    if( !msg || msg == p->nullMessage )
+        return;
+    if( !p->messages_refs.contains(msg) )
+        connect(msg, SIGNAL(destroyed(QObject*)), SLOT(messageDestroyed(QObject*)));
+
+    p->messages_refs[msg]++;
+}
+
+void TelegramQml::releaseMessage(MessageObject *msg)
+{
+    if( !p->messages_refs.contains(msg) )
+        return;
+    if( --p->messages_refs[msg] > 0 )
+        return;
+
+    p->messages_refs.remove(msg);
+    disconnect(msg, SIGNAL(destroyed(QObject*)), this, SLOT(messageDestroyed(QObject*)));
+    startResidencyCheck();
+}
+
+int TelegramQml::residentMessages() const
+{
+    return p->store.count();
+}
+
+int TelegramQml::messageObjects() const
+{
+    return p->messages.count();
+}
+
+int TelegramQml::evictedMessages() const
+{
+    return p->evicted_messages.count();
+}
+
+int TelegramQml::dialogsRefetchesPerHour() const
+{
+    const qint64 since = QDateTime::currentMSecsSinceEpoch() - 60*60*1000;
+    int res = 0;
+    foreach(qint64 time, p->dialogs_refetches)
+        if(time >= since)
+            res++;
+
+    return res;
+}
+
+QVariantMap TelegramQml::typeObjectStats() const
+{
+    QVariantMap res = TypeObjectCounter::report();
+    res["messages"] = p->store.count();
+    res["messageObjects"] = p->messages.count();
+    res["messagesMemory"] = p->store.memoryUsage();
     return res;
 }
 
+void TelegramQml::readDatabaseStats()
+{
+    // Answered by databaseStatsFounded() once the database thread gets to it
+    p->database->readStatementStats();
+}
+
+void TelegramQml::explainDatabaseQueries()
+{
+    p->database->explainQueryPlans();
+}
+
+void TelegramQml::retainDialog(qint64 dId)
+{
+    p->retained_dialogs[dId]++;
+    p->dialogs_access[dId] = ++p->access_tick;
+}
+
+void TelegramQml::releaseDialog(qint64 dId)
+{
+    if( --p->retained_dialogs[dId] <= 0 )
+        p->retained_dialogs.remove(dId);
+}
+
 ChatObject *TelegramQml::chat(qint64 id) const
 {
     ChatObject *res = p->chats.value(id);
@@ -429,15 +777,7 @@ UserObject *TelegramQml::user(qint64 id) const
 
 qint64 TelegramQml::messageDialogId(qint64 id) const
 {
-    MessageObject *msg = p->messages.value(id);
-    if(!msg)
-        return 0;
-
-    qint64 dId = msg->toId()->chatId();
-    if( dId == 0 )
-        dId = msg->out()? msg->toId()->userId() : msg->fromId();
-
-    return dId;
+    return p->store.dialogId(id);
 }
 
 DialogObject *TelegramQml::messageDialog(qint64 id) const
@@ -631,12 +971,9 @@ QString TelegramQml::fileLocation(FileLocationObject *l)
     const QString & fname = l->accessHash()!=0? QString::number(l->id()) :
                                                 QString("%1_%2").arg(l->volumeId()).arg(l->localId());
 
-    QDir().mkpath(dpath);
-
-    const QStringList & av_files = QDir(dpath).entryList(QDir::Files);
-    foreach( const QString & f, av_files )
-        if( QFileInfo(f).baseName() == fname )
-            return dpath + "/" + f;
+    const QString & cached = cachedFileName(dpath, fname);
+    if( !cached.isEmpty() )
+        return dpath + "/" + cached;
 
     QString result = dpath + "/" + fname;
     const QString & old_path = fileLocation_old(l);
@@ -646,11 +983,105 @@ QString TelegramQml::fileLocation(FileLocationObject *l)
         result += "." + file.suffix();
 
         QFile::rename(old_path, result);
+        fileLocationWritten(result);
     }
 
     return result;
 }
 
+qint64 TelegramQml::fileLocationHits() const
+{
+    return p->file_location_hits;
+}
+
+qint64 TelegramQml::fileLocationMisses() const
+{
+    return p->file_location_misses;
+}
+
+QString TelegramQml::cachedFileName(const QString &dpath, const QString &fname)
+{
+    QHash<QString, QHash<QString,QString> >::iterator i = p->file_locations.find(dpath);
+    if(i != p->file_locations.end())
+    {
+        p->file_location_hits++;
+        if(p->file_location_dirs.last() != dpath)
+        {
+            p->file_location_dirs.removeOne(dpath);
+            p->file_location_dirs.append(dpath);
+        }
+        return i.value().value(fname);
+    }
+
+    p->file_location_misses++;
+    QDir().mkpath(dpath);
+
+    QHash<QString,QString> files;
+    const QStringList & av_files = QDir(dpath).entryList(QDir::Files);
+    foreach( const QString & f, av_files )
+    {
+        const QString & baseName = QFileInfo(f).baseName();
+        if( !files.contains(baseName) )
+            files[baseName] = f;
+    }
+
+    // Only the recently used directories stay cached and watched, a
+    // dropped one is listed again on its next use.
+    if(p->file_location_dirs.count() >= FILE_LOCATION_WATCH_LIMIT)
+    {
+        const QString &oldest = p->file_location_dirs.takeFirst();
+        p->file_watcher->removePath(oldest);
+        p->file_locations.remove(oldest);
+    }
+
+    p->file_locations[dpath] = files;
+    p->file_location_dirs.append(dpath);
+    p->file_watcher->addPath(dpath);
+
+    return files.value(fname);
+}
+
+void TelegramQml::fileLocationWritten(const QString &path)
+{
+    QFileInfo file(path);
+    QHash<QString, QHash<QString,QString> >::iterator i = p->file_locations.find(file.path());
+    if(i == p->file_locations.end())
+        return;
+
+    i.value()[file.baseName()] = file.fileName();
+}
+
+void TelegramQml::fileLocationsChanged(const QString &dpath)
+{
+    QHash<QString, QHash<QString,QString> >::iterator i = p->file_locations.find(dpath);
+    if(i == p->file_locations.end())
+        return;
+
+    // Reconcile on every change, our own writes included: listing one
+    // directory is cheap and a change from outside is never missed. The
+    // .partial directory of the running downloads is not a file, so it
+    // is skipped here.
+    QHash<QString,QString> &files = i.value();
+    QSet<QString> baseNames;
+    const QStringList & av_files = QDir(dpath).entryList(QDir::Files);
+    foreach( const QString & f, av_files )
+    {
+        const QString & baseName = QFileInfo(f).baseName();
+        baseNames.insert(baseName);
+        if( !files.contains(baseName) )
+            files[baseName] = f;
+    }
+
+    QHash<QString,QString>::iterator j = files.begin();
+    while( j != files.end() )
+    {
+        if( baseNames.contains(j.key()) )
+            ++j;
+        else
+            j = files.erase(j);
+    }
+}
+
 QString TelegramQml::videoThumbLocation(const QString &pt)
 {
     QString path = pt;
@@ -673,12 +1104,9 @@ QString TelegramQml::fileLocation_old(FileLocationObject *l)
     const QString & fname = l->accessHash()!=0? QString::number(l->id()) :
                                                 QString("%1_%2").arg(l->volumeId()).arg(l->localId());
 
-    QDir().mkpath(dpath);
-
-    const QStringList & av_files = QDir(dpath).entryList(QDir::Files);
-    foreach( const QString & f, av_files )
-        if( QFileInfo(f).baseName() == fname )
-            return dpath + "/" + f;
+    const QString & cached = cachedFileName(dpath, fname);
+    if( !cached.isEmpty() )
+        return dpath + "/" + cached;
 
     return dpath + "/" + fname;
 }
@@ -688,16 +1116,25 @@ QList<qint64> TelegramQml::dialogs() const
     return p->dialogs_list;
 }
 
-QList<qint64> TelegramQml::messages( qint64 did, qint64 maxId ) const
+QList<qint64> TelegramQml::messages( qint64 did, qint64 maxId, int limit ) const
 {
-    QList<qint64> res = p->messages_list[did];
-    for(int i=0; maxId && i<res.count(); i++)
-    {
-        if(res.at(i) <= maxId)
-            continue;
+    p->dialogs_access[did] = ++p->access_tick;
 
-        res.removeAt(i);
-        i--;
+    const QList<qint64> & list = p->messages_list.value(did);
+    if( !maxId )
+        return limit<0? list : list.mid(0, limit);
+
+    // The list is ordered by date, which doesn't follow the ids strictly,
+    // so a message with a lower id can sit above maxId. Filter on the id
+    // alone from the top, the scan stops once the limit is reached.
+    QList<qint64> res;
+    if( limit >= 0 )
+        res.reserve(limit);
+    for( int i=0; i<list.count() && (limit<0 || res.count()<limit); i++ )
+    {
+        const qint64 msgId = list.at(i);
+        if( msgId <= maxId )
+            res << msgId;
     }
 
     return res;
@@ -737,31 +1174,150 @@ InputPeer TelegramQml::getInputPeer(qint64 peerId)
     return peer;
 }
 
-QList<qint64> TelegramQml::userIndex(const QString &kw)
+QList<qint64> TelegramQml::userIndex(const QString &kw, const QSet<qint64> &scope, int limit)
 {
-    const QString & keyword = kw.toLower();
+    const QStringList & words = stringToIndex(kw);
+
+    QList<UserIndexMatch> matches;
+    if(words.isEmpty())
+    {
+        QHashIterator<qint64, QStringList> i(p->userNameTokens);
+        while(i.hasNext())
+        {
+            i.next();
+            if(!scope.isEmpty() && !scope.contains(i.key()))
+                continue;
+
+            UserIndexMatch match;
+            match.id = i.key();
+            match.name = i.value().join(" ");
+            matches << match;
+        }
+    }
+    else
+    {
+        QSet<qint64> candidates = userIndexCandidates(words.first());
+        for(int i=1; i<words.count() && !candidates.isEmpty(); i++)
+            candidates.intersect( userIndexCandidates(words.at(i)) );
+
+        foreach(qint64 uid, candidates)
+        {
+            if(!scope.isEmpty() && !scope.contains(uid))
+                continue;
+
+            const QStringList & tokens = p->userNameTokens.value(uid);
+
+            UserIndexMatch match;
+            match.id = uid;
+            match.name = tokens.join(" ");
+            foreach(const QString &word, words)
+            {
+                // 0 = whole token, 1 = token prefix, 2 = anywhere inside a token
+                int best = 3;
+                foreach(const QString &token, tokens)
+                {
+                    if(token == word)
+                        best = 0;
+                    else
+                    if(token.startsWith(word))
+                        best = qMin(best, 1);
+                    else
+                    if(token.contains(word))
+                        best = qMin(best, 2);
+                }
+
+                match.score += best;
+                if(best == 3)
+                    break;
+            }
+
+            if(match.score < 3*words.count())
+                matches << match;
+        }
+    }
 
     QList<qint64> result;
-    QSet<qint64> addeds;
+    if(limit >= 0 && limit < matches.count())
+    {
+        std::partial_sort(matches.begin(), matches.begin()+limit, matches.end());
+        matches = matches.mid(0, limit);
+    }
+    else
+        std::sort(matches.begin(), matches.end());
 
-    QMapIterator<QString, qint64> i(p->userNameIndexes);
-    while(i.hasNext())
+    foreach(const UserIndexMatch &match, matches)
+        result << match.id;
+
+    return result;
+}
+
+QSet<qint64> TelegramQml::userIndexCandidates(const QString &word) const
+{
+    QSet<qint64> result;
+    if(word.length() < 3)
     {
-        i.next();
-        qint64 uid = i.value();
-        if(addeds.contains(uid))
-            continue;
+        QMultiMap<QString, qint64>::const_iterator i = p->userNameIndexes.lowerBound(word);
+        for( ; i != p->userNameIndexes.constEnd() && i.key().startsWith(word); i++)
+            result.insert(i.value());
+
+        return result;
+    }
+
+    for(int i=0; i<=word.length()-3; i++)
+    {
+        const QSet<qint64> & users = p->userNameTrigrams.value(word.mid(i,3));
+        if(i == 0)
+            result = users;
         else
-        if(!i.key().contains(keyword.toLower()))
-            continue;
+            result.intersect(users);
 
-        result << uid;
-        addeds.insert(uid);
+        if(result.isEmpty())
+            break;
     }
 
     return result;
 }
 
+void TelegramQml::insertUserIndex(const User &u)
+{
+    removeUserIndex(u.id());
+    if(u.username().isEmpty())
+        return;
+
+    QStringList tokens;
+    tokens << stringToIndex(u.firstName());
+    tokens << stringToIndex(u.lastName());
+    tokens << stringToIndex(u.username());
+    tokens.removeDuplicates();
+    if(tokens.isEmpty())
+        return;
+
+    p->userNameTokens[u.id()] = tokens;
+    foreach(const QString &token, tokens)
+    {
+        p->userNameIndexes.insertMulti(token, u.id());
+        for(int i=0; i<=token.length()-3; i++)
+            p->userNameTrigrams[token.mid(i,3)].insert(u.id());
+    }
+}
+
+void TelegramQml::removeUserIndex(qint64 uid)
+{
+    const QStringList & tokens = p->userNameTokens.take(uid);
+    foreach(const QString &token, tokens)
+    {
+        p->userNameIndexes.remove(token, uid);
+        for(int i=0; i<=token.length()-3; i++)
+        {
+            const QString & trigram = token.mid(i,3);
+            QSet<qint64> & users = p->userNameTrigrams[trigram];
+            users.remove(uid);
+            if(users.isEmpty())
+                p->userNameTrigrams.remove(trigram);
+        }
+    }
+}
+
 void TelegramQml::authLogout()
 {
     if( !p->telegram )
@@ -844,12 +1400,12 @@ void TelegramQml::sendMessage(qint64 dId, const QString &msg)
 
     insertMessage(message, (dlg && dlg->encrypted()), false, true);
 
-    MessageObject *msgObj = p->messages.value(message.id());
+    MessageObject *msgObj = TelegramQml::message(message.id());
     msgObj->setSent(false);
 
     p->pend_messages[sendId] = msgObj;
 
-    timerUpdateDialogs();
+    updateDialogTopMessage(message, false);
 
     if(dlg && dlg->encrypted())
         messagesSendEncrypted_slt(sendId, message.date(), EncryptedFile());
@@ -891,12 +1447,11 @@ void TelegramQml::deleteMessage(qint64 msgId)
 {
     p->telegram->messagesDeleteMessages( QList<qint32>()<<msgId );
 
-    MessageObject *msgObj = p->messages.value(msgId);
-    if(msgObj)
+    if(p->store.contains(msgId))
     {
         qint64 dId = messageDialogId(msgId);
 
-        p->garbages.insert( p->messages.take(msgId) );
+        dropMessage(msgId);
         p->messages_list[dId].removeAll(msgId);
         p->database->deleteMessage(msgId);
         startGarbageChecker();
@@ -912,7 +1467,7 @@ void TelegramQml::deleteCutegramDialog()
 
     const qint64 dId = cutegramId();
     DialogObject *dlg = p->dialogs.take(dId);
-    p->dialogs_list.removeOne(dId);
+    removeDialogIndex(dId);
 
     p->garbages.insert(dlg);
     startGarbageChecker();
@@ -997,7 +1552,7 @@ void TelegramQml::messagesDeleteChatUser(qint64 chatId, qint64 userId)
     {
         ChatObject *chat = p->chats.take(chatId);
         DialogObject *dlg = p->dialogs.take(chatId);
-        p->dialogs_list.removeOne(chatId);
+        removeDialogIndex(chatId);
 
         p->garbages.insert(chat);
         p->garbages.insert(dlg);
@@ -1059,6 +1614,13 @@ void TelegramQml::messagesReadHistory(qint64 peerId)
 
     const InputPeer & peer = getInputPeer(peerId);
     p->telegram->messagesReadHistory(peer);
+
+    DialogObject *dlg = p->dialogs.value(peerId);
+    if(dlg && dlg->unreadCount())
+    {
+        dlg->setUnreadCount(0);
+        storeDialog(dlg);
+    }
 }
 
 void TelegramQml::messagesCreateEncryptedChat(qint64 userId)
@@ -1094,7 +1656,7 @@ void TelegramQml::messagesDiscardEncryptedChat(qint32 chatId)
 
     EncryptedChatObject *chat = p->encchats.take(chatId);
     DialogObject *dlg = p->dialogs.take(chatId);
-    p->dialogs_list.removeOne(chatId);
+    removeDialogIndex(chatId);
 
     p->garbages.insert(chat);
     p->garbages.insert(dlg);
@@ -1121,94 +1683,134 @@ void TelegramQml::search(const QString &keyword)
     InputPeer peer(InputPeer::typeInputPeerEmpty);
     MessagesFilter filter(MessagesFilter::typeInputMessagesFilterEmpty);
 
-    p->telegram->messagesSearch(peer, keyword, filter, 0, 0, 0, 0, 50);
+    const qint64 id = p->telegram->messagesSearch(peer, keyword, filter, 0, 0, 0, 0, 50);
+    p->search_requests[id] = keyword;
+}
+
+void TelegramQml::searchLocal(const QString &keyword)
+{
+    p->database->searchMessages(keyword, 50);
 }
 
 bool TelegramQml::sendFile(qint64 dId, const QString &fpath, bool forceDocument, bool forceAudio)
 {
-    QString file = fpath;
-    if( file.left(AsemanDevices::localFilesPrePath().length()) == AsemanDevices::localFilesPrePath() )
-        file = file.mid(AsemanDevices::localFilesPrePath().length());
+    return sendFiles(dId, QStringList() << fpath, forceDocument, forceAudio) != 0;
+}
 
-    if( !QFileInfo::exists(file) )
-        return false;
+int TelegramQml::sendFiles(qint64 dId, const QStringList &fpaths, bool forceDocument, bool forceAudio)
+{
     if( !p->telegram )
-        return false;
-
-    DialogObject *dlg = dialog(dId);
-    if( !dlg )
-        return false;
+        return 0;
 
-    Message message = newMessage(dId);
-    InputPeer peer = getInputPeer(dId);
+    // Contacts without a dialog yet only have a fake one, which is never
+    // encrypted.
+    DialogObject *dlg = p->dialogs.value(dId);
+    const bool encrypted = dlg && dlg->encrypted();
 
-    qint64 fileId;
-    p->msg_send_random_id = generateRandomId();
-    const QMimeType & t = p->mime_db.mimeTypeForFile(file);
-    if( !t.name().contains("gif") && t.name().contains("image/") && !forceDocument && !forceAudio )
+    QStringList files;
+    QList<Message> messages;
+    foreach(const QString &fpath, fpaths)
     {
-        if(dlg->encrypted())
-            fileId = p->telegram->messagesSendEncryptedPhoto(dId, p->msg_send_random_id, 0, file);
-        else
-            fileId = p->telegram->messagesSendPhoto(peer, p->msg_send_random_id, file);
+        QString file = fpath;
+        if( file.left(AsemanDevices::localFilesPrePath().length()) == AsemanDevices::localFilesPrePath() )
+            file = file.mid(AsemanDevices::localFilesPrePath().length());
+        if( !QFileInfo::exists(file) )
+            continue;
+
+        files << file;
+        messages << newMessage(dId);
     }
-    else
-    if( t.name().contains("video/") && !forceDocument && !forceAudio )
+
+    if(files.isEmpty())
+        return 0;
+
+    insertMessages(messages, false, true);
+
+    // Probing and thumbnails run on the pipeline's workers, the real
+    // file id replaces the job id once the upload starts. The pipeline
+    // starts jobs in the order they were queued.
+    const InputPeer &peer = getInputPeer(dId);
+    qint64 batchSize = 0;
+    for(int i=0; i<files.count(); i++)
     {
-        QString thumbnail = AsemanApplication::tempPath()+"/cutegram_thumbnail_" + QUuid::createUuid().toString() + ".jpg";
-        int width = 0;
-        int height = 0;
+        const QString &file = files.at(i);
+        MessageObject *msgObj = message(messages.at(i).id());
+        msgObj->setSent(false);
 
-        if( !AsemanTools::createVideoThumbnail(file, thumbnail) )
-            thumbnail.clear();
-        else
-        {
-            QImageReader reader(thumbnail);
-            QSize size = reader.size();
-            width = size.width();
-            height = size.height();
-        }
+        qint64 jobId = p->upload_pipeline->enqueue(dId, peer, encrypted, file, forceDocument, forceAudio);
+        qint64 size = QFileInfo(file).size();
 
-        if(dlg->encrypted())
-        {
-            QByteArray thumbData;
-            QFile thumbFile(thumbnail);
-            if(thumbFile.open(QFile::ReadOnly))
-            {
-                thumbData = thumbFile.readAll();
-                thumbFile.close();
-            }
+        UploadObject *upload = msgObj->upload();
+        upload->setFileId(jobId);
+        upload->setLocation(file);
+        upload->setTotalSize(size);
 
-            fileId = p->telegram->messagesSendEncryptedVideo(dId, p->msg_send_random_id, 0, file, 0, width, height, thumbData);
-        }
-        else
-            fileId = p->telegram->messagesSendVideo(peer, p->msg_send_random_id, file, 0, width, height, thumbnail);
+        p->uploads[jobId] = msgObj;
+        batchSize += size;
     }
-    else
-    if( dlg->encrypted() )
-        return false;
-    else
-    if( (t.name().contains("audio/") || forceAudio) && !forceDocument )
-        fileId = p->telegram->messagesSendAudio(peer, p->msg_send_random_id, file, 0);
-    else
-        fileId = p->telegram->messagesSendDocument(peer, p->msg_send_random_id, file);
 
-    insertMessage(message, false, false, true);
+    addUploadProgress(batchSize, 0);
+    emit uploadsChanged();
+    return files.count();
+}
 
-    MessageObject *msgObj = p->messages.value(message.id());
-    msgObj->setSent(false);
+MessageObject *TelegramQml::takeUpload(qint64 fileId)
+{
+    MessageObject *msgObj = p->uploads.take(fileId);
+    p->upload_pipeline->finished(fileId);
+    if(!msgObj)
+        return 0;
 
     UploadObject *upload = msgObj->upload();
-    upload->setFileId(fileId);
-    upload->setLocation(file);
-    upload->setTotalSize(QFileInfo(file).size());
+    addUploadProgress(-upload->totalSize(), -upload->uploaded());
+    return msgObj;
+}
+
+void TelegramQml::addUploadProgress(qint64 total, qint64 uploaded)
+{
+    p->uploads_total += total;
+    p->uploads_uploaded += uploaded;
+
+    // Speed is smoothed over the recent parts, a new batch starts from zero
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if(p->uploads.isEmpty())
+    {
+        p->uploads_total = 0;
+        p->uploads_uploaded = 0;
+        p->uploads_speed = 0;
+        p->uploads_progress_time = 0;
+    }
+    else
+    if(uploaded > 0)
+    {
+        if(p->uploads_progress_time && now > p->uploads_progress_time)
+        {
+            const qreal speed = uploaded*1000.0/(now-p->uploads_progress_time);
+            p->uploads_speed = p->uploads_speed? p->uploads_speed*0.8 + speed*0.2 : speed;
+        }
+        p->uploads_progress_time = now;
+    }
+
+    emit uploadsProgressChanged();
+}
+
+void TelegramQml::uploadStarted(qint64 jobId, qint64 fileId)
+{
+    MessageObject *msgObj = p->uploads.take(jobId);
+    if(!msgObj)
+        return;
 
+    msgObj->upload()->setFileId(fileId);
     p->uploads[fileId] = msgObj;
     emit uploadsChanged();
-    return true;
 }
 
-void TelegramQml::getFile(FileLocationObject *l, qint64 type, qint32 fileSize)
+void TelegramQml::uploadFailed(qint64 jobId)
+{
+    uploadCancelFile_slt(jobId, true);
+}
+
+void TelegramQml::getFile(FileLocationObject *l, qint64 type, qint32 fileSize, int priority)
 {
     if(!l)
         return;
@@ -1216,8 +1818,13 @@ void TelegramQml::getFile(FileLocationObject *l, qint64 type, qint32 fileSize)
         return;
     if(l->accessHash()==0 && l->volumeId()==0 && l->localId()==0)
         return;
+    // Every call is paired with a releaseFile(), so a running download
+    // counts this caller too.
     if(l->download()->fileId() != 0)
+    {
+        p->download_scheduler->retain(l);
         return;
+    }
 
     const QString & download_file = fileLocation(l);
     if( QFile::exists(download_file) )
@@ -1274,10 +1881,30 @@ void TelegramQml::getFile(FileLocationObject *l, qint64 type, qint32 fileSize)
     else
         qDebug() << __PRETTY_FUNCTION__ << ": Can't detect size of: " << parentObj;
 
-    qint64 fileId = p->telegram->uploadGetFile(input, fileSize, l->dcId(), ekey, eiv);
-    p->downloads[fileId] = l;
+    if(priority == CutegramEnums::DownloadPriorityAuto)
+    {
+        const QMetaObject *pmobj = parentObj? parentObj->metaObject() : 0;
+        if(type != InputFileLocation::typeInputFileLocation)
+            priority = CutegramEnums::DownloadPriorityFile;
+        else
+        if(pmobj == &UserProfilePhotoObject::staticMetaObject || pmobj == &ChatPhotoObject::staticMetaObject)
+            priority = CutegramEnums::DownloadPriorityAvatar;
+        else
+        if(pmobj == &PhotoSizeObject::staticMetaObject)
+            priority = CutegramEnums::DownloadPriorityThumbnail;
+        else
+            priority = CutegramEnums::DownloadPriorityFile;
+    }
+
+    p->download_scheduler->request(l, input, fileSize, ekey, eiv, priority);
+}
+
+void TelegramQml::releaseFile(FileLocationObject *l)
+{
+    if(!l)
+        return;
 
-    l->download()->setFileId(fileId);
+    p->download_scheduler->release(l);
 }
 
 void TelegramQml::getFileJustCheck(FileLocationObject *l)
@@ -1286,7 +1913,7 @@ void TelegramQml::getFileJustCheck(FileLocationObject *l)
         return;
 
     const QString & download_file = fileLocation(l);
-    if( QFile::exists(download_file) && !l->download()->file()->isOpen() )
+    if( QFile::exists(download_file) && !l->download()->fileId() )
         l->download()->setLocation(FILES_PRE_STR+download_file);
 }
 
@@ -1339,9 +1966,15 @@ void TelegramQml::cancelSendGet(qint64 fileId)
 {
     if( !p->telegram )
         return;
+    if( fileId < 0 )
+    {
+        p->upload_pipeline->cancel(fileId);
+        uploadCancelFile_slt(fileId, true);
+        return;
+    }
 
-    if(p->downloads.contains(fileId))
-        p->downloads.value(fileId)->download()->setFileId(0);
+    foreach(FileLocationObject *l, p->download_scheduler->locations(fileId))
+        l->download()->setFileId(0);
 
     p->telegram->uploadCancelFile(fileId);
 }
@@ -1387,7 +2020,7 @@ void TelegramQml::setProfilePhoto(const QString &fileName)
     emit uploadingProfilePhotoChanged();
 }
 
-void TelegramQml::timerUpdateDialogs(bool duration)
+void TelegramQml::timerUpdateDialogs(int duration)
 {
     if( p->upd_dialogs_timer )
         killTimer(p->upd_dialogs_timer);
@@ -1398,19 +2031,34 @@ void TelegramQml::timerUpdateDialogs(bool duration)
 void TelegramQml::cleanUp()
 {
     p->userNameIndexes.clear();
+    p->userNameTrigrams.clear();
+    p->userNameTokens.clear();
     p->fakeDialogs.clear();
     p->dialogs_list.clear();
+    p->dialogs_keys.clear();
     p->messages_list.clear();
+    p->dialogs_access.clear();
+    p->evicted_messages.clear();
+    p->rehydrate_messages.clear();
+    p->typing_users.clear();
+    p->typing_changed.clear();
+    p->ephemeral->clear();
     p->garbages.clear();
     p->delete_history_requests.clear();
     p->downloads.clear();
+    p->search_requests.clear();
+    p->download_sink->closeAll();
+    p->download_scheduler->clear();
     p->accessHashes.clear();
     p->pend_messages.clear();
     p->uploads.clear();
+    p->upload_pipeline->clear();
+    addUploadProgress(0, 0);
 
     foreach(WallPaperObject *obj, p->wallpapers_map) obj->deleteLater();
     foreach(DialogObject *obj, p->dialogs) obj->deleteLater();
     foreach(MessageObject *obj, p->messages) obj->deleteLater();
+    foreach(MessageObject *obj, p->messages_pool) obj->deleteLater();
     foreach(ChatObject *obj, p->chats) obj->deleteLater();
     foreach(UserObject *obj, p->users) obj->deleteLater();
     foreach(ChatFullObject *obj, p->chatfulls) obj->deleteLater();
@@ -1421,6 +2069,10 @@ void TelegramQml::cleanUp()
     p->wallpapers_map.clear();
     p->dialogs.clear();
     p->messages.clear();
+    p->messages_pool.clear();
+    p->messages_refs.clear();
+    p->messages_touch.clear();
+    p->store.clear();
     p->chats.clear();
     p->users.clear();
     p->chatfulls.clear();
@@ -1447,6 +2099,8 @@ void TelegramQml::try_init()
         return;
 
     p->telegram = new Telegram(p->phoneNumber, p->configPath, p->publicKeyFile);
+    p->download_scheduler->setTelegram(p->telegram);
+    p->upload_pipeline->setTelegram(p->telegram);
 
     p->tsettings = Settings::getInstance();
     p->tsettings->loadSettings(p->phoneNumber, p->configPath, p->publicKeyFile);
@@ -1461,6 +2115,7 @@ void TelegramQml::try_init()
     connect( p->telegram, SIGNAL(authSignInError(qint64,qint32,QString)), SLOT(authSignInError_slt(qint64,qint32,QString)) );
     connect( p->telegram, SIGNAL(authSignUpError(qint64,qint32,QString)), SLOT(authSignUpError_slt(qint64,qint32,QString)) );
     connect( p->telegram, SIGNAL(connected())                           , SIGNAL(connectedChanged())                       );
+    connect( p->telegram, SIGNAL(connected())                           , SLOT(connected_slt())                            );
     connect( p->telegram, SIGNAL(disconnected())                        , SIGNAL(connectedChanged())                       );
 
     connect( p->telegram, SIGNAL(accountGetWallPapersAnswer(qint64,QList<WallPaper>)),
@@ -1545,6 +2200,10 @@ void TelegramQml::try_init()
              SLOT(updateShortMessage_slt(qint32,qint32,QString,qint32,qint32,qint32)) );
     connect( p->telegram, SIGNAL(updatesTooLong()),
              SLOT(updatesTooLong_slt()) );
+    connect( p->telegram, SIGNAL(updatesGetStateAnswer(qint64,qint32,qint32,qint32,qint32,qint32)),
+             SLOT(updatesGetState_slt(qint64,qint32,qint32,qint32,qint32,qint32)) );
+    connect( p->telegram, SIGNAL(updatesGetDifferenceAnswer(qint64,QList<Message>,QList<SecretChatMessage>,QList<Update>,QList<Chat>,QList<User>,UpdatesState,bool)),
+             SLOT(updatesGetDifference_slt(qint64,QList<Message>,QList<SecretChatMessage>,QList<Update>,QList<Chat>,QList<User>,UpdatesState,bool)) );
     connect(  p->telegram, SIGNAL(updateSecretChatMessage(SecretChatMessage,qint32)),
               SLOT(updateSecretChatMessage_slt(SecretChatMessage,qint32)) );
 
@@ -1587,6 +2246,12 @@ void TelegramQml::authLoggedIn_slt()
     emit meChanged();
 
     p->telegram->accountUpdateStatus(!p->online || p->invisible);
+
+    // Catch up on whatever happened since the last session
+    if(p->state_loaded)
+        startCatchUp();
+    else
+        loadUpdatesState();
 }
 
 void TelegramQml::authLogOut_slt(qint64 id, bool ok)
@@ -1682,7 +2347,7 @@ void TelegramQml::accountGetWallPapers_slt(qint64 id, const QList<WallPaper> &wa
 
         PhotoSizeObject *sml_size = obj->sizes()->last();
         if( sml_size )
-            getFile(sml_size->location());
+            getFile(sml_size->location(), InputFileLocation::typeInputFileLocation, 0, CutegramEnums::DownloadPriorityPrefetch);
 
         PhotoSizeObject *lrg_size = obj->sizes()->first();
         if( lrg_size )
@@ -1706,8 +2371,7 @@ void TelegramQml::photosUploadProfilePhoto_slt(qint64 id, const Photo &photo, co
         p->upload_photo_path.clear();
     }
 
-    foreach( const User & user, users )
-        insertUser(user);
+    insertUsers(users);
 
     p->profile_upload_id = 0;
     emit uploadingProfilePhotoChanged();
@@ -1720,8 +2384,6 @@ void TelegramQml::photosUpdateProfilePhoto_slt(qint64 id, const UserProfilePhoto
     UserObject *user = p->users.value(me());
     if(user)
         *(user->photo()) = userProfilePhoto;
-
-    timerUpdateDialogs(100);
 }
 
 void TelegramQml::contactsImportContacts_slt(qint64 id, const QList<ImportedContact> &importedContacts, const QList<qint64> &retryContacts, const QList<User> &users)
@@ -1730,10 +2392,7 @@ void TelegramQml::contactsImportContacts_slt(qint64 id, const QList<ImportedCont
     Q_UNUSED(importedContacts)
     Q_UNUSED(retryContacts)
 
-    foreach( const User & user, users )
-        insertUser(user);
-
-    timerUpdateDialogs(100);
+    insertUsers(users);
 }
 
 void TelegramQml::contactsGetContacts_slt(qint64 id, bool modified, const QList<Contact> &contacts, const QList<User> &users)
@@ -1741,8 +2400,7 @@ void TelegramQml::contactsGetContacts_slt(qint64 id, bool modified, const QList<
     Q_UNUSED(id)
     Q_UNUSED(modified)
 
-    foreach( const User & user, users )
-        insertUser(user);
+    insertUsers(users);
     foreach( const Contact & contact, contacts )
         insertContact(contact);
 }
@@ -1761,10 +2419,10 @@ void TelegramQml::usersGetFullUser_slt(qint64 id, const User &user, const Contac
 
 void TelegramQml::messagesSendMessage_slt(qint64 id, qint32 msgId, qint32 date, qint32 pts, qint32 seq, const QList<ContactsLink> &links)
 {
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
     Q_UNUSED(links)
 
+    updateState(pts, 1, seq);
+
     if( !p->pend_messages.contains(id) )
         return;
 
@@ -1790,25 +2448,23 @@ void TelegramQml::messagesSendMessage_slt(qint64 id, qint32 msgId, qint32 date,
     if( !did )
         did = msg.out()? msg.toId().userId() : msg.fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(msg);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(msg, false);
 }
 
 void TelegramQml::messagesForwardMessage_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
 
     insertMessage(message);
 }
@@ -1816,147 +2472,158 @@ void TelegramQml::messagesForwardMessage_slt(qint64 id, const Message &message,
 void TelegramQml::messagesDeleteMessages_slt(qint64 id, const QList<qint32> &deletedMsgIds)
 {
     Q_UNUSED(id)
+    QSet<qint64> topDialogs;
     foreach( qint32 msgId, deletedMsgIds )
     {
-        if(!p->messages.contains(msgId))
+        if(!p->store.contains(msgId))
             continue;
 
         qint64 dId = messageDialogId(msgId);
+        DialogObject *dlg = p->dialogs.value(dId);
+        if(dlg && dlg->topMessage() == msgId)
+            topDialogs.insert(dId);
 
-        p->garbages.insert( p->messages.take(msgId) );
+        dropMessage(msgId);
         p->messages_list[dId].removeAll(msgId);
         p->database->deleteMessage(msgId);
 
         startGarbageChecker();
     }
 
+    foreach(qint64 dId, topDialogs)
+        refreshDialogTopMessage(dId);
+
     emit messagesChanged(false);
-    timerUpdateDialogs(3000);
 }
 
 void TelegramQml::messagesSendMedia_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
+
+    MessageObject *uplMsg = takeUpload(id);
+    if( !uplMsg )
+        return;
 
-    MessageObject *uplMsg = p->uploads.value(id);
     qint64 old_msgId = uplMsg->id();
     qint64 did = uplMsg->toId()->chatId();
     if( !did )
         did = uplMsg->out()? uplMsg->toId()->userId() : uplMsg->fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(message);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesSendPhoto_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
+
+    MessageObject *uplMsg = takeUpload(id);
+    if( !uplMsg )
+        return;
 
-    MessageObject *uplMsg = p->uploads.value(id);
     qint64 old_msgId = uplMsg->id();
     qint64 did = uplMsg->toId()->chatId();
     if( !did )
         did = uplMsg->out()? uplMsg->toId()->userId() : uplMsg->fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(message);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesSendVideo_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
+
+    MessageObject *uplMsg = takeUpload(id);
+    if( !uplMsg )
+        return;
 
-    MessageObject *uplMsg = p->uploads.value(id);
     qint64 old_msgId = uplMsg->id();
     qint64 did = uplMsg->toId()->chatId();
     if( !did )
         did = uplMsg->out()? uplMsg->toId()->userId() : uplMsg->fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(message);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesSendAudio_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
+
+    MessageObject *uplMsg = takeUpload(id);
+    if( !uplMsg )
+        return;
 
-    MessageObject *uplMsg = p->uploads.value(id);
     qint64 old_msgId = uplMsg->id();
     qint64 did = uplMsg->toId()->chatId();
     if( !did )
         did = uplMsg->out()? uplMsg->toId()->userId() : uplMsg->fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(message);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesSendDocument_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const Chat & chat, chats )
-        insertChat(chat);
-    foreach( const User & user, users )
-        insertUser(user);
+    updateState(pts, 1, seq);
+
+    insertChats(chats);
+    insertUsers(users);
+
+    MessageObject *uplMsg = takeUpload(id);
+    if( !uplMsg )
+        return;
 
-    MessageObject *uplMsg = p->uploads.value(id);
     qint64 old_msgId = uplMsg->id();
     qint64 did = uplMsg->toId()->chatId();
     if( !did )
         did = uplMsg->out()? uplMsg->toId()->userId() : uplMsg->fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(message);
-    timerUpdateDialogs(3000);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesGetDialogs_slt(qint64 id, qint32 sliceCount, const QList<Dialog> &dialogs, const QList<Message> &messages, const QList<Chat> &chats, const QList<User> &users)
@@ -1964,12 +2631,17 @@ void TelegramQml::messagesGetDialogs_slt(qint64 id, qint32 sliceCount, const QLi
     Q_UNUSED(id)
     Q_UNUSED(sliceCount)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
-    foreach( const Message & m, messages )
-        insertMessage(m);
+    // Every full dialogs fetch is counted, so regressions to refetching
+    // on ordinary updates show up
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    while(!p->dialogs_refetches.isEmpty() && p->dialogs_refetches.first() < now - 60*60*1000)
+        p->dialogs_refetches.removeFirst();
+    p->dialogs_refetches << now;
+    emit dialogsRefetchesChanged();
+
+    insertUsers(users);
+    insertChats(chats);
+    insertMessages(messages);
 
     QSet<qint64> dialogIds;
     foreach( const Dialog & d, dialogs )
@@ -1988,7 +2660,7 @@ void TelegramQml::messagesGetDialogs_slt(qint64 id, qint32 sliceCount, const QLi
         if(dId == cutegramId())
             continue;
 
-        p->dialogs_list.removeOne(dId);
+        removeDialogIndex(dId);
         p->dialogs.remove(dId);
         p->garbages.insert(dobj);
         p->database->deleteDialog(dId);
@@ -2005,67 +2677,64 @@ void TelegramQml::messagesGetHistory_slt(qint64 id, qint32 sliceCount, const QLi
     Q_UNUSED(id)
     Q_UNUSED(sliceCount)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
-    foreach( const Message & m, messages )
-        insertMessage(m);
+    insertUsers(users);
+    insertChats(chats);
 
-    emit messagesChanged(false);
+    insertMessages(messages);
 }
 
 void TelegramQml::messagesDeleteHistory_slt(qint64 id, qint32 pts, qint32 seq, qint32 offset)
 {
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
     Q_UNUSED(offset)
 
+    updateState(pts, -1, seq);
+
     qint64 peerId = p->delete_history_requests.value(id);
     if(!peerId)
         return;
 
     p->database->deleteHistory(peerId);
 
-    const QList<qint64> & messages = p->messages_list.value(id);
+    const QList<qint64> messages = p->messages_list.value(peerId);
     foreach(qint64 msgId, messages)
     {
-        p->garbages.insert( p->messages.take(msgId) );
+        dropMessage(msgId);
         p->messages_list[peerId].removeAll(msgId);
     }
 
+    DialogObject *dlg = p->dialogs.value(peerId);
+    if(dlg)
+        dlg->setUnreadCount(0);
+    refreshDialogTopMessage(peerId);
+
     startGarbageChecker();
     emit messagesChanged(false);
-    timerUpdateDialogs(3000);
 }
 
 void TelegramQml::messagesSearch_slt(qint64 id, qint32 sliceCount, const QList<Message> &messages, const QList<Chat> &chats, const QList<User> &users)
 {
-    Q_UNUSED(id)
     Q_UNUSED(sliceCount)
+    if( !p->search_requests.contains(id) )
+        return;
+
+    const QString &keyword = p->search_requests.take(id);
 
     QList<qint64> res;
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    insertUsers(users);
+    insertChats(chats);
+    insertMessages(messages);
     foreach( const Message & m, messages )
-    {
-        insertMessage(m);
         res << m.id();
-    }
 
-    emit searchDone(res);
+    emit searchDone(keyword, res);
 }
 
 void TelegramQml::messagesGetFullChat_slt(qint64 id, const ChatFull &chatFull, const QList<Chat> &chats, const QList<User> &users)
 {
     Q_UNUSED(id)
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    insertUsers(users);
+    insertChats(chats);
 
     ChatFullObject *obj = p->chatfulls.value(chatFull.id());
     if( !obj )
@@ -2083,80 +2752,70 @@ void TelegramQml::messagesCreateChat_slt(qint64 id, const Message &message, cons
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    updateState(pts, 1, seq);
+
+    insertUsers(users);
+    insertChats(chats);
 
     insertMessage(message);
-    timerUpdateDialogs(500);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesEditChatTitle_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    updateState(pts, 1, seq);
+
+    insertUsers(users);
+    insertChats(chats);
 
     insertMessage(message);
-    timerUpdateDialogs(500);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesEditChatPhoto_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    updateState(pts, 1, seq);
+
+    insertUsers(users);
+    insertChats(chats);
 
     insertMessage(message);
-    timerUpdateDialogs(500);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesAddChatUser_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    updateState(pts, 1, seq);
+
+    insertUsers(users);
+    insertChats(chats);
 
     insertMessage(message);
-    timerUpdateDialogs(500);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesDeleteChatUser_slt(qint64 id, const Message &message, const QList<Chat> &chats, const QList<User> &users, const QList<ContactsLink> &links, qint32 pts, qint32 seq)
 {
     Q_UNUSED(id)
     Q_UNUSED(links)
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
 
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    updateState(pts, 1, seq);
+
+    insertUsers(users);
+    insertChats(chats);
 
     insertMessage(message);
-    timerUpdateDialogs(500);
+    updateDialogTopMessage(message, false);
 }
 
 void TelegramQml::messagesCreateEncryptedChat_slt(qint32 chatId, qint32 date, qint32 peerId, qint64 accessHash)
@@ -2237,17 +2896,17 @@ void TelegramQml::messagesSendEncrypted_slt(qint64 id, qint32 date, const Encryp
     if( !did )
         did = msg.out()? msg.toId().userId() : msg.fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(msg);
-    timerUpdateDialogs(3000);
+    updateEncryptedTopMessage(msg);
 }
 
 void TelegramQml::messagesSendEncryptedFile_slt(qint64 id, qint32 date, const EncryptedFile &encryptedFile)
 {
-    MessageObject *msgObj = p->uploads.take(id);
+    MessageObject *msgObj = takeUpload(id);
     if(!msgObj)
         return;
 
@@ -2265,6 +2924,7 @@ void TelegramQml::messagesSendEncryptedFile_slt(qint64 id, qint32 date, const En
         srcSuffix = "." + srcSuffix;
 
     QFile::copy(srcFile, dstFile + srcSuffix);
+    fileLocationWritten(dstFile + srcSuffix);
 
     msgObj->setSent(true);
 
@@ -2303,33 +2963,92 @@ void TelegramQml::messagesSendEncryptedFile_slt(qint64 id, qint32 date, const En
     if( !did )
         did = msg.out()? msg.toId().userId() : msg.fromId();
 
-    p->garbages.insert( p->messages.take(old_msgId) );
+    dropMessage(old_msgId);
     p->messages_list[did].removeAll(old_msgId);
 
     startGarbageChecker();
     insertMessage(msg, true);
     insertDialog(dialog, true);
-    timerUpdateDialogs(3000);
 }
 
 void TelegramQml::error(qint64 id, qint32 errorCode, QString errorText)
 {
-    Q_UNUSED(id)
     Q_UNUSED(errorCode)
     p->error = errorText;
     emit errorChanged();
+
+    p->search_requests.remove(id);
+    if( id && (id == p->difference_req_id || id == p->state_req_id) )
+        updatesRequestFailed(id);
 }
 
 void TelegramQml::updatesTooLong_slt()
 {
-    timerUpdateDialogs();
+    requestDifference();
 }
 
-void TelegramQml::updateShortMessage_slt(qint32 id, qint32 fromId, QString message, qint32 pts, qint32 date, qint32 seq)
+void TelegramQml::updatesGetState_slt(qint64 id, qint32 pts, qint32 qts, qint32 date, qint32 seq, qint32 unreadCount)
 {
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
+    Q_UNUSED(unreadCount)
+    if(id != p->state_req_id)
+        return;
+
+    p->state_req_id = 0;
+    p->state_pts = pts;
+    p->state_qts = qts;
+    p->state_date = date;
+    p->state_seq = seq;
+    storeUpdatesState();
+    applyPendingUpdates();
+}
+
+void TelegramQml::updatesGetDifference_slt(qint64 id, const QList<Message> &messages, const QList<SecretChatMessage> &secretChatMessages, const QList<Update> &otherUpdates, const QList<Chat> &chats, const QList<User> &users, const UpdatesState &state, bool isIntermediateState)
+{
+    if(id != p->difference_req_id)
+        return;
+
+    p->difference_req_id = 0;
+
+    insertUsers(users);
+    insertChats(chats);
+    insertMessages(messages);
+    foreach( const Message & msg, messages )
+        updateDialogTopMessage(msg, msg.unread());
+    foreach( const SecretChatMessage & msg, secretChatMessages )
+        insertSecretChatMessage(msg);
+    foreach( const Update & update, otherUpdates )
+        insertUpdate(update);
+
+    p->state_pts = state.pts();
+    p->state_qts = state.qts();
+    p->state_date = state.date();
+    p->state_seq = state.seq();
+    storeUpdatesState();
+
+    if(isIntermediateState)
+    {
+        p->difference_slices++;
+        if(p->difference_slices < UPDATES_DIFFERENCE_SLICES)
+        {
+            requestDifference();
+            return;
+        }
+
+        // Too far behind: jump to the current state and let a single
+        // dialogs fetch fill in the top messages instead.
+        p->difference_slices = 0;
+        if(!p->state_req_id)
+            p->state_req_id = p->telegram->updatesGetState();
+        timerUpdateDialogs();
+        return;
+    }
+
+    p->difference_slices = 0;
+    applyPendingUpdates();
+}
 
+void TelegramQml::updateShortMessage_slt(qint32 id, qint32 fromId, QString message, qint32 pts, qint32 date, qint32 seq)
+{
     Peer to_peer(Peer::typePeerUser);
     to_peer.setUserId(p->telegram->ourId());
 
@@ -2341,36 +3060,18 @@ void TelegramQml::updateShortMessage_slt(qint32 id, qint32 fromId, QString messa
     msg.setOut(false);
     msg.setToId(to_peer);
 
-    insertMessage(msg);
-    if( p->dialogs.contains(fromId) )
-    {
-        DialogObject *dlg_o = p->dialogs.value(fromId);
-        dlg_o->setTopMessage(id);
-        dlg_o->setUnreadCount( dlg_o->unreadCount()+1 );
-    }
-    else
-    {
-        Peer fr_peer(Peer::typePeerUser);
-        fr_peer.setUserId(fromId);
-
-        Dialog dlg;
-        dlg.setPeer(fr_peer);
-        dlg.setTopMessage(id);
-        dlg.setUnreadCount(1);
-
-        insertDialog(dlg);
-    }
-
-    timerUpdateDialogs(3000);
+    TelegramQmlPendingUpdates updates;
+    updates.seq = seq;
+    updates.pts = pts;
+    updates.ptsCount = 1;
+    updates.date = date;
+    updates.messages << msg;
 
-    emit incomingMessage( p->messages.value(msg.id()) );
+    queueUpdates(updates);
 }
 
 void TelegramQml::updateShortChatMessage_slt(qint32 id, qint32 fromId, qint32 chatId, QString message, qint32 pts, qint32 date, qint32 seq)
 {
-    Q_UNUSED(pts)
-    Q_UNUSED(seq)
-
     Peer to_peer(Peer::typePeerChat);
     to_peer.setChatId(chatId);
 
@@ -2382,62 +3083,62 @@ void TelegramQml::updateShortChatMessage_slt(qint32 id, qint32 fromId, qint32 ch
     msg.setOut(false);
     msg.setToId(to_peer);
 
-    insertMessage(msg);
-    if( p->dialogs.contains(chatId) )
-    {
-        DialogObject *dlg_o = p->dialogs.value(chatId);
-        dlg_o->setTopMessage(id);
-        dlg_o->setUnreadCount( dlg_o->unreadCount()+1 );
-    }
-    else
-    {
-        Dialog dlg;
-        dlg.setPeer(to_peer);
-        dlg.setTopMessage(id);
-        dlg.setUnreadCount(1);
-
-        insertDialog(dlg);
-    }
-
-    timerUpdateDialogs(3000);
+    TelegramQmlPendingUpdates updates;
+    updates.seq = seq;
+    updates.pts = pts;
+    updates.ptsCount = 1;
+    updates.date = date;
+    updates.messages << msg;
 
-    emit incomingMessage( p->messages.value(msg.id()) );
+    queueUpdates(updates);
 }
 
 void TelegramQml::updateShort_slt(const Update &update, qint32 date)
 {
-    Q_UNUSED(date)
-    insertUpdate(update);
+    TelegramQmlPendingUpdates pending;
+    pending.date = date;
+    pending.setUpdates(QList<Update>() << update);
+
+    queueUpdates(pending);
 }
 
 void TelegramQml::updatesCombined_slt(const QList<Update> & updates, const QList<User> & users, const QList<Chat> & chats, qint32 date, qint32 seqStart, qint32 seq)
 {
-    Q_UNUSED(date)
-    Q_UNUSED(seq)
-    Q_UNUSED(seqStart)
-    foreach( const Update & u, updates )
-        insertUpdate(u);
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    TelegramQmlPendingUpdates pending;
+    pending.seqStart = seqStart;
+    pending.seq = seq;
+    pending.date = date;
+    pending.setUpdates(updates);
+    pending.users = users;
+    pending.chats = chats;
+
+    queueUpdates(pending);
 }
 
 void TelegramQml::updates_slt(const QList<Update> & updates, const QList<User> & users, const QList<Chat> & chats, qint32 date, qint32 seq)
 {
-    Q_UNUSED(date)
-    Q_UNUSED(seq)
-    foreach( const Update & u, updates )
-        insertUpdate(u);
-    foreach( const User & u, users )
-        insertUser(u);
-    foreach( const Chat & c, chats )
-        insertChat(c);
+    TelegramQmlPendingUpdates pending;
+    pending.seq = seq;
+    pending.date = date;
+    pending.setUpdates(updates);
+    pending.users = users;
+    pending.chats = chats;
+
+    queueUpdates(pending);
 }
 
 void TelegramQml::updateSecretChatMessage_slt(const SecretChatMessage &secretChatMessage, qint32 qts)
 {
-    Q_UNUSED(qts)
+    TelegramQmlPendingUpdates pending;
+    pending.qts = qts;
+    pending.qtsCount = 1;
+    pending.secretMessages << secretChatMessage;
+
+    queueUpdates(pending);
+}
+
+void TelegramQml::insertSecretChatMessage(const SecretChatMessage &secretChatMessage)
+{
 
     const qint32 chatId = secretChatMessage.chatId();
     const DecryptedMessage &m = secretChatMessage.decryptedMessage();
@@ -2493,69 +3194,65 @@ void TelegramQml::updateSecretChatMessage_slt(const SecretChatMessage &secretCha
 
     insertMessage(msg, true);
 
-    MessageObject *msgObj = p->messages.value(msg.id());
-    if(msgObj && hasMedia)
+    if(hasMedia)
     {
-        msgObj->media()->document()->setEncryptKey(dmedia.key());
-        msgObj->media()->document()->setEncryptIv(dmedia.iv());
-
+        setMessageEncryptKeys(msg.id(), dmedia.key(), dmedia.iv());
         p->database->insertMediaEncryptedKeys(msg.id(), dmedia.key(), dmedia.iv());
     }
 }
 
 void TelegramQml::uploadGetFile_slt(qint64 id, const StorageFileType &type, qint32 mtime, const QByteArray & bytes, qint32 partId, qint32 downloaded, qint32 total)
 {
-    FileLocationObject *obj = p->downloads.value(id);
-    if( !obj )
+    if( !p->downloads.contains(id) )
         return;
 
     Q_UNUSED(type)
-    const QString & download_file = fileLocation(obj);
-
-    DownloadObject *download = obj->download();
-    download->setMtime(mtime);
-    download->setPartId(partId);
-    download->setDownloaded(downloaded);
-    if(total)
-        download->setTotal(total);
-
-    if( !download->file()->isOpen() )
+    qint32 expected = total;
+    foreach(FileLocationObject *l, p->download_scheduler->locations(id))
     {
-        download->file()->setFileName(download_file);
-        if( !download->file()->open(QFile::WriteOnly) )
-            return;
+        DownloadObject *download = l->download();
+        download->setMtime(mtime);
+        download->setPartId(partId);
+        download->setDownloaded(downloaded);
+        if(total)
+            download->setTotal(total);
+
+        expected = download->total();
     }
 
-    download->file()->write(bytes);
+    p->download_sink->write(id, downloaded-bytes.size(), bytes);
 
-    if( downloaded >= download->total() && total == downloaded )
+    if( downloaded >= expected && total == downloaded )
     {
-        download->file()->flush();
-        download->file()->close();
+        const QString &sfx = QFileInfo(p->downloads.take(id)).suffix();
+        p->download_sink->finish(id, downloaded, sfx);
+    }
+}
 
-        const QMimeType & t = p->mime_db.mimeTypeForFile(download_file);
-        const QStringList & suffixes = t.suffixes();
-        if( !suffixes.isEmpty() )
-        {
-            QString sfx = suffixes.first();
-            if(!obj->fileName().isEmpty())
-            {
-                QFileInfo finfo(obj->fileName());
-                if(!finfo.suffix().isEmpty())
-                    sfx = finfo.suffix();
-            }
+void TelegramQml::downloadStarted(qint64 fileId, FileLocationObject *l)
+{
+    p->downloads[fileId] = l->fileName();
+    p->download_sink->open(fileId, fileLocation(l), l->download()->total());
+}
 
-            if(!sfx.isEmpty())
-                sfx = "."+sfx;
+void TelegramQml::downloadFinished(qint64 id, const QString &path)
+{
+    if(!path.isEmpty())
+        fileLocationWritten(path);
 
-            QFile::rename(download_file, download_file+sfx);
-            download->setLocation(FILES_PRE_STR + download_file+sfx);
+    foreach(FileLocationObject *l, p->download_scheduler->locations(id))
+    {
+        DownloadObject *download = l->download();
+        if(path.isEmpty())
+        {
+            download->setFileId(0);
+            download->setDownloaded(0);
         }
         else
-            download->setLocation(FILES_PRE_STR + download_file);
-
-        p->downloads.remove(id);
+            download->setLocation(FILES_PRE_STR + path);
     }
+
+    p->download_scheduler->finished(id);
 }
 
 void TelegramQml::uploadSendFile_slt(qint64 fileId, qint32 partId, qint32 uploaded, qint32 totalSize)
@@ -2565,6 +3262,8 @@ void TelegramQml::uploadSendFile_slt(qint64 fileId, qint32 partId, qint32 upload
         return;
 
     UploadObject *upload = msgObj->upload();
+    addUploadProgress(totalSize-upload->totalSize(), uploaded-upload->uploaded());
+
     upload->setPartId(partId);
     upload->setUploaded(uploaded);
     upload->setTotalSize(totalSize);
@@ -2577,28 +3276,33 @@ void TelegramQml::uploadCancelFile_slt(qint64 fileId, bool cancelled)
 
     if( p->uploads.contains(fileId) )
     {
-        MessageObject *msgObj = p->uploads.take(fileId);
+        MessageObject *msgObj = takeUpload(fileId);
         qint64 msgId = msgObj->id();
         qint64 dId = messageDialogId(msgId);
 
-        p->garbages.insert( p->messages.take(msgId) );
+        dropMessage(msgId);
         p->messages_list[dId].removeAll(msgId);
 
         startGarbageChecker();
         emit messagesChanged(false);
+        emit uploadsChanged();
     }
     else
     if( p->downloads.contains(fileId) )
     {
-        FileLocationObject *locObj = p->downloads.take(fileId);
-        locObj->download()->setLocation(QString());
-        locObj->download()->setFileId(0);
-        locObj->download()->setMtime(0);
-        locObj->download()->setPartId(0);
-        locObj->download()->setTotal(0);
-        locObj->download()->setDownloaded(0);
-        locObj->download()->file()->close();
-        locObj->download()->file()->remove();
+        p->downloads.remove(fileId);
+        foreach(FileLocationObject *l, p->download_scheduler->locations(fileId))
+        {
+            l->download()->setLocation(QString());
+            l->download()->setFileId(0);
+            l->download()->setMtime(0);
+            l->download()->setPartId(0);
+            l->download()->setTotal(0);
+            l->download()->setDownloaded(0);
+        }
+
+        p->download_sink->cancel(fileId);
+        p->download_scheduler->finished(fileId);
     }
 }
 
@@ -2607,7 +3311,19 @@ void TelegramQml::incomingAsemanMessage(const Message &msg, const Dialog &dialog
     insertMessage(msg);
     insertDialog(dialog);
 
-    emit incomingMessage( p->messages.value(msg.id()) );
+    emit incomingMessage( TelegramQml::message(msg.id()) );
+}
+
+void TelegramQml::connected_slt()
+{
+    if( !p->authLoggedIn || !p->state_loaded )
+        return;
+
+    // Answers of the requests running before the connection dropped may
+    // never come back.
+    p->difference_req_id = 0;
+    p->state_req_id = 0;
+    startCatchUp();
 }
 
 void TelegramQml::insertDialog(const Dialog &d, bool encrypted, bool fromDb)
@@ -2630,15 +3346,15 @@ void TelegramQml::insertDialog(const Dialog &d, bool encrypted, bool fromDb)
     {
         *obj = d;
         obj->setEncrypted(encrypted);
+        if( p->typing_users.contains(did) )
+        {
+            p->typing_changed.insert(did);
+            if( !p->typing_flush_timer )
+                p->typing_flush_timer = startTimer(TYPING_FLUSH_INTERVAL);
+        }
     }
 
-    p->dialogs_list = p->dialogs.keys();
-
-    telegramp_qml_tmp = p;
-    qStableSort( p->dialogs_list.begin(), p->dialogs_list.end(), checkDialogLessThan );
-
-    emit dialogsChanged(fromDb);
-
+    refreshDialogIndex(did);
     refreshUnreadCount();
 
     if(!fromDb)
@@ -2647,34 +3363,43 @@ void TelegramQml::insertDialog(const Dialog &d, bool encrypted, bool fromDb)
 
 void TelegramQml::insertMessage(const Message &m, bool encrypted, bool fromDb, bool tempMsg)
 {
-    MessageObject *obj = p->messages.value(m.id());
-    if( !obj )
-    {
-        obj = new MessageObject(m, this);
-        obj->setEncrypted(encrypted);
+    qint64 did = m.toId().chatId();
+    if( !did )
+        did = m.out()? m.toId().userId() : m.fromId();
 
-        p->messages.insert(m.id(), obj);
+    if( !p->store.contains(m.id()) )
+    {
+        p->store.insert(did, m, encrypted);
 
-        qint64 did = m.toId().chatId();
-        if( !did )
-            did = m.out()? m.toId().userId() : m.fromId();
+        QList<qint64> & list = p->messages_list[did];
 
-        QList<qint64> list = p->messages_list.value(did);
+        telegramp_qml_tmp = p;
+        QList<qint64>::iterator i = qUpperBound( list.begin(), list.end(), m.id(), checkMessageLessThan );
+        list.insert(i, m.id());
 
-        list << m.id();
+        DialogObject *dlg = p->dialogs.value(did);
+        if( dlg && dlg->topMessage() == m.id() )
+            refreshDialogIndex(did);
 
-        telegramp_qml_tmp = p;
-        qStableSort( list.begin(), list.end(), checkMessageLessThan );
+        if(!fromDb && !tempMsg)
+            harvestTags(m);
 
-        p->messages_list[did] = list;
+        p->evicted_messages.remove(m.id());
+        startResidencyCheck();
     }
     else
     if(fromDb && !encrypted)
         return;
     else
     {
-        *obj = m;
-        obj->setEncrypted(encrypted);
+        p->store.insert(did, m, encrypted);
+
+        MessageObject *obj = p->messages.value(m.id());
+        if( obj )
+        {
+            *obj = m;
+            obj->setEncrypted(encrypted);
+        }
     }
 
     emit messagesChanged(fromDb && !encrypted);
@@ -2685,65 +3410,200 @@ void TelegramQml::insertMessage(const Message &m, bool encrypted, bool fromDb, b
         updateEncryptedTopMessage(m);
 }
 
-void TelegramQml::insertUser(const User &u, bool fromDb)
+void TelegramQml::insertMessages(const QList<Message> &messages, bool fromDb, bool tempMsg)
 {
-    bool become_online = false;
-    UserObject *obj = p->users.value(u.id());
-    if(!fromDb && obj && obj->status()->classType() == UserStatus::typeUserStatusOffline &&
-            u.status().classType() == UserStatus::typeUserStatusOnline )
-        become_online = true;
-
-    if( !obj )
+    QHash<qint64, QList<qint64> > newIds;
+    QHash<qint64, QList<Message> > newMessages;
+    QList<Message> dbMessages;
+    foreach( const Message & m, messages )
     {
-        obj = new UserObject(u, this);
-        p->users.insert(u.id(), obj);
+        qint64 did = m.toId().chatId();
+        if( !did )
+            did = m.out()? m.toId().userId() : m.fromId();
 
-//        getFile(obj->photo()->photoSmall());
+        if( !p->store.contains(m.id()) )
+        {
+            newIds[did] << m.id();
+            newMessages[did] << m;
+            if(!fromDb && !tempMsg)
+                harvestTags(m);
 
-        QStringList userNameKeys;
-        if(!u.username().isEmpty())
+            p->evicted_messages.remove(m.id());
+        }
+        else
+        if(fromDb)
+            continue;
+        else
         {
-            userNameKeys << stringToIndex(u.firstName());
-            userNameKeys << stringToIndex(u.lastName());
-            userNameKeys << stringToIndex(u.username());
+            p->store.insert(did, m, false);
+
+            MessageObject *obj = p->messages.value(m.id());
+            if( obj )
+            {
+                *obj = m;
+                obj->setEncrypted(false);
+            }
         }
 
-        foreach(const QString &key, userNameKeys)
-            p->userNameIndexes.insertMulti(key.toLower(), u.id());
+        if(!fromDb && !tempMsg)
+            dbMessages << m;
     }
-    else
-    if(fromDb)
-        return;
-    else
-        *obj = u;
 
-    if(!fromDb && p->database)
-        p->database->insertUser(u);
-
-    if(become_online)
-        emit userBecomeOnline(u.id());
-}
+    if(!dbMessages.isEmpty())
+        p->database->insertMessages(dbMessages);
 
-void TelegramQml::insertChat(const Chat &c, bool fromDb)
-{
-    ChatObject *obj = p->chats.value(c.id());
-    if( !obj )
+    QHashIterator<qint64, QList<Message> > m(newMessages);
+    while(m.hasNext())
     {
-        obj = new ChatObject(c, this);
-        p->chats.insert(c.id(), obj);
+        m.next();
+        p->store.insert(m.key(), m.value());
+    }
 
-//        getFile(obj->photo()->photoSmall());
+    QHashIterator<qint64, QList<qint64> > i(newIds);
+    while(i.hasNext())
+    {
+        i.next();
+        mergeMessageIndex(i.key(), i.value());
+    }
+
+    if(!newIds.isEmpty())
+        startResidencyCheck();
+
+    emit messagesChanged(fromDb);
+}
+
+void TelegramQml::mergeMessageIndex(qint64 dId, QList<qint64> ids)
+{
+    telegramp_qml_tmp = p;
+    qStableSort( ids.begin(), ids.end(), checkMessageLessThan );
+
+    const QList<qint64> & list = p->messages_list.value(dId);
+    QList<qint64> merged;
+    merged.reserve(list.count() + ids.count());
+    std::merge( list.constBegin(), list.constEnd(), ids.constBegin(), ids.constEnd(),
+                std::back_inserter(merged), checkMessageLessThan );
+
+    p->messages_list[dId] = merged;
+
+    DialogObject *dlg = p->dialogs.value(dId);
+    if( dlg && ids.contains(dlg->topMessage()) )
+        refreshDialogIndex(dId);
+}
+
+void TelegramQml::harvestTags(const Message &m)
+{
+    const QString &text = m.message();
+    if(!text.contains('#'))
+        return;
+
+    QRegExp tags_rxp("\\#(\\w+)");
+    int pos = 0;
+    while((pos = tags_rxp.indexIn(text, pos)) != -1)
+    {
+        TagUsage &usage = p->pending_tags[tags_rxp.cap(1).toLower()];
+        usage.count++;
+        usage.lastUse = qMax<qint64>(usage.lastUse, m.date());
+        pos += tags_rxp.matchedLength();
+    }
+
+    if(!p->pending_tags.isEmpty() && !p->tags_flush_timer)
+        p->tags_flush_timer = startTimer(5000);
+}
+
+void TelegramQml::flushTags()
+{
+    if(p->tags_flush_timer)
+        killTimer(p->tags_flush_timer);
+    p->tags_flush_timer = 0;
+
+    if(p->pending_tags.isEmpty())
+        return;
+
+    p->userdata->addTags(p->pending_tags);
+    p->pending_tags.clear();
+}
+
+void TelegramQml::insertUser(const User &u, bool fromDb, bool writeDb)
+{
+    bool become_online = false;
+    UserObject *obj = p->users.value(u.id());
+    if(!fromDb && obj && obj->status()->classType() == UserStatus::typeUserStatusOffline &&
+            u.status().classType() == UserStatus::typeUserStatusOnline )
+        become_online = true;
+
+    if( !obj )
+    {
+        obj = new UserObject(u, this);
+        p->users.insert(u.id(), obj);
+
+//        getFile(obj->photo()->photoSmall());
+
+        insertUserIndex(u);
+    }
+    else
+    if(fromDb)
+        return;
+    else
+    {
+        if(obj->username() != u.username() || obj->firstName() != u.firstName() ||
+           obj->lastName() != u.lastName())
+            insertUserIndex(u);
+
+        *obj = u;
     }
-    else
-    if(fromDb)
-        return;
-    else
-        *obj = c;
 
     if(!fromDb)
+        scheduleStatusExpiry(obj);
+    if(!fromDb && writeDb && p->database)
+        p->database->insertUser(u);
+
+    if(become_online)
+        emit userBecomeOnline(u.id());
+}
+
+void TelegramQml::insertChat(const Chat &c, bool fromDb, bool writeDb)
+{
+    ChatObject *obj = p->chats.value(c.id());
+    if( !obj )
+    {
+        obj = new ChatObject(c, this);
+        p->chats.insert(c.id(), obj);
+
+//        getFile(obj->photo()->photoSmall());
+    }
+    else
+    if(fromDb)
+        return;
+    else
+        *obj = c;
+
+    if(!fromDb && writeDb)
         p->database->insertChat(c);
 }
 
+void TelegramQml::insertUsers(const QList<User> &users)
+{
+    if(users.isEmpty())
+        return;
+
+    foreach( const User & u, users )
+        insertUser(u, false, false);
+
+    if(p->database)
+        p->database->insertUsers(users);
+}
+
+void TelegramQml::insertChats(const QList<Chat> &chats)
+{
+    if(chats.isEmpty())
+        return;
+
+    foreach( const Chat & c, chats )
+        insertChat(c, false, false);
+
+    p->database->insertChats(chats);
+}
+
 void TelegramQml::insertUpdate(const Update &update)
 {
     UserObject *user = p->users.value(update.userId());
@@ -2758,6 +3618,7 @@ void TelegramQml::insertUpdate(const Update &update)
                     update.status().classType() == UserStatus::typeUserStatusOnline);
 
             *(user->status()) = update.status();
+            scheduleStatusExpiry(user);
             if(become_online)
                 emit userBecomeOnline(user->id());
         }
@@ -2777,25 +3638,7 @@ void TelegramQml::insertUpdate(const Update &update)
         if( !user )
             return;
 
-        const QString & id_str = QString::number(user->id());
-        const QPair<qint64,qint64> & timer_pair = QPair<qint64,qint64>(chat->id(), user->id());
-        QStringList tusers = dlg->typingUsers();
-
-        if( tusers.contains(id_str) )
-        {
-            const int timer_id = p->typing_timers.key(timer_pair);
-            killTimer(timer_id);
-            p->typing_timers.remove(timer_id);
-        }
-        else
-        {
-            tusers << id_str;
-            dlg->setTypingUsers( tusers );
-            emit userStartTyping(user->id(), chat->id());
-        }
-
-        int timer_id = startTimer(6000);
-        p->typing_timers.insert(timer_id, timer_pair);
+        setUserTyping(chat->id(), user->id(), true);
     }
         break;
 
@@ -2814,15 +3657,14 @@ void TelegramQml::insertUpdate(const Update &update)
             user->setFirstName(update.firstName());
             user->setLastName(update.lastName());
         }
-        timerUpdateDialogs();
         break;
 
     case Update::typeUpdateUserBlocked:
         break;
 
     case Update::typeUpdateNewMessage:
-        insertMessage(update.message(), false, false, true);
-        timerUpdateDialogs(3000);
+        insertMessage(update.message());
+        updateDialogTopMessage(update.message(), update.message().unread());
         break;
 
     case Update::typeUpdateContactLink:
@@ -2847,11 +3689,15 @@ void TelegramQml::insertUpdate(const Update &update)
     case Update::typeUpdateDeleteMessages:
     {
         const QList<qint32> &messages = update.messages();
+        QSet<qint64> topDialogs;
         foreach(quint64 msgId, messages)
         {
             qint64 dId = messageDialogId(msgId);
+            DialogObject *dlg = p->dialogs.value(dId);
+            if(dlg && dlg->topMessage() == static_cast<qint64>(msgId))
+                topDialogs.insert(dId);
 
-            p->garbages.insert( p->messages.take(msgId) );
+            dropMessage(msgId);
             p->messages_list[dId].removeAll(msgId);
             p->database->deleteMessage(msgId);
             startGarbageChecker();
@@ -2859,7 +3705,8 @@ void TelegramQml::insertUpdate(const Update &update)
             emit messagesChanged(false);
         }
 
-        timerUpdateDialogs();
+        foreach(qint64 dId, topDialogs)
+            refreshDialogTopMessage(dId);
     }
         break;
 
@@ -2871,24 +3718,7 @@ void TelegramQml::insertUpdate(const Update &update)
         if( !dlg )
             return;
 
-        const QString & id_str = QString::number(user->id());
-        const QPair<qint64,qint64> & timer_pair = QPair<qint64,qint64>(user->id(), user->id());
-        QStringList tusers = dlg->typingUsers();
-        if( tusers.contains(id_str) )
-        {
-            const int timer_id = p->typing_timers.key(timer_pair);
-            killTimer(timer_id);
-            p->typing_timers.remove(timer_id);
-        }
-        else
-        {
-            tusers << id_str;
-            dlg->setTypingUsers( tusers );
-            emit userStartTyping(user->id(), user->id());
-        }
-
-        int timer_id = startTimer(6000);
-        p->typing_timers.insert(timer_id, timer_pair);
+        setUserTyping(user->id(), user->id(), true);
     }
         break;
 
@@ -2899,45 +3729,37 @@ void TelegramQml::insertUpdate(const Update &update)
             return;
 
         qint64 userId = update.chat().adminId()==me()? update.chat().participantId() : update.chat().adminId();
-
-        const QString & id_str = QString::number(userId);
-        const QPair<qint64,qint64> & timer_pair = QPair<qint64,qint64>(userId, userId);
-        QStringList tusers = dlg->typingUsers();
-        if( tusers.contains(id_str) )
-        {
-            const int timer_id = p->typing_timers.key(timer_pair);
-            killTimer(timer_id);
-            p->typing_timers.remove(timer_id);
-        }
-        else
-        {
-            tusers << id_str;
-            dlg->setTypingUsers( tusers );
-            emit userStartTyping(userId, userId);
-        }
-
-        int timer_id = startTimer(6000);
-        p->typing_timers.insert(timer_id, timer_pair);
+        setUserTyping(update.chat().id(), userId, true);
     }
         break;
 
     case Update::typeUpdateReadMessages:
     {
         const QList<qint32> & msgIds = update.messages();
+        QSet<DialogObject*> dialogs;
         foreach( qint32 msgId, msgIds )
-            if( p->messages.contains(msgId) )
-                p->messages.value(msgId)->setUnread(false);
+        {
+            DialogObject *dlg = p->dialogs.value(messageDialogId(msgId));
+            if( dlg && p->store.unread(msgId) && !p->store.out(msgId) && dlg->unreadCount() > 0 )
+            {
+                dlg->setUnreadCount(dlg->unreadCount()-1);
+                dialogs.insert(dlg);
+            }
+
+            setMessageUnread(msgId, false);
+        }
+
+        foreach(DialogObject *dlg, dialogs)
+            storeDialog(dlg);
     }
         break;
 
     case Update::typeUpdateUserPhoto:
         if( user )
             *(user->photo()) = update.photo();
-        timerUpdateDialogs();
         break;
 
     case Update::typeUpdateContactRegistered:
-        timerUpdateDialogs();
         break;
 
     case Update::typeUpdateNewEncryptedMessage:
@@ -2946,16 +3768,11 @@ void TelegramQml::insertUpdate(const Update &update)
 
     case Update::typeUpdateEncryptedMessagesRead:
     {
-        MessageObject *msg = p->messages.value(update.encryptedMessage().file().id());
-        if(!msg)
-            return;
-
-        msg->setUnread(false);
+        setMessageUnread(update.encryptedMessage().file().id(), false);
     }
         break;
 
     case Update::typeUpdateChatParticipants:
-        timerUpdateDialogs();
         break;
     }
 }
@@ -3035,20 +3852,278 @@ void TelegramQml::timerEvent(QTimerEvent *e)
         p->garbage_checker_timer = 0;
     }
     else
-    if( p->typing_timers.contains(e->timerId()) )
+    if( e->timerId() == p->tags_flush_timer )
     {
-        killTimer(e->timerId());
+        flushTags();
+    }
+    else
+    if( e->timerId() == p->state_flush_timer )
+    {
+        flushUpdatesState();
+    }
+    else
+    if( e->timerId() == p->pending_updates_timer )
+    {
+        killTimer(p->pending_updates_timer);
+        p->pending_updates_timer = 0;
 
-        const QPair<qint64,qint64> & pair = p->typing_timers.take(e->timerId());
-        DialogObject *dlg = p->dialogs.value(pair.first);
-        if( !dlg )
+        // The gap did not fill itself in time
+        if(!p->pending_updates.isEmpty())
+            requestDifference();
+    }
+    else
+    if( e->timerId() == p->residency_timer )
+    {
+        killTimer(p->residency_timer);
+        p->residency_timer = 0;
+        checkResidency();
+    }
+    else
+    if( e->timerId() == p->typing_flush_timer )
+    {
+        flushTypingUsers();
+    }
+}
+
+void TelegramQml::setUserTyping(qint64 dId, qint64 userId, bool typing)
+{
+    if( typing )
+    {
+        p->ephemeral->start(EphemeralTimer::Typing, dId, userId, TYPING_TIMEOUT);
+
+        QSet<qint64> &users = p->typing_users[dId];
+        if( users.contains(userId) )
             return;
 
-        QStringList typings = dlg->typingUsers();
-        typings.removeAll(QString::number(pair.second));
+        users.insert(userId);
+        emit userStartTyping(userId, dId);
+    }
+    else
+    {
+        p->ephemeral->stop(EphemeralTimer::Typing, dId, userId);
+
+        QHash<qint64, QSet<qint64> >::iterator i = p->typing_users.find(dId);
+        if( i == p->typing_users.end() || !i.value().remove(userId) )
+            return;
+        if( i.value().isEmpty() )
+            p->typing_users.erase(i);
+    }
+
+    // Dialogs see the change on the next flush, at most a few times a second
+    p->typing_changed.insert(dId);
+    if( !p->typing_flush_timer )
+        p->typing_flush_timer = startTimer(TYPING_FLUSH_INTERVAL);
+}
+
+void TelegramQml::flushTypingUsers()
+{
+    if( p->typing_flush_timer )
+        killTimer(p->typing_flush_timer);
+    p->typing_flush_timer = 0;
+
+    foreach( qint64 dId, p->typing_changed )
+    {
+        DialogObject *dlg = p->dialogs.value(dId);
+        if( !dlg )
+            continue;
+
+        QStringList list;
+        foreach( qint64 userId, p->typing_users.value(dId) )
+            list << QString::number(userId);
+
+        dlg->setTypingUsers(list);
+    }
+
+    p->typing_changed.clear();
+}
+
+void TelegramQml::scheduleStatusExpiry(UserObject *user)
+{
+    UserStatusObject *status = user->status();
+    if( status->classType() != UserStatus::typeUserStatusOnline || !status->expires() )
+    {
+        p->ephemeral->stop(EphemeralTimer::UserOnline, user->id());
+        return;
+    }
+
+    const qint64 msecs = static_cast<qint64>(status->expires())*1000 - QDateTime::currentMSecsSinceEpoch();
+    p->ephemeral->start(EphemeralTimer::UserOnline, user->id(), 0, msecs);
+}
+
+void TelegramQml::ephemeralExpired(int kind, qint64 key, qint64 subKey)
+{
+    switch(kind)
+    {
+    case EphemeralTimer::Typing:
+        setUserTyping(key, subKey, false);
+        break;
+
+    case EphemeralTimer::UserOnline:
+    {
+        // No offline update came in time, so the online state ran out
+        UserObject *user = p->users.value(key);
+        if( !user || user->status()->classType() != UserStatus::typeUserStatusOnline )
+            break;
+
+        UserStatus status(UserStatus::typeUserStatusOffline);
+        status.setWasOnline(user->status()->expires());
+        *(user->status()) = status;
+    }
+        break;
+    }
+}
+
+void TelegramQml::startResidencyCheck()
+{
+    if( !p->residency_timer )
+        p->residency_timer = startTimer(5000);
+}
+
+void TelegramQml::checkResidency()
+{
+    QSet<qint64> pinned;
+    foreach(MessageObject *obj, p->uploads)
+        pinned.insert(obj->id());
+    foreach(MessageObject *obj, p->pend_messages)
+        pinned.insert(obj->id());
+    foreach(DialogObject *dlg, p->dialogs)
+        pinned.insert(dlg->topMessage());
+
+    // Recycles facades no delegate holds and nobody asked for since the last check
+    QHashIterator<qint64, MessageObject*> f(p->messages);
+    while(f.hasNext())
+    {
+        f.next();
+        const qint64 msgId = f.key();
+        MessageObject *obj = f.value();
+        if(pinned.contains(msgId) || p->messages_refs.contains(obj))
+            continue;
+        if(p->messages_touch.value(msgId, -1) >= p->messages_generation)
+            continue;
+
+        p->messages.remove(msgId);
+        p->messages_touch.remove(msgId);
+        recycleMessage(obj);
+    }
+
+    p->messages_generation++;
+
+    qint64 total = p->store.memoryUsage();
+    if(total > p->messages_budget)
+    {
+        // Least recently viewed dialogs go first, down to 3/4 of the budget
+        QList<qint64> dialogs = p->messages_list.keys();
+        telegramp_qml_tmp = p;
+        qStableSort(dialogs.begin(), dialogs.end(), checkDialogAccessLessThan);
+
+        const qint64 target = p->messages_budget*3/4;
+        foreach(qint64 dId, dialogs)
+        {
+            if(total <= target)
+                break;
+            if(p->retained_dialogs.contains(dId))
+                continue;
+
+            QList<qint64> &list = p->messages_list[dId];
+            QList<qint64> kept;
+            foreach(qint64 msgId, list)
+            {
+                MessageObject *obj = p->messages.value(msgId);
+                if(pinned.contains(msgId) || (obj && p->messages_refs.contains(obj)))
+                {
+                    kept << msgId;
+                    continue;
+                }
+
+                dropMessage(msgId);
+                p->evicted_messages.insert(msgId);
+            }
 
-        dlg->setTypingUsers(typings);
+            list = kept;
+            total = p->store.memoryUsage();
+        }
     }
+
+    startGarbageChecker();
+    emit messagesResidencyChanged();
+}
+
+MessageObject *TelegramQml::materializeMessage(qint64 msgId)
+{
+    const Message &msg = p->store.message(msgId);
+
+    MessageObject *obj;
+    if(p->messages_pool.isEmpty())
+        obj = new MessageObject(msg, this);
+    else
+    {
+        obj = p->messages_pool.takeLast();
+        *obj = msg;
+    }
+
+    obj->setEncrypted(p->store.encrypted(msgId));
+    if(p->store.hasEncryptKeys(msgId))
+    {
+        obj->media()->document()->setEncryptKey(p->store.encryptKey(msgId));
+        obj->media()->document()->setEncryptIv(p->store.encryptIv(msgId));
+    }
+
+    p->messages.insert(msgId, obj);
+    startResidencyCheck();
+    return obj;
+}
+
+void TelegramQml::recycleMessage(MessageObject *obj)
+{
+    if(p->messages_pool.count() < MESSAGE_POOL_SIZE)
+        p->messages_pool.append(obj);
+    else
+        p->garbages.insert(obj);
+}
+
+void TelegramQml::dropMessage(qint64 msgId)
+{
+    p->store.remove(msgId);
+    p->messages_touch.remove(msgId);
+
+    MessageObject *obj = p->messages.take(msgId);
+    if(obj)
+        p->garbages.insert(obj);
+}
+
+void TelegramQml::setMessageUnread(qint64 msgId, bool unread)
+{
+    p->store.setUnread(msgId, unread);
+
+    MessageObject *obj = p->messages.value(msgId);
+    if(obj)
+        obj->setUnread(unread);
+}
+
+void TelegramQml::setMessageEncryptKeys(qint64 msgId, const QByteArray &key, const QByteArray &iv)
+{
+    p->store.setEncryptKeys(msgId, key, iv);
+
+    MessageObject *obj = p->messages.value(msgId);
+    if(!obj)
+        return;
+
+    obj->media()->document()->setEncryptKey(key);
+    obj->media()->document()->setEncryptIv(iv);
+}
+
+void TelegramQml::messageDestroyed(QObject *obj)
+{
+    p->messages_refs.remove(static_cast<MessageObject*>(obj));
+}
+
+void TelegramQml::rehydrateMessages()
+{
+    if(p->rehydrate_messages.isEmpty())
+        return;
+
+    p->database->readMessagesById(p->rehydrate_messages.toList());
+    p->rehydrate_messages.clear();
 }
 
 void TelegramQml::startGarbageChecker()
@@ -3095,24 +4170,78 @@ void TelegramQml::dbDialogFounded(const Dialog &dialog, bool encrypted)
     }
 }
 
-void TelegramQml::dbMessageFounded(const Message &message)
+void TelegramQml::dbMessagesFounded(const QList<Message> &messages)
 {
-    bool encrypted = false;
-    DialogObject *dlg = p->dialogs.value(message.toId().chatId());
-    if(dlg)
-        encrypted = dlg->encrypted();
+    QList<Message> plains;
+    foreach( const Message & message, messages )
+    {
+        DialogObject *dlg = p->dialogs.value(message.toId().chatId());
+        if(dlg && dlg->encrypted())
+            insertMessage(message, true, true);
+        else
+            plains << message;
+    }
 
-    insertMessage(message, encrypted, true);
+    insertMessages(plains, true);
 }
 
 void TelegramQml::dbMediaKeysFounded(qint64 mediaId, const QByteArray &key, const QByteArray &iv)
 {
-    MessageObject *msg = p->messages.value(mediaId);
-    if(!msg)
+    setMessageEncryptKeys(mediaId, key, iv);
+}
+
+int TelegramQml::dialogIndexOf(qint64 dId) const
+{
+    if( !p->dialogs_keys.contains(dId) )
+        return -1;
+
+    telegramp_qml_tmp = p;
+    QList<qint64>::const_iterator i = qLowerBound( p->dialogs_list.constBegin(), p->dialogs_list.constEnd(), dId, checkDialogLessThan );
+    if( i == p->dialogs_list.constEnd() || *i != dId )
+        return p->dialogs_list.indexOf(dId);
+
+    return i - p->dialogs_list.constBegin();
+}
+
+void TelegramQml::refreshDialogIndex(qint64 dId)
+{
+    DialogObject *dlg = p->dialogs.value(dId);
+    if( !dlg )
         return;
 
-    msg->media()->document()->setEncryptKey(key);
-    msg->media()->document()->setEncryptIv(iv);
+    qint64 date = 0;
+    EncryptedChatObject *encChat = p->encchats.value(dId);
+    if( p->store.contains(dlg->topMessage()) )
+        date = p->store.date(dlg->topMessage());
+    else
+    if( encChat )
+        date = encChat->date();
+
+    const QPair<qint64,qint64> key(date, dlg->topMessage());
+    const int from = dialogIndexOf(dId);
+    if( from != -1 && p->dialogs_keys.value(dId) == key )
+        return;
+
+    if( from != -1 )
+        p->dialogs_list.removeAt(from);
+
+    p->dialogs_keys[dId] = key;
+
+    telegramp_qml_tmp = p;
+    QList<qint64>::iterator i = qLowerBound( p->dialogs_list.begin(), p->dialogs_list.end(), dId, checkDialogLessThan );
+    const int to = i - p->dialogs_list.begin();
+    p->dialogs_list.insert(to, dId);
+
+    emit dialogIndexChanged(dId, from, to);
+}
+
+void TelegramQml::removeDialogIndex(qint64 dId)
+{
+    const int idx = dialogIndexOf(dId);
+    if( idx != -1 )
+        p->dialogs_list.removeAt(idx);
+
+    p->dialogs_keys.remove(dId);
 }
 
 void TelegramQml::refreshUnreadCount()
@@ -3159,11 +4288,11 @@ void TelegramQml::updateEncryptedTopMessage(const Message &message)
     if(!dlg)
         return;
 
-    MessageObject *topMessage = p->messages.value(dlg->topMessage());
-    if(dlg->topMessage() && !topMessage)
+    const bool hasTopMessage = p->store.contains(dlg->topMessage());
+    if(dlg->topMessage() && !hasTopMessage)
         return;
 
-    qint32 topMsgDate = topMessage? topMessage->date() : 0;
+    qint32 topMsgDate = hasTopMessage? p->store.date(dlg->topMessage()) : 0;
     if(message.date() < topMsgDate)
         return;
 
@@ -3178,6 +4307,294 @@ void TelegramQml::updateEncryptedTopMessage(const Message &message)
     insertDialog(dialog, true, false);
 }
 
+void TelegramQml::updateDialogTopMessage(const Message &message, bool countUnread)
+{
+    qint64 dId = message.toId().chatId();
+    if( !dId )
+        dId = message.out()? message.toId().userId() : message.fromId();
+
+    DialogObject *dlg = p->dialogs.value(dId);
+    if( dlg && dlg->encrypted() )
+    {
+        updateEncryptedTopMessage(message);
+        return;
+    }
+
+    const bool unread = countUnread && !message.out();
+    if( !dlg )
+    {
+        Peer peer(message.toId().chatId()? Peer::typePeerChat : Peer::typePeerUser);
+        if( message.toId().chatId() )
+            peer.setChatId(dId);
+        else
+            peer.setUserId(dId);
+
+        Dialog dialog;
+        dialog.setPeer(peer);
+        dialog.setTopMessage(message.id());
+        dialog.setUnreadCount(unread? 1 : 0);
+
+        insertDialog(dialog);
+        return;
+    }
+
+    const bool hasTopMessage = p->store.contains(dlg->topMessage());
+    if( !hasTopMessage || p->store.date(dlg->topMessage()) <= message.date() )
+        dlg->setTopMessage(message.id());
+    if( unread )
+        dlg->setUnreadCount(dlg->unreadCount()+1);
+
+    refreshDialogIndex(dId);
+    storeDialog(dlg);
+}
+
+void TelegramQml::refreshDialogTopMessage(qint64 dId)
+{
+    DialogObject *dlg = p->dialogs.value(dId);
+    if( !dlg || dlg->encrypted() )
+        return;
+
+    const QList<qint64> &list = p->messages_list.value(dId);
+    dlg->setTopMessage(list.isEmpty()? 0 : list.first());
+
+    refreshDialogIndex(dId);
+    storeDialog(dlg);
+}
+
+void TelegramQml::storeDialog(DialogObject *dlg)
+{
+    Peer peer(static_cast<Peer::PeerType>(dlg->peer()->classType()));
+    peer.setChatId(dlg->peer()->chatId());
+    peer.setUserId(dlg->peer()->userId());
+
+    Dialog dialog;
+    dialog.setPeer(peer);
+    dialog.setTopMessage(dlg->topMessage());
+    dialog.setUnreadCount(dlg->unreadCount());
+
+    p->database->insertDialog(dialog, dlg->encrypted());
+}
+
+void TelegramQml::updatesRequestFailed(qint64 id)
+{
+    // The held updates can not be ordered any more. Start from a fresh
+    // state and let the dialogs fetch fill in what was missed.
+    const bool differenceFailed = (id == p->difference_req_id);
+    if( differenceFailed )
+        p->difference_req_id = 0;
+    else
+        p->state_req_id = 0;
+
+    p->difference_slices = 0;
+    p->pending_updates.clear();
+    if( p->pending_updates_timer )
+        killTimer(p->pending_updates_timer);
+    p->pending_updates_timer = 0;
+
+    if( differenceFailed && !p->state_req_id )
+        p->state_req_id = p->telegram->updatesGetState();
+
+    timerUpdateDialogs();
+}
+
+bool TelegramQml::updatesWaiting() const
+{
+    return p->state_loading || p->state_req_id || p->difference_req_id;
+}
+
+void TelegramQml::queueUpdates(const TelegramQmlPendingUpdates &updates)
+{
+    // Unordered updates are applied at once
+    if( !updates.ordered() )
+    {
+        applyUpdates(updates);
+        return;
+    }
+
+    if( !updatesWaiting() )
+    {
+        switch( updates.order(p->state_seq, p->state_pts, p->state_qts) )
+        {
+        case TelegramQmlPendingUpdates::Skip:
+            return;
+        case TelegramQmlPendingUpdates::Apply:
+            applyUpdates(updates);
+            applyPendingUpdates();
+            return;
+        case TelegramQmlPendingUpdates::Hold:
+            break;
+        }
+    }
+
+    // A seq, pts or qts gap, or a catch up is running: keep it aside for a moment
+    p->pending_updates << updates;
+    if( p->pending_updates.count() > UPDATES_PENDING_LIMIT )
+    {
+        // Too much to hold. Whatever comes next shows the gap again and
+        // the difference covers everything dropped here.
+        p->pending_updates.clear();
+        requestDifference();
+        return;
+    }
+
+    applyPendingUpdates();
+}
+
+void TelegramQml::applyUpdates(const TelegramQmlPendingUpdates &updates)
+{
+    insertUsers(updates.users);
+    insertChats(updates.chats);
+
+    foreach( const Update & update, updates.updates )
+    {
+        insertUpdate(update);
+        p->state_pts = qMax(p->state_pts, update.pts());
+        p->state_qts = qMax(p->state_qts, update.qts());
+    }
+
+    foreach( const Message & msg, updates.messages )
+    {
+        insertMessage(msg);
+        updateDialogTopMessage(msg, true);
+
+        emit incomingMessage( TelegramQml::message(msg.id()) );
+    }
+
+    foreach( const SecretChatMessage & msg, updates.secretMessages )
+        insertSecretChatMessage(msg);
+
+    p->state_pts = qMax(p->state_pts, updates.pts);
+    p->state_qts = qMax(p->state_qts, updates.qts);
+    p->state_date = qMax(p->state_date, updates.date);
+    if( updates.seq )
+        p->state_seq = updates.seq;
+
+    storeUpdatesState();
+}
+
+void TelegramQml::applyPendingUpdates()
+{
+    bool progress = !updatesWaiting();
+    while( progress )
+    {
+        progress = false;
+        for( int i=0; i<p->pending_updates.count(); i++ )
+        {
+            const TelegramQmlPendingUpdates::Order order = p->pending_updates.at(i).order(p->state_seq, p->state_pts, p->state_qts);
+            if( order == TelegramQmlPendingUpdates::Hold )
+                continue;
+
+            const TelegramQmlPendingUpdates updates = p->pending_updates.takeAt(i);
+            if( order == TelegramQmlPendingUpdates::Apply )
+            {
+                applyUpdates(updates);
+                progress = true;
+            }
+
+            i--;
+        }
+    }
+
+    if( p->pending_updates.isEmpty() )
+    {
+        if( p->pending_updates_timer )
+            killTimer(p->pending_updates_timer);
+        p->pending_updates_timer = 0;
+    }
+    else
+    if( !p->pending_updates_timer && !updatesWaiting() )
+        p->pending_updates_timer = startTimer(UPDATES_GAP_TIMEOUT);
+}
+
+void TelegramQml::updateState(qint32 pts, qint32 ptsCount, qint32 seq)
+{
+    TelegramQmlPendingUpdates updates;
+    updates.pts = pts;
+    updates.ptsCount = ptsCount;
+    updates.seq = seq;
+
+    queueUpdates(updates);
+}
+
+void TelegramQml::startCatchUp()
+{
+    if( !p->telegram || !p->authLoggedIn )
+        return;
+
+    if( p->state_pts )
+        requestDifference();
+    else
+    if( !p->state_req_id )
+        p->state_req_id = p->telegram->updatesGetState();
+}
+
+void TelegramQml::requestDifference()
+{
+    if( !p->telegram || !p->authLoggedIn || p->difference_req_id )
+        return;
+
+    if( p->pending_updates_timer )
+        killTimer(p->pending_updates_timer);
+    p->pending_updates_timer = 0;
+
+    if( !p->state_pts )
+    {
+        // Nothing to catch up from, so the dialogs list is the only way
+        if( !p->state_req_id )
+            p->state_req_id = p->telegram->updatesGetState();
+        timerUpdateDialogs();
+        return;
+    }
+
+    p->difference_req_id = p->telegram->updatesGetDifference(p->state_pts, p->state_date, p->state_qts);
+}
+
+void TelegramQml::loadUpdatesState()
+{
+    if( p->state_loaded || p->state_loading )
+        return;
+
+    // Ordered updates wait in the queue until the stored state is back
+    p->state_loading = true;
+    p->database->readValue("updatesState");
+}
+
+void TelegramQml::dbValueFounded(const QString &key, const QString &value)
+{
+    if( key != "updatesState" || !p->state_loading )
+        return;
+
+    const QStringList &parts = value.split(",");
+    p->state_pts = parts.value(0).toInt();
+    p->state_qts = parts.value(1).toInt();
+    p->state_date = parts.value(2).toInt();
+    p->state_seq = parts.value(3).toInt();
+    p->state_loading = false;
+    p->state_loaded = true;
+
+    startCatchUp();
+    applyPendingUpdates();
+}
+
+void TelegramQml::storeUpdatesState()
+{
+    if( p->state_loaded && !p->state_flush_timer )
+        p->state_flush_timer = startTimer(5000);
+}
+
+void TelegramQml::flushUpdatesState()
+{
+    if( p->state_flush_timer )
+        killTimer(p->state_flush_timer);
+    p->state_flush_timer = 0;
+
+    if( !p->state_loaded )
+        return;
+
+    p->database->setValue("updatesState", QString("%1,%2,%3,%4").arg(p->state_pts).arg(p->state_qts)
+                          .arg(p->state_date).arg(p->state_seq));
+}
+
 qint64 TelegramQml::generateRandomId() const
 {
     qint64 randomId;
@@ -3231,11 +4648,42 @@ Peer::PeerType TelegramQml::getPeerType(qint64 pid)
 
 QStringList TelegramQml::stringToIndex(const QString &str)
 {
-    return QStringList() << str.toLower();
+    const QString & decomposed = str.normalized(QString::NormalizationForm_KD).toCaseFolded();
+
+    QString folded;
+    folded.reserve(decomposed.length());
+    foreach(const QChar &ch, decomposed)
+    {
+        switch(ch.category())
+        {
+        case QChar::Mark_NonSpacing:
+        case QChar::Mark_SpacingCombining:
+        case QChar::Mark_Enclosing:
+            break;
+
+        default:
+            // Arabic and Persian keyboards type different code points for yeh and kaf
+            if(ch.unicode() == 0x064A || ch.unicode() == 0x0649)
+                folded += QChar(0x06CC);
+            else
+            if(ch.unicode() == 0x0643)
+                folded += QChar(0x06A9);
+            else
+            if(ch.isLetterOrNumber())
+                folded += ch;
+            else
+                folded += ' ';
+            break;
+        }
+    }
+
+    return folded.split(' ', QString::SkipEmptyParts);
 }
 
 TelegramQml::~TelegramQml()
 {
+    flushTags();
+    flushUpdatesState();
     if( p->telegram )
         delete p->telegram;
 
@@ -3244,40 +4692,24 @@ TelegramQml::~TelegramQml()
 
 bool checkDialogLessThan( qint64 a, qint64 b )
 {
-    DialogObject *ao = telegramp_qml_tmp->dialogs.value(a);
-    DialogObject *bo = telegramp_qml_tmp->dialogs.value(b);
-    if( !ao )
-        return false;
-    if( !bo )
-        return true;
+    const QPair<qint64,qint64> & ak = telegramp_qml_tmp->dialogs_keys.value(a);
+    const QPair<qint64,qint64> & bk = telegramp_qml_tmp->dialogs_keys.value(b);
+    if( ak != bk )
+        return ak > bk;
 
-    MessageObject *am = telegramp_qml_tmp->messages.value(ao->topMessage());
-    MessageObject *bm = telegramp_qml_tmp->messages.value(bo->topMessage());
-    if(!am || !bm)
-    {
-        EncryptedChatObject *aec = telegramp_qml_tmp->encchats.value(a);
-        EncryptedChatObject *bec = telegramp_qml_tmp->encchats.value(b);
-        if(aec && bm)
-            return aec->date() > bm->date();
-        else
-        if(am && bec)
-            return am->date() > bec->date();
-        else
-        if(aec && bec)
-            return aec->date() > bec->date();
-        else
-            return ao->topMessage() > bo->topMessage();
-    }
+    return a > b;
+}
 
-    return am->date() > bm->date();
+bool checkDialogAccessLessThan( qint64 a, qint64 b )
+{
+    return telegramp_qml_tmp->dialogs_access.value(a) < telegramp_qml_tmp->dialogs_access.value(b);
 }
 
 bool checkMessageLessThan( qint64 a, qint64 b )
 {
-    MessageObject *am = telegramp_qml_tmp->messages.value(a);
-    MessageObject *bm = telegramp_qml_tmp->messages.value(b);
-    if(am && bm)
-        return am->date() > bm->date();
+    const MessageStore &store = telegramp_qml_tmp->store;
+    if(store.contains(a) && store.contains(b))
+        return store.date(a) > store.date(b);
     else
         return a > b;
 }
@@ -21,9 +21,12 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QSet>
+#include <QVariantMap>
 #include "types/inputfilelocation.h"
 #include "types/peer.h"
 #include "types/inputpeer.h"
+#include "cutegramenums.h"
 
 class DownloadObject;
 class Database;
@@ -40,6 +43,7 @@ class EncryptedMessageObject;
 class DocumentObject;
 class VideoObject;
 class SecretChatMessage;
+class TelegramQmlPendingUpdates;
 class AudioObject;
 class WallPaper;
 class WallPaperObject;
@@ -49,6 +53,7 @@ class FileLocationObject;
 class PhotoObject;
 class ContactsLink;
 class Update;
+class UpdatesState;
 class Message;
 class ImportedContact;
 class User;
@@ -85,6 +90,16 @@ class TelegramQml : public QObject
 
     Q_PROPERTY(bool uploadingProfilePhoto READ uploadingProfilePhoto NOTIFY uploadingProfilePhotoChanged)
 
+    Q_PROPERTY(int residentMessages READ residentMessages NOTIFY messagesResidencyChanged)
+    Q_PROPERTY(int evictedMessages  READ evictedMessages  NOTIFY messagesResidencyChanged)
+    Q_PROPERTY(int messageObjects   READ messageObjects   NOTIFY messagesResidencyChanged)
+    Q_PROPERTY(int dialogsRefetchesPerHour READ dialogsRefetchesPerHour NOTIFY dialogsRefetchesChanged)
+
+    Q_PROPERTY(qint64 uploadsTotalSize READ uploadsTotalSize NOTIFY uploadsProgressChanged)
+    Q_PROPERTY(qint64 uploadsUploaded  READ uploadsUploaded  NOTIFY uploadsProgressChanged)
+    Q_PROPERTY(qreal  uploadsSpeed     READ uploadsSpeed     NOTIFY uploadsProgressChanged)
+    Q_PROPERTY(int    uploadsEta       READ uploadsEta       NOTIFY uploadsProgressChanged)
+
     Q_PROPERTY(Telegram* telegram READ telegram NOTIFY telegramChanged)
     Q_PROPERTY(UserData* userData READ userData NOTIFY userDataChanged)
     Q_PROPERTY(qint64    me       READ me       NOTIFY meChanged)
@@ -155,12 +170,31 @@ public:
 
     bool uploadingProfilePhoto() const;
 
+    int residentMessages() const;
+    int evictedMessages() const;
+    int messageObjects() const;
+    int dialogsRefetchesPerHour() const;
+    void retainDialog(qint64 dId);
+    void releaseDialog(qint64 dId);
+
+    Q_INVOKABLE QVariantMap typeObjectStats() const;
+    Q_INVOKABLE void readDatabaseStats();
+    Q_INVOKABLE void explainDatabaseQueries();
+
+    qint64 uploadsTotalSize() const;
+    qint64 uploadsUploaded() const;
+    qreal uploadsSpeed() const;
+    int uploadsEta() const;
+
     QString authSignUpError() const;
     QString authSignInError() const;
     QString error() const;
 
     Q_INVOKABLE DialogObject *dialog(qint64 id) const;
     Q_INVOKABLE MessageObject *message(qint64 id) const;
+    Q_INVOKABLE QString messageText(qint64 id) const;
+    Q_INVOKABLE void retainMessage(MessageObject *msg);
+    Q_INVOKABLE void releaseMessage(MessageObject *msg);
     Q_INVOKABLE ChatObject *chat(qint64 id) const;
     Q_INVOKABLE UserObject *user(qint64 id) const;
     Q_INVOKABLE qint64 messageDialogId(qint64 id) const;
@@ -193,15 +227,19 @@ public:
     Q_INVOKABLE QString fileLocation( FileLocationObject *location );
     Q_INVOKABLE QString videoThumbLocation( const QString &path );
 
+    qint64 fileLocationHits() const;
+    qint64 fileLocationMisses() const;
+
     QList<qint64> dialogs() const;
-    QList<qint64> messages(qint64 did, qint64 maxId = 0) const;
+    int dialogIndexOf(qint64 dId) const;
+    QList<qint64> messages(qint64 did, qint64 maxId = 0, int limit = -1) const;
     QList<qint64> wallpapers() const;
     QList<qint64> uploads() const;
     QList<qint64> contacts() const;
 
     InputPeer getInputPeer(qint64 pid);
 
-    QList<qint64> userIndex(const QString &keyword);
+    QList<qint64> userIndex(const QString &keyword, const QSet<qint64> &scope = QSet<qint64>(), int limit = -1);
 
 public slots:
     void authLogout();
@@ -235,16 +273,20 @@ public slots:
     void messagesGetFullChat(qint32 chatId);
 
     void search(const QString &keyword);
+    void searchLocal(const QString &keyword);
 
     bool sendFile(qint64 dialogId, const QString & file , bool forceDocument = false, bool forceAudio = false);
-    void getFile(FileLocationObject *location, qint64 type = InputFileLocation::typeInputFileLocation , qint32 fileSize = 0);
+    int sendFiles(qint64 dialogId, const QStringList & files , bool forceDocument = false, bool forceAudio = false);
+    void getFile(FileLocationObject *location, qint64 type = InputFileLocation::typeInputFileLocation , qint32 fileSize = 0,
+                 int priority = CutegramEnums::DownloadPriorityAuto);
+    void releaseFile(FileLocationObject *location);
     void getFileJustCheck(FileLocationObject *location);
     void cancelDownload(DownloadObject *download);
     void cancelSendGet( qint64 fileId );
 
     void setProfilePhoto( const QString & fileName );
 
-    void timerUpdateDialogs( bool duration = 1000 );
+    void timerUpdateDialogs( int duration = 1000 );
     void cleanUp();
 
 signals:
@@ -257,6 +299,7 @@ signals:
     void downloadPathChanged();
     void tempPathChanged();
     void dialogsChanged(bool cachedData);
+    void dialogIndexChanged(qint64 dialogId, int from, int to);
     void messagesChanged(bool cachedData);
     void wallpapersChanged();
     void uploadsChanged();
@@ -265,6 +308,9 @@ signals:
     void autoUpdateChanged();
     void encryptedChatsChanged();
     void uploadingProfilePhotoChanged();
+    void uploadsProgressChanged();
+    void messagesResidencyChanged();
+    void dialogsRefetchesChanged();
     void cutegramDialogChanged();
 
     void unreadCountChanged();
@@ -294,7 +340,9 @@ signals:
     void incomingMessage( MessageObject *msg );
     void incomingEncryptedMessage( EncryptedMessageObject *msg );
 
-    void searchDone(const QList<qint64> &messages);
+    void searchDone(const QString &keyword, const QList<qint64> &messages);
+    void localSearchDone(const QString &keyword, const QList<qint64> &messages);
+    void databaseStatsFounded(qint64 prepared, qint64 lookups);
 
 protected:
     void try_init();
@@ -350,6 +398,8 @@ private slots:
     void error(qint64 id, qint32 errorCode, QString errorText);
 
     void updatesTooLong_slt();
+    void updatesGetState_slt(qint64 id, qint32 pts, qint32 qts, qint32 date, qint32 seq, qint32 unreadCount);
+    void updatesGetDifference_slt(qint64 id, const QList<Message> & messages, const QList<SecretChatMessage> & secretChatMessages, const QList<Update> & otherUpdates, const QList<Chat> & chats, const QList<User> & users, const UpdatesState & state, bool isIntermediateState);
     void updateShortMessage_slt(qint32 id, qint32 fromId, QString message, qint32 pts, qint32 date, qint32 seq);
     void updateShortChatMessage_slt(qint32 id, qint32 fromId, qint32 chatId, QString message, qint32 pts, qint32 date, qint32 seq);
     void updateShort_slt(const Update & update, qint32 date);
@@ -362,18 +412,50 @@ private slots:
     void uploadCancelFile_slt(qint64 fileId, bool cancelled);
 
     void incomingAsemanMessage(const Message &msg, const Dialog &dialog);
+    void connected_slt();
 
 private:
     void insertDialog(const Dialog & dialog , bool encrypted = false, bool fromDb = false);
     void insertMessage(const Message & message , bool encrypted = false, bool fromDb = false, bool tempMsg = false);
-    void insertUser( const User & user, bool fromDb = false );
-    void insertChat( const Chat & chat, bool fromDb = false );
+    void insertMessages(const QList<Message> & messages, bool fromDb = false, bool tempMsg = false);
+    void insertUser( const User & user, bool fromDb = false, bool writeDb = true );
+    void insertChat( const Chat & chat, bool fromDb = false, bool writeDb = true );
+    void insertUsers( const QList<User> & users );
+    void insertChats( const QList<Chat> & chats );
     void insertUpdate( const Update & update );
     void insertContact( const Contact & contact );
     void insertEncryptedMessage(const EncryptedMessage & emsg);
     void insertEncryptedChat(const EncryptedChat & c);
 
+    void refreshDialogIndex(qint64 dId);
+    void removeDialogIndex(qint64 dId);
+    void queueUpdates(const TelegramQmlPendingUpdates &updates);
+    void applyUpdates(const TelegramQmlPendingUpdates &updates);
+    void applyPendingUpdates();
+    void insertSecretChatMessage(const SecretChatMessage &secretChatMessage);
+    void updatesRequestFailed(qint64 id);
+    bool updatesWaiting() const;
+    void updateState(qint32 pts, qint32 ptsCount, qint32 seq);
+    void startCatchUp();
+    void requestDifference();
+    void loadUpdatesState();
+    void storeUpdatesState();
+    void flushUpdatesState();
+    void updateDialogTopMessage(const Message &message, bool countUnread);
+    void refreshDialogTopMessage(qint64 dId);
+    void storeDialog(DialogObject *dlg);
+    void mergeMessageIndex(qint64 dId, QList<qint64> ids);
+    void harvestTags(const Message &message);
+    MessageObject *takeUpload(qint64 fileId);
+    void addUploadProgress(qint64 total, qint64 uploaded);
+    void flushTags();
+    void setUserTyping(qint64 dId, qint64 userId, bool typing);
+    void flushTypingUsers();
+    void scheduleStatusExpiry(UserObject *user);
+
     QString fileLocation_old( FileLocationObject *location );
+    QString cachedFileName(const QString &dpath, const QString &fname);
+    void fileLocationWritten(const QString &path);
 
 protected:
     void timerEvent(QTimerEvent *e);
@@ -381,13 +463,29 @@ protected:
     SecretChat *getSecretChat(qint64 chatId);
 
     void startGarbageChecker();
+    void startResidencyCheck();
+    void checkResidency();
+    MessageObject *materializeMessage(qint64 msgId);
+    void recycleMessage(MessageObject *obj);
+    void dropMessage(qint64 msgId);
+    void setMessageUnread(qint64 msgId, bool unread);
+    void setMessageEncryptKeys(qint64 msgId, const QByteArray &key, const QByteArray &iv);
 
 private slots:
     void dbUserFounded(const User &user);
     void dbChatFounded(const Chat &chat);
     void dbDialogFounded(const Dialog &dialog, bool encrypted);
-    void dbMessageFounded(const Message &message);
+    void dbMessagesFounded(const QList<Message> &messages);
     void dbMediaKeysFounded(qint64 mediaId, const QByteArray &key, const QByteArray &iv);
+    void fileLocationsChanged(const QString &dpath);
+    void downloadStarted(qint64 fileId, FileLocationObject *location);
+    void downloadFinished(qint64 id, const QString &path);
+    void uploadStarted(qint64 jobId, qint64 fileId);
+    void uploadFailed(qint64 jobId);
+    void rehydrateMessages();
+    void dbValueFounded(const QString &key, const QString &value);
+    void messageDestroyed(QObject *obj);
+    void ephemeralExpired(int kind, qint64 key, qint64 subKey);
 
     void refreshUnreadCount();
     void refreshSecretChats();
@@ -398,6 +496,9 @@ private slots:
     Peer::PeerType getPeerType(qint64 pid);
 
     QStringList stringToIndex(const QString & str);
+    QSet<qint64> userIndexCandidates(const QString &word) const;
+    void insertUserIndex(const User &u);
+    void removeUserIndex(qint64 uid);
 
 private:
     TelegramQmlPrivate *p;
@@ -1,8 +1,11 @@
 #include "telegramsearchmodel.h"
 #include "telegramqml.h"
 #include "objects/types.h"
+#include "asemantools/asemanlistdiff.h"
 
 #include <QTimerEvent>
+#include <QtAlgorithms>
+#include <QSet>
 
 class TelegramSearchModelPrivate
 {
@@ -38,7 +41,8 @@ void TelegramSearchModel::setTelegram(TelegramQml *tgo)
 
     if( !tg && p->telegram )
     {
-        disconnect( p->telegram, SIGNAL(searchDone(QList<qint64>)) , this, SLOT(searchDone(QList<qint64>)) );
+        disconnect( p->telegram, SIGNAL(searchDone(QString,QList<qint64>)) , this, SLOT(searchDone(QString,QList<qint64>)) );
+        disconnect( p->telegram, SIGNAL(localSearchDone(QString,QList<qint64>)), this, SLOT(localSearchDone(QString,QList<qint64>)) );
     }
 
     p->telegram = tg;
@@ -49,7 +53,8 @@ void TelegramSearchModel::setTelegram(TelegramQml *tgo)
     if( !p->telegram )
         return;
 
-    connect( p->telegram, SIGNAL(searchDone(QList<qint64>)) , this, SLOT(searchDone(QList<qint64>)) );
+    connect( p->telegram, SIGNAL(searchDone(QString,QList<qint64>)) , this, SLOT(searchDone(QString,QList<qint64>)) );
+    connect( p->telegram, SIGNAL(localSearchDone(QString,QList<qint64>)), this, SLOT(localSearchDone(QString,QList<qint64>)) );
     refresh();
 }
 
@@ -117,7 +122,9 @@ bool TelegramSearchModel::initializing() const
 
 void TelegramSearchModel::refresh()
 {
-    searchDone(QList<qint64>());
+    p->initializing = false;
+    emit initializingChanged();
+    changed(QList<qint64>());
 
     if(p->refresh_timer)
         killTimer(p->refresh_timer);
@@ -126,61 +133,50 @@ void TelegramSearchModel::refresh()
     if(!p->telegram)
         return;
 
+    if(!p->keyword.isEmpty())
+        p->telegram->searchLocal(p->keyword);
+
     p->refresh_timer = startTimer(1000);
 }
 
-void TelegramSearchModel::searchDone(const QList<qint64> &messages)
+void TelegramSearchModel::searchDone(const QString &keyword, const QList<qint64> &messages)
 {
+    // A late answer for an earlier keyword
+    if(keyword != p->keyword)
+        return;
+
     p->initializing = false;
     emit initializingChanged();
 
-    for( int i=0 ; i<p->messages.count() ; i++ )
-    {
-        const qint64 dId = p->messages.at(i);
-        if( messages.contains(dId) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->messages.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
+    merge(messages);
+}
 
+void TelegramSearchModel::localSearchDone(const QString &keyword, const QList<qint64> &messages)
+{
+    if(keyword != p->keyword)
+        return;
 
-    QList<qint64> temp_msgs = messages;
-    for( int i=0 ; i<temp_msgs.count() ; i++ )
-    {
-        const qint64 dId = temp_msgs.at(i);
-        if( p->messages.contains(dId) )
-            continue;
+    merge(messages);
+}
 
-        temp_msgs.removeAt(i);
-        i--;
-    }
-    while( p->messages != temp_msgs )
-        for( int i=0 ; i<p->messages.count() ; i++ )
+void TelegramSearchModel::merge(const QList<qint64> &messages)
+{
+    QList<qint64> merged = p->messages;
+    QSet<qint64> mergedSet = merged.toSet();
+    foreach(qint64 msgId, messages)
+        if(!mergedSet.contains(msgId))
         {
-            const qint64 dId = p->messages.at(i);
-            int nw = temp_msgs.indexOf(dId);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->messages.move( i, nw );
-            endMoveRows();
+            merged << msgId;
+            mergedSet.insert(msgId);
         }
 
+    qSort(merged.begin(), merged.end(), qGreater<qint64>());
+    changed(merged);
+}
 
-    for( int i=0 ; i<messages.count() ; i++ )
-    {
-        const qint64 dId = messages.at(i);
-        if( p->messages.contains(dId) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->messages.insert( i, dId );
-        endInsertRows();
-    }
+void TelegramSearchModel::changed(const QList<qint64> &messages)
+{
+    AsemanListDiff::apply(this, p->messages, messages);
 
     emit countChanged();
 }
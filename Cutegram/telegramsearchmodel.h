@@ -9,6 +9,7 @@ class TelegramSearchModelPrivate;
 class TelegramSearchModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
 
     Q_PROPERTY(TelegramQml* telegram READ telegram WRITE setTelegram NOTIFY telegramChanged)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
@@ -49,11 +50,16 @@ signals:
     void keywordChanged();
 
 private slots:
-    void searchDone(const QList<qint64> &messages);
+    void searchDone(const QString &keyword, const QList<qint64> &messages);
+    void localSearchDone(const QString &keyword, const QList<qint64> &messages);
 
 protected:
     void timerEvent(QTimerEvent *e);
 
+private:
+    void merge(const QList<qint64> &messages);
+    void changed(const QList<qint64> &messages);
+
 private:
     TelegramSearchModelPrivate *p;
 };
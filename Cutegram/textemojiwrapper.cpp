@@ -82,36 +82,36 @@ void TextEmojiWrapper::refresh()
     QTextCursor cursor(document);
     cursor.setPosition(0);
 
-    QString &text = p->text;
-    const QHash<QString,QString> &emojis = p->emojis->emojis();
-    for( int i=0; i<text.size(); i++ )
+    const QString &text = p->text;
+    const int length = text.size();
+
+    int plainStart = 0;
+    for( int i=0; i<length; )
     {
-        QString image;
-        for( int j=1; j<5; j++ )
+        const QString *image = 0;
+        const int matched = p->emojis->matchEmoji(text, i, &image);
+        if( !matched )
         {
-            QString emoji = text.mid(i,j);
-            if( !emojis.contains(emoji) )
-                continue;
-
-            image = emojis.value(emoji);
-            i += emoji.size()-1;
-            break;
+            i++;
+            continue;
         }
 
-        if(image.isEmpty())
-        {
-            cursor.insertText(QString(text[i]));
-        }
-        else
-        {
-            QTextImageFormat format;
-            format.setName(AsemanDevices::localFilesPrePath()+image);
-            format.setHeight(18);
-            format.setWidth(18);
+        if( plainStart < i )
+            cursor.insertText(text.mid(plainStart, i-plainStart));
 
-            cursor.insertImage(format);
-        }
+        QTextImageFormat format;
+        format.setName(AsemanDevices::localFilesPrePath()+*image);
+        format.setHeight(18);
+        format.setWidth(18);
+
+        cursor.insertImage(format);
+
+        i += matched;
+        plainStart = i;
     }
+
+    if( plainStart < length )
+        cursor.insertText(text.mid(plainStart));
 }
 
 TextEmojiWrapper::~TextEmojiWrapper()
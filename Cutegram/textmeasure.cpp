@@ -0,0 +1,161 @@
+/*
+    Copyright (C) 2014 Aseman
+    http://aseman.co
+
+    Cutegram is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cutegram is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textmeasure.h"
+
+#define MEASURE_CACHE_SIZE 4096
+
+#include <QCache>
+#include <QSet>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QTextDocument>
+#include <QCryptographicHash>
+#include <QVariant>
+
+QString textMeasureKey(const QString &html, const QFont &font, qreal maxWidth)
+{
+    const QByteArray &hash = QCryptographicHash::hash(html.toUtf8(), QCryptographicHash::Md5);
+    return QString::fromLatin1(hash.toHex()) + QChar(0x1F) + font.key() + QChar(0x1F) + QString::number(maxWidth);
+}
+
+QSizeF textMeasureLayout(QTextDocument *doc, const QString &html, const QFont &font, qreal maxWidth)
+{
+    doc->setDefaultFont(font);
+    doc->setTextWidth(maxWidth);
+    doc->setHtml(html);
+    return doc->size();
+}
+
+class TextMeasurePrefetcher : public QRunnable
+{
+public:
+    void run()
+    {
+        // QTextDocument is not thread safe, so the worker uses its own
+        QTextDocument doc;
+        QVariantList sizes;
+        foreach(const QString &html, htmls)
+            sizes << textMeasureLayout(&doc, html, font, maxWidth);
+
+        QMetaObject::invokeMethod(measure, "prefetched", Qt::QueuedConnection,
+                                  Q_ARG(QStringList,keys), Q_ARG(QVariantList,sizes));
+    }
+
+    QObject *measure;
+    QStringList keys;
+    QStringList htmls;
+    QFont font;
+    qreal maxWidth;
+};
+
+class TextMeasurePrivate
+{
+public:
+    QTextDocument *doc;
+    QCache<QString,QSizeF> cache;
+    QSet<QString> pending;
+    QThreadPool *pool;
+
+    qint64 hits;
+    qint64 misses;
+};
+
+TextMeasure::TextMeasure(QObject *parent) :
+    QObject(parent)
+{
+    p = new TextMeasurePrivate;
+    p->doc = new QTextDocument(this);
+    p->cache.setMaxCost(MEASURE_CACHE_SIZE);
+    p->pool = new QThreadPool(this);
+    p->pool->setMaxThreadCount(1);
+    p->hits = 0;
+    p->misses = 0;
+}
+
+QSizeF TextMeasure::htmlSize(const QString &html, const QFont &font, qreal maxWidth)
+{
+    const QString &key = textMeasureKey(html, font, maxWidth);
+    const QSizeF *cached = p->cache.object(key);
+    if(cached)
+    {
+        p->hits++;
+        return *cached;
+    }
+
+    p->misses++;
+    const QSizeF &size = textMeasureLayout(p->doc, html, font, maxWidth);
+    p->cache.insert(key, new QSizeF(size));
+    return size;
+}
+
+void TextMeasure::prefetch(const QStringList &htmls, const QFont &font, qreal maxWidth)
+{
+    TextMeasurePrefetcher *job = 0;
+    foreach(const QString &html, htmls)
+    {
+        if(html.isEmpty())
+            continue;
+
+        const QString &key = textMeasureKey(html, font, maxWidth);
+        if(p->pending.contains(key) || p->cache.contains(key))
+            continue;
+
+        if(!job)
+        {
+            job = new TextMeasurePrefetcher;
+            job->measure = this;
+            job->font = font;
+            job->maxWidth = maxWidth;
+        }
+
+        job->keys << key;
+        job->htmls << html;
+        p->pending.insert(key);
+    }
+
+    if(job)
+        p->pool->start(job);
+}
+
+qint64 TextMeasure::hits() const
+{
+    return p->hits;
+}
+
+qint64 TextMeasure::misses() const
+{
+    return p->misses;
+}
+
+void TextMeasure::prefetched(const QStringList &keys, const QVariantList &sizes)
+{
+    for(int i=0; i<keys.count() && i<sizes.count(); i++)
+    {
+        const QString &key = keys.at(i);
+        p->pending.remove(key);
+        p->cache.insert(key, new QSizeF(sizes.at(i).toSizeF()));
+    }
+}
+
+TextMeasure::~TextMeasure()
+{
+    p->pool->clear();
+    p->pool->waitForDone();
+    delete p;
+}
@@ -0,0 +1,48 @@
+/*
+    Copyright (C) 2014 Aseman
+    http://aseman.co
+
+    Cutegram is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Cutegram is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTMEASURE_H
+#define TEXTMEASURE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QSizeF>
+#include <QFont>
+
+class TextMeasurePrivate;
+class TextMeasure : public QObject
+{
+    Q_OBJECT
+public:
+    TextMeasure(QObject *parent = 0);
+    ~TextMeasure();
+
+    QSizeF htmlSize(const QString &html, const QFont &font = QFont(), qreal maxWidth = -1);
+    void prefetch(const QStringList &htmls, const QFont &font = QFont(), qreal maxWidth = -1);
+
+    qint64 hits() const;
+    qint64 misses() const;
+
+private slots:
+    void prefetched(const QStringList &keys, const QVariantList &sizes);
+
+private:
+    TextMeasurePrivate *p;
+};
+
+#endif // TEXTMEASURE_H
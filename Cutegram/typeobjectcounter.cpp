@@ -0,0 +1,84 @@
+#include "typeobjectcounter.h"
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QHash>
+
+class TypeObjectCounterEntry
+{
+public:
+    TypeObjectCounterEntry(): alive(0), created(0), bytes(0) {}
+    qint64 alive;
+    qint64 created;
+    qint64 bytes;
+};
+
+class TypeObjectCounterData
+{
+public:
+    QMutex mutex;
+    QHash<const QMetaObject*, TypeObjectCounterEntry> entries;
+};
+
+/*! Never freed, objects may still be destroyed during static destruction. */
+static TypeObjectCounterData *type_object_counter_data()
+{
+    static TypeObjectCounterData *data = new TypeObjectCounterData;
+    return data;
+}
+
+void TypeObjectCounter::created(const QMetaObject *meta, int size)
+{
+    TypeObjectCounterData *data = type_object_counter_data();
+    QMutexLocker locker(&data->mutex);
+
+    TypeObjectCounterEntry &entry = data->entries[meta];
+    entry.alive++;
+    entry.created++;
+    entry.bytes += size;
+}
+
+void TypeObjectCounter::destroyed(const QMetaObject *meta, int size)
+{
+    TypeObjectCounterData *data = type_object_counter_data();
+    QMutexLocker locker(&data->mutex);
+
+    TypeObjectCounterEntry &entry = data->entries[meta];
+    entry.alive--;
+    entry.bytes -= size;
+}
+
+QVariantMap TypeObjectCounter::report()
+{
+    TypeObjectCounterData *data = type_object_counter_data();
+    QMutexLocker locker(&data->mutex);
+
+    QVariantMap types;
+    qint64 alive = 0;
+    qint64 created = 0;
+    qint64 bytes = 0;
+
+    QHashIterator<const QMetaObject*, TypeObjectCounterEntry> i(data->entries);
+    while(i.hasNext())
+    {
+        i.next();
+        const TypeObjectCounterEntry &entry = i.value();
+
+        QVariantMap map;
+        map["alive"] = entry.alive;
+        map["created"] = entry.created;
+        map["bytes"] = entry.bytes;
+        types[i.key()->className()] = map;
+
+        alive += entry.alive;
+        created += entry.created;
+        bytes += entry.bytes;
+    }
+
+    QVariantMap res;
+    res["types"] = types;
+    res["alive"] = alive;
+    res["created"] = created;
+    res["bytes"] = bytes;
+    return res;
+}
@@ -0,0 +1,16 @@
+#ifndef TYPEOBJECTCOUNTER_H
+#define TYPEOBJECTCOUNTER_H
+
+#include <QVariantMap>
+
+struct QMetaObject;
+class TypeObjectCounter
+{
+public:
+    static void created(const QMetaObject *meta, int size);
+    static void destroyed(const QMetaObject *meta, int size);
+
+    static QVariantMap report();
+};
+
+#endif // TYPEOBJECTCOUNTER_H
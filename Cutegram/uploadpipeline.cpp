@@ -0,0 +1,269 @@
+#include "uploadpipeline.h"
+#include "asemantools/asemanapplication.h"
+#include "asemantools/asemantools.h"
+
+#include <telegram.h>
+#include <QPointer>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMimeDatabase>
+#include <QImageReader>
+#include <QFile>
+#include <QUuid>
+#include <QSettings>
+
+class UploadPipelineJob
+{
+public:
+    UploadPipelineJob(): id(0), dialogId(0), encrypted(false), forceDocument(false), forceAudio(false),
+        ready(false), type(UploadPipeline::MediaUnsupported) {}
+
+    qint64 id;
+    qint64 dialogId;
+    InputPeer peer;
+    bool encrypted;
+    QString file;
+    bool forceDocument;
+    bool forceAudio;
+
+    bool ready;
+    int type;
+    QString thumbnail;
+    QSize size;
+    QByteArray thumbData;
+};
+
+class UploadPipelineProbe : public QRunnable
+{
+public:
+    void run()
+    {
+        int type;
+        QString thumbnail;
+        QSize size;
+        QByteArray thumbData;
+
+        QMimeDatabase mime_db;
+        const QString &mime = mime_db.mimeTypeForFile(file).name();
+        if( !mime.contains("gif") && mime.contains("image/") && !forceDocument && !forceAudio )
+            type = UploadPipeline::MediaPhoto;
+        else
+        if( mime.contains("video/") && !forceDocument && !forceAudio )
+        {
+            type = UploadPipeline::MediaVideo;
+            thumbnail = tempPath + "/cutegram_thumbnail_" + QUuid::createUuid().toString() + ".jpg";
+            if( !AsemanTools::createVideoThumbnail(file, thumbnail) )
+                thumbnail.clear();
+            else
+                size = QImageReader(thumbnail).size();
+
+            QFile thumbFile(thumbnail);
+            if( encrypted && thumbFile.open(QFile::ReadOnly) )
+                thumbData = thumbFile.readAll();
+        }
+        else
+        if( encrypted )
+            type = UploadPipeline::MediaUnsupported;
+        else
+        if( (mime.contains("audio/") || forceAudio) && !forceDocument )
+            type = UploadPipeline::MediaAudio;
+        else
+            type = UploadPipeline::MediaDocument;
+
+        QMetaObject::invokeMethod(pipeline, "prepared", Qt::QueuedConnection, Q_ARG(qint64,jobId), Q_ARG(int,type),
+                                  Q_ARG(QString,thumbnail), Q_ARG(QSize,size), Q_ARG(QByteArray,thumbData));
+    }
+
+    QObject *pipeline;
+    qint64 jobId;
+    QString file;
+    QString tempPath;
+    bool encrypted;
+    bool forceDocument;
+    bool forceAudio;
+};
+
+class UploadPipelinePrivate
+{
+public:
+    QPointer<Telegram> telegram;
+    QThreadPool *pool;
+
+    QHash<qint64, UploadPipelineJob*> jobs;
+    QList<UploadPipelineJob*> queue;
+    QSet<qint64> active;
+
+    qint64 job_counter;
+    int max_active;
+};
+
+UploadPipeline::UploadPipeline(QObject *parent) :
+    QObject(parent)
+{
+    p = new UploadPipelinePrivate;
+    p->job_counter = 0;
+    p->max_active = qMax(1, AsemanApplication::settings()->value("Uploads/maxActive", 2).toInt());
+
+    p->pool = new QThreadPool(this);
+    p->pool->setMaxThreadCount(qMax(1, AsemanApplication::settings()->value("Uploads/probeThreads", 2).toInt()));
+}
+
+void UploadPipeline::setTelegram(Telegram *telegram)
+{
+    p->telegram = telegram;
+    schedule();
+}
+
+qint64 UploadPipeline::enqueue(qint64 dialogId, const InputPeer &peer, bool encrypted, const QString &file, bool forceDocument, bool forceAudio)
+{
+    // Jobs get negative ids, so they never collide with telegram file ids
+    UploadPipelineJob *job = new UploadPipelineJob;
+    job->id = --p->job_counter;
+    job->dialogId = dialogId;
+    job->peer = peer;
+    job->encrypted = encrypted;
+    job->file = file;
+    job->forceDocument = forceDocument;
+    job->forceAudio = forceAudio;
+
+    p->jobs[job->id] = job;
+    p->queue << job;
+
+    UploadPipelineProbe *probe = new UploadPipelineProbe;
+    probe->pipeline = this;
+    probe->jobId = job->id;
+    probe->file = file;
+    probe->tempPath = AsemanApplication::tempPath();
+    probe->encrypted = encrypted;
+    probe->forceDocument = forceDocument;
+    probe->forceAudio = forceAudio;
+
+    p->pool->start(probe);
+    return job->id;
+}
+
+void UploadPipeline::prepared(qint64 jobId, int type, const QString &thumbnail, const QSize &size, const QByteArray &thumbData)
+{
+    UploadPipelineJob *job = p->jobs.value(jobId);
+    if(!job)
+    {
+        if(!thumbnail.isEmpty())
+            QFile::remove(thumbnail);
+        return;
+    }
+
+    job->ready = true;
+    job->type = type;
+    job->thumbnail = thumbnail;
+    job->size = size;
+    job->thumbData = thumbData;
+
+    schedule();
+}
+
+void UploadPipeline::cancel(qint64 jobId)
+{
+    UploadPipelineJob *job = p->jobs.take(jobId);
+    if(!job)
+        return;
+
+    p->queue.removeAll(job);
+    if(!job->thumbnail.isEmpty())
+        QFile::remove(job->thumbnail);
+
+    delete job;
+    schedule();
+}
+
+void UploadPipeline::finished(qint64 fileId)
+{
+    if(!p->active.remove(fileId))
+        return;
+
+    schedule();
+}
+
+void UploadPipeline::clear()
+{
+    qDeleteAll(p->jobs);
+    p->jobs.clear();
+    p->queue.clear();
+    p->active.clear();
+}
+
+int UploadPipeline::activeCount() const
+{
+    return p->active.count();
+}
+
+int UploadPipeline::queuedCount() const
+{
+    return p->queue.count();
+}
+
+void UploadPipeline::schedule()
+{
+    if(!p->telegram)
+        return;
+
+    // Strictly in order, a prepared job never overtakes an earlier one
+    while(p->active.count() < p->max_active && !p->queue.isEmpty() && p->queue.first()->ready)
+    {
+        UploadPipelineJob *job = p->queue.takeFirst();
+        p->jobs.remove(job->id);
+
+        Telegram *tg = p->telegram;
+        qint64 randomId;
+        Utils::randomBytes(&randomId, 8);
+
+        qint64 fileId = 0;
+        switch(job->type)
+        {
+        case MediaPhoto:
+            if(job->encrypted)
+                fileId = tg->messagesSendEncryptedPhoto(job->dialogId, randomId, 0, job->file);
+            else
+                fileId = tg->messagesSendPhoto(job->peer, randomId, job->file);
+            break;
+
+        case MediaVideo:
+            if(job->encrypted)
+                fileId = tg->messagesSendEncryptedVideo(job->dialogId, randomId, 0, job->file, 0, job->size.width(), job->size.height(), job->thumbData);
+            else
+                fileId = tg->messagesSendVideo(job->peer, randomId, job->file, 0, job->size.width(), job->size.height(), job->thumbnail);
+            break;
+
+        case MediaAudio:
+            fileId = tg->messagesSendAudio(job->peer, randomId, job->file, 0);
+            break;
+
+        case MediaDocument:
+            fileId = tg->messagesSendDocument(job->peer, randomId, job->file);
+            break;
+
+        default:
+            break;
+        }
+
+        if(fileId)
+        {
+            p->active.insert(fileId);
+            emit started(job->id, fileId);
+        }
+        else
+            emit failed(job->id);
+
+        delete job;
+    }
+}
+
+UploadPipeline::~UploadPipeline()
+{
+    p->pool->clear();
+    p->pool->waitForDone();
+    clear();
+    delete p;
+}
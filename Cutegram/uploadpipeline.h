@@ -0,0 +1,50 @@
+#ifndef UPLOADPIPELINE_H
+#define UPLOADPIPELINE_H
+
+#include <QObject>
+#include <QSize>
+#include "types/inputpeer.h"
+
+class Telegram;
+class UploadPipelinePrivate;
+class UploadPipeline : public QObject
+{
+    Q_OBJECT
+public:
+    enum MediaTypes {
+        MediaUnsupported,
+        MediaPhoto,
+        MediaVideo,
+        MediaAudio,
+        MediaDocument
+    };
+
+    UploadPipeline(QObject *parent = 0);
+    ~UploadPipeline();
+
+    void setTelegram(Telegram *telegram);
+
+    qint64 enqueue(qint64 dialogId, const InputPeer &peer, bool encrypted, const QString &file,
+                   bool forceDocument, bool forceAudio);
+    void cancel(qint64 jobId);
+    void finished(qint64 fileId);
+    void clear();
+
+    int activeCount() const;
+    int queuedCount() const;
+
+signals:
+    void started(qint64 jobId, qint64 fileId);
+    void failed(qint64 jobId);
+
+private slots:
+    void prepared(qint64 jobId, int type, const QString &thumbnail, const QSize &size, const QByteArray &thumbData);
+
+private:
+    void schedule();
+
+private:
+    UploadPipelinePrivate *p;
+};
+
+#endif // UPLOADPIPELINE_H
@@ -32,6 +32,7 @@
 #include <QHash>
 #include <QFileInfo>
 #include <QDir>
+#include <QtMath>
 
 class SecretChatDBClass
 {
@@ -54,14 +55,34 @@ public:
     QHash<int,bool> loadLink;
     QHash<QString,QString> general;
     QMap<quint64, MessageUpdate> msg_updates;
-    QMap<QString,bool> tags;
+    QHash<QString,TagUsage> tags;
+    QStringList sorted_tags;
+    bool sorted_tags_dirty;
     QHash<int,int> notifies;
 };
 
+class TagRankItem
+{
+public:
+    QString tag;
+    qreal score;
+    qint64 lastUse;
+};
+
+bool tagRankLessThan(const TagRankItem &a, const TagRankItem &b)
+{
+    if(a.score != b.score)
+        return a.score > b.score;
+    if(a.lastUse != b.lastUse)
+        return a.lastUse > b.lastUse;
+    return a.tag < b.tag;
+}
+
 UserData::UserData(QObject *parent) :
     QObject(parent)
 {
     p = new UserDataPrivate;
+    p->sorted_tags_dirty = true;
 }
 
 void UserData::setPhoneNumber(const QString &phoneNumber)
@@ -258,23 +279,86 @@ int UserData::notify(int id)
 
 void UserData::addTag(const QString &t)
 {
-    const QString &tag = t.toLower();
-    if(p->tags.contains(tag))
+    TagUsage usage;
+    usage.count = 1;
+    usage.lastUse = QDateTime::currentDateTime().toTime_t();
+
+    QHash<QString,TagUsage> tags;
+    tags[t] = usage;
+    addTags(tags);
+}
+
+void UserData::addTags(const QHash<QString, TagUsage> &tags)
+{
+    if(tags.isEmpty())
         return;
 
-    QSqlQuery mute_query(p->db);
-    mute_query.prepare("INSERT OR REPLACE INTO tags (tag) VALUES (:tag)");
-    mute_query.bindValue(":tag",tag);
-    mute_query.exec();
-    CHECK_QUERY_ERROR(mute_query);
+    QSqlQuery begin_query("BEGIN", p->db);
+    begin_query.exec();
+
+    QSqlQuery tag_query(p->db);
+    tag_query.prepare("INSERT OR REPLACE INTO tags (tag, count, lastUse) VALUES (:tag, :count, :lastUse)");
 
-    p->tags.insert(tag, true);
-    emit tagsChanged(tag);
+    QHashIterator<QString,TagUsage> i(tags);
+    while(i.hasNext())
+    {
+        i.next();
+        const QString &tag = i.key().toLower();
+        TagUsage &usage = p->tags[tag];
+        usage.count += i.value().count;
+        usage.lastUse = qMax(usage.lastUse, i.value().lastUse);
+
+        tag_query.bindValue(":tag",tag);
+        tag_query.bindValue(":count",usage.count);
+        tag_query.bindValue(":lastUse",usage.lastUse);
+        tag_query.exec();
+        CHECK_QUERY_ERROR(tag_query);
+    }
+
+    QSqlQuery commit_query("COMMIT", p->db);
+    commit_query.exec();
+
+    p->sorted_tags_dirty = true;
+    emit tagsChanged(tags.count()==1? tags.constBegin().key().toLower() : QString());
 }
 
 QStringList UserData::tags() const
 {
-    return p->tags.keys();
+    if(!p->sorted_tags_dirty)
+        return p->sorted_tags;
+
+    // Frequency decays by half every 30 days since the tag was last used
+    const qint64 now = QDateTime::currentDateTime().toTime_t();
+    QList<TagRankItem> items;
+    items.reserve(p->tags.count());
+
+    QHashIterator<QString,TagUsage> i(p->tags);
+    while(i.hasNext())
+    {
+        i.next();
+        const qreal age = qMax<qint64>(0, now - i.value().lastUse)/(30*24*3600.0);
+
+        TagRankItem item;
+        item.tag = i.key();
+        item.lastUse = i.value().lastUse;
+        item.score = qMax(i.value().count,1)*qPow(0.5, age);
+        items << item;
+    }
+
+    qStableSort(items.begin(), items.end(), tagRankLessThan);
+
+    p->sorted_tags.clear();
+    p->sorted_tags.reserve(items.count());
+    foreach(const TagRankItem &item, items)
+        p->sorted_tags << item.tag;
+
+    p->sorted_tags_dirty = false;
+    return p->sorted_tags;
+}
+
+TagUsage UserData::tagUsage(const QString &tag) const
+{
+    return p->tags.value(tag.toLower());
 }
 
 void UserData::addMessageUpdate(const MessageUpdate &msg)
@@ -378,15 +462,7 @@ void UserData::init_buffer()
         p->notifies.insert( record.value(0).toInt(), record.value(1).toInt() );
     }
 
-    QSqlQuery tags_query(p->db);
-    tags_query.prepare("SELECT tag FROM tags");
-    tags_query.exec();
-
-    while( tags_query.next() )
-    {
-        const QSqlRecord & record = tags_query.record();
-        p->tags.insert( record.value(0).toString(), true );
-    }
+    init_tags();
 
     QSqlQuery msg_upd_query(p->db);
     msg_upd_query.prepare("SELECT id, message, date FROM updatemessages");
@@ -414,6 +490,25 @@ void UserData::init_buffer()
     }
 }
 
+void UserData::init_tags()
+{
+    p->tags.clear();
+    p->sorted_tags_dirty = true;
+
+    QSqlQuery tags_query(p->db);
+    tags_query.prepare("SELECT tag, count, lastUse FROM tags");
+    tags_query.exec();
+
+    while( tags_query.next() )
+    {
+        const QSqlRecord & record = tags_query.record();
+        TagUsage usage;
+        usage.count = record.value(1).toInt();
+        usage.lastUse = record.value(2).toLongLong();
+        p->tags.insert( record.value(0).toString(), usage );
+    }
+}
+
 void UserData::update_db()
 {
     const int version = value("version").toInt();
@@ -465,6 +560,20 @@ void UserData::update_db()
 
         setValue("version","6");
     }
+    if( version < 7 )
+    {
+        QStringList query_list;
+        query_list << "BEGIN;";
+        query_list << "ALTER TABLE Tags ADD COLUMN count INT NOT NULL DEFAULT 1;";
+        query_list << "ALTER TABLE Tags ADD COLUMN lastUse BIGINT NOT NULL DEFAULT 0;";
+        query_list << "COMMIT;";
+
+        foreach( const QString & query_str, query_list )
+            QSqlQuery( query_str, p->db ).exec();
+
+        setValue("version","7");
+        init_tags();
+    }
 }
 
 UserData::~UserData()
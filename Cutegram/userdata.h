@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QStringList>
+#include <QHash>
 
 class MessageUpdate
 {
@@ -30,6 +31,14 @@ public:
     qint64 date;
 };
 
+class TagUsage
+{
+public:
+    TagUsage(): count(0), lastUse(0) {}
+    int count;
+    qint64 lastUse;
+};
+
 class UserDataPrivate;
 class UserData : public QObject
 {
@@ -70,7 +79,9 @@ public slots:
     int notify(int id);
 
     void addTag(const QString &tag);
+    void addTags(const QHash<QString,TagUsage> &tags);
     QStringList tags() const;
+    TagUsage tagUsage(const QString &tag) const;
 
     void addMessageUpdate(const MessageUpdate &msg);
     void removeMessageUpdate(int id);
@@ -95,6 +106,7 @@ signals:
 
 private:
     void init_buffer();
+    void init_tags();
     void update_db();
 
 private:
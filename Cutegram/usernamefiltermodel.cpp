@@ -1,8 +1,10 @@
 #include "usernamefiltermodel.h"
 #include "telegramqml.h"
 #include "objects/types.h"
+#include "asemantools/asemanlistdiff.h"
 
 #include <QPointer>
+#include <QSet>
 
 class UserNameFilterModelPrivate
 {
@@ -131,11 +133,7 @@ qint64 UserNameFilterModel::get(int idx)
 
 void UserNameFilterModel::listChanged()
 {
-    QList<qint64> list;
-    if(p->telegram)
-        list = p->telegram->userIndex(p->keyword);
-
-    QList<qint64> dialogList;
+    QSet<qint64> dialogUsers;
     if(p->telegram && p->dialog)
     {
         qint64 chatId = p->dialog->peer()->chatId();
@@ -143,72 +141,19 @@ void UserNameFilterModel::listChanged()
         {
             ChatFullObject *chatFull = p->telegram->chatFull(chatId);
             if(chatFull)
-                dialogList = chatFull->participants()->participants()->userIds();
+                dialogUsers = chatFull->participants()->participants()->userIds().toSet();
             else
                 p->telegram->messagesGetFullChat(chatId);
         }
         else
-            dialogList << p->dialog->peer()->userId();
-    }
-
-    if(!dialogList.isEmpty())
-        for( int i=0 ; i<list.count() ; i++ )
-        {
-            const qint64 uId = list.at(i);
-            if( dialogList.contains(uId) )
-                continue;
-
-            list.removeAt(i);
-            i--;
-        }
-
-    for( int i=0 ; i<p->list.count() ; i++ )
-    {
-        const qint64 uId = p->list.at(i);
-        if( list.contains(uId) )
-            continue;
-
-        beginRemoveRows(QModelIndex(), i, i);
-        p->list.removeAt(i);
-        i--;
-        endRemoveRows();
-    }
-
-
-    QList<qint64> temp_list = list;
-    for( int i=0 ; i<temp_list.count() ; i++ )
-    {
-        const qint64 uId = temp_list.at(i);
-        if( p->list.contains(uId) )
-            continue;
-
-        temp_list.removeAt(i);
-        i--;
+            dialogUsers << p->dialog->peer()->userId();
     }
-    while( p->list != temp_list )
-        for( int i=0 ; i<p->list.count() ; i++ )
-        {
-            const qint64 uId = p->list.at(i);
-            int nw = temp_list.indexOf(uId);
-            if( i == nw )
-                continue;
-
-            beginMoveRows( QModelIndex(), i, i, QModelIndex(), nw>i?nw+1:nw );
-            p->list.move( i, nw );
-            endMoveRows();
-        }
 
+    QList<qint64> list;
+    if(p->telegram)
+        list = p->telegram->userIndex(p->keyword, dialogUsers);
 
-    for( int i=0 ; i<list.count() ; i++ )
-    {
-        const qint64 uId = list.at(i);
-        if( p->list.contains(uId) )
-            continue;
-
-        beginInsertRows(QModelIndex(), i, i );
-        p->list.insert( i, uId );
-        endInsertRows();
-    }
+    AsemanListDiff::apply(this, p->list, list);
 
     emit countChanged();
 }
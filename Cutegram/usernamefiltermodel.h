@@ -9,6 +9,7 @@ class UserNameFilterModelPrivate;
 class UserNameFilterModel : public QAbstractListModel
 {
     Q_OBJECT
+    friend class AsemanListDiff;
 
     Q_PROPERTY(TelegramQml* telegram READ telegram WRITE setTelegram NOTIFY telegramChanged)
     Q_PROPERTY(DialogObject* dialog READ dialog WRITE setDialog NOTIFY dialogChanged)